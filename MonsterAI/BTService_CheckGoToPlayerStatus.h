@@ -3,24 +3,25 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "BehaviorTree/BTService.h"
+#include "BTService_MonsterBase.h"
+#include "MonsterStates.h"
 #include "BTService_CheckGoToPlayerStatus.generated.h"
 
 
 UCLASS()
-class SPOOKYGAME_API UBTService_CheckGoToPlayerStatus : public UBTService
+class SPOOKYGAME_API UBTService_CheckGoToPlayerStatus : public UBTService_MonsterBase
 {
 	GENERATED_BODY()
 
 public:
-	UBTService_CheckGoToPlayerStatus();
+	virtual uint8 GetServiceState() const override { return EGurneyMonsterStates::GMS_GoToPlayer; }
 
 	/**
-	 * The logic of this service. Handles checking for state changes and updating variables.
-	 * Runs every tick that this servie is active in the behavior tree
-	 * @param OwnerComp Behavior tree owning this service
-	 * @param NodeMemory NodeMemory
-	 * @param DeltaSeconds Time since last tick in seconds
+	 * Moves the monster's chase target to a predicted intercept point, once the decision system decides it has drifted far enough.
+	 * The point is snapped to the navmesh, then the path repair and target change wait for the query scheduler
+	 * @param AIController The monster's controller
+	 * @param Intercept The predicted intercept point
+	 * @param PlayerLocation Where the player is, used if the intercept point isn't near the navmesh
 	 */
-	virtual void TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+	static void MoveChaseTarget(class AMonsterAIController& AIController, const FVector& Intercept, const FVector& PlayerLocation);
 };
@@ -3,23 +3,18 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "BehaviorTree/BTService.h"
+#include "BTService_MonsterBase.h"
+#include "MonsterStates.h"
 #include "BTService_CheckPursueStatus.generated.h"
 
 UCLASS()
-class SPOOKYGAME_API UBTService_CheckPursueStatus : public UBTService
+class SPOOKYGAME_API UBTService_CheckPursueStatus : public UBTService_MonsterBase
 {
 	GENERATED_BODY()
 
 public:
-	UBTService_CheckPursueStatus();
-
 	/**
-	 * The logic of this service. Handles checking for state changes and updating variables.
-	 * Runs every tick that this servie is active in the behavior tree
-	 * @param OwnerComp Behavior tree owning this service
-	 * @param NodeMemory NodeMemory
-	 * @param DeltaSeconds Time since last tick in seconds
+	 * Pursuing is decided by the decision system: once the monster reaches the sound it switches to searching around it
 	 */
-	virtual void TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;	
+	virtual uint8 GetServiceState() const override { return EGurneyMonsterStates::GMS_Pursue; }
 };
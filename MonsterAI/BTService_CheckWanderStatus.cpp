@@ -1,110 +1,112 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "BTService_CheckWanderStatus.h"
-#include <Kismet/GameplayStatics.h>
 
+#include "Monster.h"
 #include "MonsterAIController.h"
-#include "NavigationSystem.h"
-#include "NavigationSystem/Public/NavigationPath.h"
-#include "PlayerCharacterComponent.h"
-#include "BehaviorTree/BlackboardComponent.h"
-#include "BehaviorTree/Blackboard/BlackboardKeyType_Float.h"
-#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
+#include "MonsterPresenceHeatMap.h"
+#include "MonsterStateRules.h"
+#include "WorldActorRegistry.h"
 #include "GameFramework/Character.h"
 
-UBTService_CheckWanderStatus::UBTService_CheckWanderStatus()
+void UBTService_CheckWanderStatus::ChooseTarget(AMonsterAIController& AIController, const AMonster& Monster, const float WanderRadius)
 {
-	bCreateNodeInstance = true;
-}
+	FMonsterBlackboard& Blackboard = AIController.GetMonsterBlackboard();
 
-void UBTService_CheckWanderStatus::TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
-{
-	//get the AIController associated with this behavior tree
-	AMonsterAIController* AIController = Cast<AMonsterAIController>(OwnerComp.GetAIOwner());
+	//time since pursue counts up from a timestamp on the controller
+	const float TimeSincePursue = AIController.GetTimeSincePursue();
 
-	//increment time since pursue
-	const float TimeSincePursue = OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Float>(AIController->TimeSincePursueKeyID);
-	if (TimeSincePursue >= 0)
-	{
-		OwnerComp.GetBlackboardComponent()->SetValue<UBlackboardKeyType_Float>(AIController->TimeSincePursueKeyID, TimeSincePursue + DeltaSeconds);
-	}
-	   
-	//get the wander radius
-	const float WanderRadius = OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Float>(AIController->WanderRadiusKeyID);
+	//create vectors to use in the GetRandomReachablePointInRadius
+	const FVector MonsterLocation = Monster.GetActorLocation();
 
-	//increment wander radius
-	if (WanderRadius < AIController->GetDesiredWanderRadius())
-	{
-		OwnerComp.GetBlackboardComponent()->SetValue<UBlackboardKeyType_Float>(AIController->WanderRadiusKeyID, WanderRadius + (DeltaSeconds * 3));
-	}
+	//set wanderCenter to monsterLocation by default
+	FVector WanderCenter = MonsterLocation;
 
-	//get distance to current target point
-	const float Distance = FVector::Distance(AIController->GetPawn()->GetActorLocation(), OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Vector>(AIController->TargetLocationKeyID));
-	
-	//if within a tolerable radius of the target location, choose a new target
-	if (Distance < 150)
-	{
-		//create vectors to use in the GetRandomReachablePointInRadius
-		const FVector MonsterLocation = AIController->GetPawn()->GetActorLocation();
+	//define a vector to be updated later
+	FVector RandomPoint(1, 1, 1);
 
-		//set wanderCenter to monsterLocation by default
-		FVector WanderCenter = MonsterLocation;
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(&AIController);
+	const AActor* Player = Registry ? Registry->GetPlayer() : nullptr;
 
-		//define a vector to be updated later
-		FVector RandomPoint(1, 1, 1);
+	//the horde makes the same choice for its members
+	MonsterStateRules::FWanderChoice Choice;
+	if (Player)
+	{
+		MonsterStateRules::FWanderInputs Inputs;
+		Inputs.bPlayerSafe = Registry->IsPlayerSafe();
+		Inputs.DistanceToPlayer = (Player->GetActorLocation() - MonsterLocation).Size();
+		Inputs.TimeSincePursue = TimeSincePursue;
+		Choice = MonsterStateRules::ChooseWanderTarget(Inputs);
+		if (Choice.TimeSincePursue != TimeSincePursue)
+		{
+			AIController.SetTimeSincePursue(Choice.TimeSincePursue);
+		}
+	}
 
-		//get the current nav system
-		const UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (Player && Choice.Target == MonsterStateRules::EWanderTarget::AwayFromPlayer)
+	{
+		RandomPoint = AIController.GetFarthestRunawayLocationFromPlayer();
+	} 
+	else if (Player)
+	{
+		const float WanderBiasStartRadius = Blackboard.GetWanderBiasStartRadius();
+		
+		//monster drifts in it's wander algorithm towards where it has recently heard or seen the player, if that is far away.
+		//monster does not "cheat" if player is in a safe zone 
+		FVector HotLocation;
+		const UMonsterPresenceHeatMap* HeatMap = AIController.GetWorld()->GetSubsystem<UMonsterPresenceHeatMap>();
+		if (HeatMap && HeatMap->FindHottestNearby(MonsterLocation, HeatMapSearchCells, HotLocation)
+			&& FVector::Dist2D(MonsterLocation, HotLocation) >= WanderBiasStartRadius)
+		{
+			WanderCenter = FMath::Lerp(MonsterLocation, HotLocation, .15f);
+		}
 
-		const UPlayerCharacterComponent* Player = Cast<UPlayerCharacterComponent>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0)->GetComponentByClass(UPlayerCharacterComponent::StaticClass()));
-		if (Player && Player->IsPlayerProtectedBySafetyVolume())
+		//determine how far the target point should be from the player
+		bool bFound = false;
+		if (Choice.Target == MonsterStateRules::EWanderTarget::FarthestRunaway)
 		{
-			RandomPoint = AIController->GetFarthestRunawayLocationFromPlayer();
-		} 
-		else if (Player)
+			RandomPoint = AIController.GetFarthestRunawayLocation();
+		}
+		else
 		{
-			//determine player proximity to monster
-			const FVector PlayerLocation = Player->GetOwner()->GetActorLocation();
-			const float DistanceToPlayer = (PlayerLocation - MonsterLocation).Size();
-			const float WanderBiasStartRadius = OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Float>(AIController->WanderBiasStartRadiusKeyID);
-			
-			//if player is far from monster, monster "cheats" in it's wander algorithm
-			//monster does not "cheat" if player is in a safe zone 
-			if (DistanceToPlayer >= WanderBiasStartRadius && !Player->IsPlayerProtectedBySafetyVolume())
+			//this is what runs to get the wander point in all situations except the first wander out of goto/pursue->search->wander
+			//pooled points are already known to be reachable, so they need no path test
+			if (AIController.GetPooledTargetPoint(WanderCenter, WanderRadius, RandomPoint))
 			{
-				WanderCenter = FMath::Lerp(MonsterLocation, PlayerLocation, .15f);
+				Blackboard.SetTargetLocation(RandomPoint);
+				return;
 			}
 
-			//in case monster gets close without you ever making a sound, this makes him leave eventually anyway
-			//TODO: Magic number??
-			if (DistanceToPlayer <= 1100 && TimeSincePursue < 0)
+			if (AIController.UseAsyncNavQueries())
 			{
-				OwnerComp.GetBlackboardComponent()->SetValue<UBlackboardKeyType_Float>(AIController->TimeSincePursueKeyID, 1);
+				//the candidates are projected and path tested off the game thread, the target location is set when it comes back
+				TArray<FVector> Candidates;
+				AIController.AddRandomTargetCandidates(WanderCenter, WanderRadius, Candidates);
+				AIController.RequestTargetLocationAsync(Candidates);
+				return;
 			}
+			bFound = AIController.GetRandomReachablePoint(WanderCenter, WanderRadius, RandomPoint);
+		}
 
-			//determine how far the target point should be from the player
-			bool bFound = false;
-			if (TimeSincePursue >= 4) //4 is an old number and this will only ever happen out of the search algo and it'll be like ~30, but this still runs
-			{
-				RandomPoint = AIController->GetFarthestRunawayLocation();
-				OwnerComp.GetBlackboardComponent()->SetValue<UBlackboardKeyType_Float>(AIController->TimeSincePursueKeyID, -1);
-			}
-			else
-			{
-				//this is what runs to get the wander point in all situations except the first wander out of goto/pursue->search->wander
-				bFound = UNavigationSystemV1::K2_GetRandomReachablePointInRadius(GetWorld(), WanderCenter, RandomPoint, WanderRadius, NavSys->MainNavData, nullptr);
-			}
+		if (AIController.UseAsyncNavQueries())
+		{
+			//the path test runs off the game thread, the target location is set when it comes back
+			AIController.RequestTargetLocationAsync({ RandomPoint });
+			return;
+		}
 
-			//determine point validity
-			const UNavigationPath* NavPath = UNavigationSystemV1::FindPathToLocationSynchronously(GetWorld(), MonsterLocation, RandomPoint, NULL);
-			const bool bValid = NavPath != nullptr && NavPath->IsValid() && !NavPath->IsPartial();
-			if (!bValid)
-			{
-				RandomPoint = AIController->GetClosestRunawayLocation();
-			}
+		//determine point validity
+		const FNavPathSharedPtr NavPath = AIController.FindPathTo(RandomPoint);
+		const bool bValid = NavPath.IsValid() && NavPath->IsValid() && !NavPath->IsPartial();
+		if (!bValid)
+		{
+			RandomPoint = AIController.GetClosestRunawayLocation();
 		}
-		
-		//set the target location to the newly chosen target point
-		OwnerComp.GetBlackboardComponent()->SetValue<UBlackboardKeyType_Vector>(AIController->TargetLocationKeyID, RandomPoint);
+
+		//hand the validated path to the move task so it doesn't pathfind again
+		AIController.SetTargetPath(RandomPoint, bValid ? NavPath : nullptr);
 	}
+	
+	//set the target location to the newly chosen target point
+	Blackboard.SetTargetLocation(RandomPoint);
 }
\ No newline at end of file
@@ -3,23 +3,30 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "BehaviorTree/BTService.h"
+#include "BTService_MonsterBase.h"
+#include "MonsterStates.h"
 #include "BTService_CheckWanderStatus.generated.h"
 
 UCLASS()
-class SPOOKYGAME_API UBTService_CheckWanderStatus : public UBTService
+class SPOOKYGAME_API UBTService_CheckWanderStatus : public UBTService_MonsterBase
 {
 	GENERATED_BODY()
 
 public:
-	UBTService_CheckWanderStatus();
-	
+	virtual uint8 GetServiceState() const override { return EGurneyMonsterStates::GMS_Wander; }
+
+	/**
+	 * Picks the monster's next wander target and sets it as the TargetLocation, or starts an async query for it.
+	 * Run by the query scheduler once the decision system decides the monster needs a new target
+	 * @param AIController The monster's controller
+	 * @param Monster The monster
+	 * @param WanderRadius Radius to pick the target in
+	 */
+	static void ChooseTarget(class AMonsterAIController& AIController, const class AMonster& Monster, float WanderRadius);
+
+private:
 	/**
-	 * The logic of this service. Handles checking for state changes and updating variables.
-	 * Runs every tick that this servie is active in the behavior tree
-	 * @param OwnerComp Behavior tree owning this service
-	 * @param NodeMemory NodeMemory
-	 * @param DeltaSeconds Time since last tick in seconds
+	 * How many heat map cells out from the monster the wander bias looks for the hottest cell
 	 */
-	virtual void TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+	static constexpr int32 HeatMapSearchCells = 6;
 };
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BTService_MonsterBase.h"
+
+#include "Monster.h"
+#include "MonsterAIController.h"
+#include "MonsterDecisionSystem.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+
+UBTService_MonsterBase::UBTService_MonsterBase()
+{
+	//one copy of the service is shared by every monster, per monster data lives in node memory
+	bCreateNodeInstance = false;
+	bNotifyBecomeRelevant = true;
+	bNotifyCeaseRelevant = true;
+
+	//the decision system makes the decisions on the service's interval instead
+	bNotifyTick = false;
+}
+
+uint16 UBTService_MonsterBase::GetInstanceMemorySize() const
+{
+	return sizeof(FBTMonsterServiceMemory);
+}
+
+void UBTService_MonsterBase::InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const
+{
+	FBTMonsterServiceMemory* Memory = GetMonsterMemory(NodeMemory);
+	new (Memory) FBTMonsterServiceMemory();
+
+	Memory->AIController = Cast<AMonsterAIController>(OwnerComp.GetAIOwner());
+	Memory->Monster = Memory->AIController ? Cast<AMonster>(Memory->AIController->GetPawn()) : nullptr;
+}
+
+void UBTService_MonsterBase::OnBecomeRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	Super::OnBecomeRelevant(OwnerComp, NodeMemory);
+
+	//the controller may have possessed a different monster since the memory was initialized
+	FBTMonsterServiceMemory* Memory = GetMonsterMemory(NodeMemory);
+	Memory->AIController = Cast<AMonsterAIController>(OwnerComp.GetAIOwner());
+	Memory->Monster = Memory->AIController ? Cast<AMonster>(Memory->AIController->GetPawn()) : nullptr;
+
+	UMonsterDecisionSystem* DecisionSystem = OwnerComp.GetWorld()->GetSubsystem<UMonsterDecisionSystem>();
+	if (DecisionSystem && Memory->AIController)
+	{
+		DecisionSystem->AddMonster(Memory->AIController, GetServiceState(), Interval);
+	}
+}
+
+void UBTService_MonsterBase::OnCeaseRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTMonsterServiceMemory* Memory = GetMonsterMemory(NodeMemory);
+	UMonsterDecisionSystem* DecisionSystem = OwnerComp.GetWorld()->GetSubsystem<UMonsterDecisionSystem>();
+	if (DecisionSystem && Memory->AIController)
+	{
+		DecisionSystem->RemoveMonster(Memory->AIController, GetServiceState());
+	}
+
+	Super::OnCeaseRelevant(OwnerComp, NodeMemory);
+}
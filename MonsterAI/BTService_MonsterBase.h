@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTService.h"
+#include "BTService_MonsterBase.generated.h"
+
+/**
+ * Per-monster data for the monster services, kept in the behavior tree's node memory
+ */
+struct FBTMonsterServiceMemory
+{
+	/**
+	 * The controller running the behavior tree
+	 */
+	class AMonsterAIController* AIController;
+
+	/**
+	 * The monster the controller is possessing
+	 */
+	TWeakObjectPtr<class AMonster> Monster;
+};
+
+/**
+ * Base for the monster state services. The services are shared by every monster running the behavior tree rather than
+ * instanced per monster, so anything they need to remember per monster lives in FBTMonsterServiceMemory.
+ * The services don't tick themselves: while one is relevant its monster is added to the UMonsterDecisionSystem,
+ * which makes every monster's decisions together once per service interval
+ */
+UCLASS(Abstract)
+class SPOOKYGAME_API UBTService_MonsterBase : public UBTService
+{
+	GENERATED_BODY()
+
+public:
+	UBTService_MonsterBase();
+
+	virtual uint16 GetInstanceMemorySize() const override;
+
+	/**
+	 * Caches the controller and monster for the behavior tree this memory belongs to
+	 * @param OwnerComp Behavior tree owning this service
+	 * @param NodeMemory NodeMemory
+	 * @param InitType Why the memory is being initialized
+	 */
+	virtual void InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const override;
+
+	/**
+	 * Refreshes the cached monster and starts making this service's decisions for it
+	 * @param OwnerComp Behavior tree owning this service
+	 * @param NodeMemory NodeMemory
+	 */
+	virtual void OnBecomeRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	/**
+	 * Stops making this service's decisions for the monster
+	 * @param OwnerComp Behavior tree owning this service
+	 * @param NodeMemory NodeMemory
+	 */
+	virtual void OnCeaseRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	/**
+	 * @return The monster state this service makes decisions for, an EGurneyMonsterStates
+	 */
+	virtual uint8 GetServiceState() const PURE_VIRTUAL(UBTService_MonsterBase::GetServiceState, return 0;);
+
+protected:
+	/**
+	 * Returns this service's memory for one behavior tree
+	 * @param NodeMemory NodeMemory
+	 * @return The memory
+	 */
+	static FBTMonsterServiceMemory* GetMonsterMemory(uint8* NodeMemory) { return reinterpret_cast<FBTMonsterServiceMemory*>(NodeMemory); }
+};
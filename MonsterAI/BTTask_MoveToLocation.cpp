@@ -6,12 +6,7 @@
 #include "Monster.h"
 #include "MonsterAIController.h"
 #include "MonsterStates.h"
-#include "NavigationSystem.h"
-#include "BehaviorTree/BlackboardComponent.h"
-#include "BehaviorTree/Blackboard/BlackboardKeyType_Enum.h"
-#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "NavigationSystem/Public/NavigationPath.h"
 
 EBTNodeResult::Type UBTTask_MoveToLocation::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
 {
@@ -20,12 +15,14 @@ EBTNodeResult::Type UBTTask_MoveToLocation::ExecuteTask(UBehaviorTreeComponent&
 
 	if (AIController)
 	{
+		FMonsterBlackboard& Blackboard = AIController->GetMonsterBlackboard();
+
 		//set walk speed to desired
 		const AMonster* Monster = Cast<AMonster>(AIController->GetPawn());
 		if (Monster)
 		{
 
-			if (OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Enum>(AIController->StateKeyID) == EGurneyMonsterStates::GMS_GoToPlayer || OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Enum>(AIController->StateKeyID) == EGurneyMonsterStates::GMS_Pursue)
+			if (Blackboard.GetState() == EGurneyMonsterStates::GMS_GoToPlayer || Blackboard.GetState() == EGurneyMonsterStates::GMS_Pursue)
 			{
 				Cast<UCharacterMovementComponent>(Monster->GetMovementComponent())->MaxWalkSpeed = AIController->GetDesiredRunSpeed();
 			}
@@ -35,24 +32,30 @@ EBTNodeResult::Type UBTTask_MoveToLocation::ExecuteTask(UBehaviorTreeComponent&
 			}
 		}
 
-		if (OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Enum>(AIController->StateKeyID) != EGurneyMonsterStates::GMS_GoToPlayer && OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Enum>(AIController->StateKeyID) != EGurneyMonsterStates::GMS_Pursue)
+		//a path to the target may already have been found when the target was chosen
+		FVector TargetLocation = Blackboard.GetTargetLocation();
+		FNavPathSharedPtr Path = AIController->GetTargetPath(TargetLocation);
+
+		if (!Path.IsValid() && Blackboard.GetState() != EGurneyMonsterStates::GMS_GoToPlayer && Blackboard.GetState() != EGurneyMonsterStates::GMS_Pursue)
 		{
 			//ensure there is a path to the point being told to move to
-			const FVector MonsterLocation = AIController->GetPawn()->GetActorLocation();
-			const FVector TargetLocation = OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Vector>(AIController->TargetLocationKeyID);
-
-			const UNavigationPath* NavPath = UNavigationSystemV1::FindPathToLocationSynchronously(GetWorld(), MonsterLocation, TargetLocation, NULL);
-			const bool bValid = NavPath != nullptr && NavPath->IsValid() && !NavPath->IsPartial();
+			const FNavPathSharedPtr NavPath = AIController->FindPathTo(TargetLocation);
+			const bool bValid = NavPath.IsValid() && NavPath->IsValid() && !NavPath->IsPartial();
 			//if there is no point, instead move to the closest runaway location
 			if (!bValid)
 			{
-				OwnerComp.GetBlackboardComponent()->SetValue<UBlackboardKeyType_Vector>(AIController->TargetLocationKeyID, AIController->GetClosestRunawayLocation());
+				TargetLocation = AIController->GetClosestRunawayLocation();
+				Blackboard.SetTargetLocation(TargetLocation);
+			}
+			else
+			{
+				//the validation path is the move path, no need to search for it twice
+				Path = NavPath;
 			}
 		}
-		
 
 		//move to the location stored in "TargetLocation"
-		AIController->MoveToLocation(OwnerComp.GetBlackboardComponent()->GetValue<UBlackboardKeyType_Vector>(AIController->TargetLocationKeyID), 5.f, true, true, false, true, 0, true);
+		AIController->MoveToTargetLocation(TargetLocation, Path);
 	}
 	
 	//return from this task as successful
@@ -3,17 +3,72 @@
 
 
 #include "MonsterAIController.h"
-#include "DrawDebugHelpers.h"
-#include "PlayerCharacterComponent.h"
 #include "Monster.h"
 #include "BehaviorTree/BehaviorTree.h"
 #include "BehaviorTree/BehaviorTreeComponent.h"
 #include "BehaviorTree/BlackboardComponent.h"
-#include "BehaviorTree/Blackboard/BlackboardKeyAllTypes.h"
 #include <MonsterAI/MonsterStates.h>
 #include "Engine/Engine.h"
-#include "MonsterRunAwayLocation.h"
-#include "Kismet/GameplayStatics.h"
+#include "MonsterAIQueryScheduler.h"
+#include "MonsterAIStats.h"
+#include "MonsterHordeSystem.h"
+#include "MonsterNoiseBus.h"
+#include "MonsterPathCache.h"
+#include "MonsterReachablePointPool.h"
+#include "MonsterRunAwaySystem.h"
+#include "MonsterStateRules.h"
+#include "MonsterVisionSystem.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "TimerManager.h"
+#include "WorldActorRegistry.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+
+//the rules' states are cast straight to and from the blackboard's state
+static_assert(static_cast<uint8>(MonsterStateRules::EState::Wander) == EGurneyMonsterStates::GMS_Wander, "MonsterStateRules::EState must match EGurneyMonsterStates");
+static_assert(static_cast<uint8>(MonsterStateRules::EState::Pursue) == EGurneyMonsterStates::GMS_Pursue, "MonsterStateRules::EState must match EGurneyMonsterStates");
+static_assert(static_cast<uint8>(MonsterStateRules::EState::GoToPlayer) == EGurneyMonsterStates::GMS_GoToPlayer, "MonsterStateRules::EState must match EGurneyMonsterStates");
+static_assert(static_cast<uint8>(MonsterStateRules::EState::Search) == EGurneyMonsterStates::GMS_Search, "MonsterStateRules::EState must match EGurneyMonsterStates");
+static_assert(static_cast<uint8>(MonsterStateRules::EState::ListenToLog) == EGurneyMonsterStates::GMS_ListenToLog, "MonsterStateRules::EState must match EGurneyMonsterStates");
+static_assert(static_cast<uint8>(MonsterStateRules::EState::Inactive) == EGurneyMonsterStates::GMS_Inactive, "MonsterStateRules::EState must match EGurneyMonsterStates");
+
+namespace
+{
+	/** Number of deterministic monsters holding the fixed time step */
+	int32 NumFixedTimeStepHolders = 0;
+
+	/** The game's time step settings from before the first deterministic monster took them over */
+	bool bPreviousUseFixedTimeStep = false;
+	double PreviousFixedDeltaTime = 0.0;
+
+	/**
+	 * Switches the game to a fixed time step, if no other deterministic monster already has
+	 * @param TimeStep Length of a frame in seconds
+	 */
+	void AcquireFixedTimeStep(const float TimeStep)
+	{
+		if (NumFixedTimeStepHolders++ > 0) { return; }
+
+		bPreviousUseFixedTimeStep = FApp::UseFixedTimeStep();
+		PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(TimeStep);
+	}
+
+	/**
+	 * Puts the game's own time step settings back once no deterministic monster holds the fixed time step
+	 */
+	void ReleaseFixedTimeStep()
+	{
+		if (--NumFixedTimeStepHolders > 0) { return; }
+
+		FApp::SetUseFixedTimeStep(bPreviousUseFixedTimeStep);
+		FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+	}
+}
 
 AMonsterAIController::AMonsterAIController()
 {
@@ -29,314 +84,848 @@ void AMonsterAIController::OnPossess(APawn* InPawn)
 	//get the monster character this controller is controlling
 	const AMonster* Monster = Cast<AMonster>(InPawn);
 
-	//get runaway locations
-	TArray<AActor*> FoundActors;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AMonsterRunAwayLocation::StaticClass(), FoundActors);
-	for (const AActor* FoundActor : FoundActors)
+	//deterministic mode can be turned on from the command line for automated runs
+	if (FParse::Value(FCommandLine::Get(), TEXT("MonsterAISeed="), RandomSeed))
 	{
-		RunAwayLocations.Add(FoundActor->GetActorLocation());
+		bDeterministic = true;
+	}
+	if (bDeterministic)
+	{
+		//services and timers read world time, a fixed step makes it the same every run. The first deterministic monster sets it
+		if (!bHoldsFixedTimeStep)
+		{
+			AcquireFixedTimeStep(DeterministicTimeStep);
+			bHoldsFixedTimeStep = true;
+		}
+		RandomStream.Initialize(RandomSeed);
+		DecisionLog.Reset();
+	}
+	else
+	{
+		RandomStream.GenerateNewSeed();
 	}
 
+	//wander and search targets come from here
+	PointPool = bUseReachablePointPool ? GetWorld()->GetSubsystem<UMonsterReachablePointPool>() : nullptr;
+	QueryScheduler = GetWorld()->GetSubsystem<UMonsterAIQueryScheduler>();
+	PathCache = GetWorld()->GetSubsystem<UMonsterPathCache>();
+
+	//get runaway locations, already indexed and baked when play began
+	RunAwaySystem = GetWorld()->GetSubsystem<UMonsterRunAwaySystem>();
+
+	Registry = UWorldActorRegistry::Get(this);
+	if (Registry)
+	{
+		PlayerSafetyChangedHandle = Registry->OnPlayerSafetyChanged.AddUObject(this, &AMonsterAIController::OnPlayerSafetyChanged);
+	}
 
 	if (Monster && Monster->MonsterBehavior)
 	{
 		//set up the BlackboardComponent
 		BlackboardComponent->InitializeBlackboard(*Monster->MonsterBehavior->BlackboardAsset);
 
-		//get KeyIDs for the Blackboard variables
-		StateKeyID = BlackboardComponent->GetKeyID("State");
-		TargetLocationKeyID = BlackboardComponent->GetKeyID("TargetLocation");
-		WanderRadiusKeyID = BlackboardComponent->GetKeyID("WanderRadius");
-		WanderBiasStartRadiusKeyID = BlackboardComponent->GetKeyID("WanderBiasStartRadius");
-		TimeSincePursueKeyID = BlackboardComponent->GetKeyID("TimeSincePursue");
-		GoToPlayerTotalTimeKeyID = BlackboardComponent->GetKeyID("GoToPlayerTotalTime");
-		WalkSpeedKeyID = BlackboardComponent->GetKeyID("WalkSpeed");
-		HowLongToGoToPlayerKeyID = BlackboardComponent->GetKeyID("HowLongToGoToPlayer");
-		PursueInsteadOfSearchRadiusKeyID = BlackboardComponent->GetKeyID("PursueInsteadOfSearchRadius");
-		SearchCenterPointKeyID = BlackboardComponent->GetKeyID("SearchCenterPoint");
+		//look up the keys for the Blackboard variables
+		MonsterBlackboard.Init(BlackboardComponent);
 
 		//setup ai properties with defaults
-		BlackboardComponent->SetValue<UBlackboardKeyType_Float>(WanderRadiusKeyID, DesiredWanderRadius);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Float>(WanderBiasStartRadiusKeyID, DesiredWanderBiasRadius);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Float>(WalkSpeedKeyID, DesiredWalkSpeed);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Float>(PursueInsteadOfSearchRadiusKeyID, DesiredPursueInsteadOfSearchRadius);
+		MonsterBlackboard.SetWanderRadius(DesiredWanderRadius);
+		MonsterBlackboard.SetWanderBiasStartRadius(DesiredWanderBiasRadius);
+		MonsterBlackboard.SetWalkSpeed(DesiredWalkSpeed);
+		MonsterBlackboard.SetPursueInsteadOfSearchRadius(DesiredPursueInsteadOfSearchRadius);
 		
 		//setup ai properties
-		//BlackboardComponent->SetValue<UBlackboardKeyType_Enum>(StateKeyID, EGurneyMonsterStates::GMS_Wander);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Enum>(StateKeyID, EGurneyMonsterStates::GMS_Inactive);
-		//BlackboardComponent->SetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID, GetPawn()->GetActorLocation());
+		//MonsterBlackboard.SetState(EGurneyMonsterStates::GMS_Wander);
+		MonsterBlackboard.SetState(EGurneyMonsterStates::GMS_Inactive);
+		//MonsterBlackboard.SetTargetLocation(GetPawn()->GetActorLocation());
 		FVector test(-2400, 95.5, -363);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID, test);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Float>(TimeSincePursueKeyID, -1);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Float>(GoToPlayerTotalTimeKeyID, 0);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Float>(HowLongToGoToPlayerKeyID, 0);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Vector>(SearchCenterPointKeyID, GetPawn()->GetActorLocation());
+		MonsterBlackboard.SetTargetLocation(test);
+		MonsterBlackboard.SetHowLongToGoToPlayer(0);
+		MonsterBlackboard.SetSearchCenterPoint(GetPawn()->GetActorLocation());
 		
+		//record every decision the monster makes, for the decision log and telemetry, whenever either is on
+		UpdateDecisionObservers();
+		TelemetryEnabledChangedHandle = FMonsterTelemetry::OnEnabledChanged().AddUObject(this, &AMonsterAIController::UpdateDecisionObservers);
+
 		//begin the behavior tree
 		BehaviorTreeComponent->StartTree(*Monster->MonsterBehavior);
 
+		//start listening for sounds
+		NoiseBus = GetWorld()->GetSubsystem<UMonsterNoiseBus>();
+		if (NoiseBus)
+		{
+			NoiseBus->AddListener(this);
+		}
+
+		//and start looking for the player
+		VisionSystem = GetWorld()->GetSubsystem<UMonsterVisionSystem>();
+		if (VisionSystem)
+		{
+			VisionSystem->AddWatcher(this);
+		}
+
 		// Play wander groan
 		//Monster->PlayMonsterSound("PlayMonsterIdleLoop");
 	}
 }
 
-void AMonsterAIController::Tick(float DeltaTime)
+void AMonsterAIController::OnUnPossess()
 {
-	Super::Tick(DeltaTime);
-	
-	//debug printing
-	const AMonster* Monster = Cast<AMonster>(GetPawn());
-	if (Monster->drawDebugInfo)
+	//results for a pawn we no longer control are useless
+	AbortTargetLocationQuery();
+	ClearStateTimers();
+	if (QueryScheduler)
 	{
-		//target location
-		DrawDebugSphere(GetWorld(), BlackboardComponent->GetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID), 50, 4, FColor::Blue, false, -1.0f, 0, 2);	
-		
-		//state
-		FString state;
-		switch (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID))
-		{
-		case EGurneyMonsterStates::GMS_Wander:
-			state = "Current monster AI state: Wander";
-			//wander radius
-			//DrawDebugSphere(GetPawn()->GetWorld(), GetPawn()->GetActorLocation(), BlackboardComponent->GetValue<UBlackboardKeyType_Float>(WanderRadiusKeyID), 13, FColor::Emerald, false, -1.0f, 0, 2);
-			break;
-		case EGurneyMonsterStates::GMS_Pursue:
-			state = "Current monster AI state: Pursue";
-			break;
-		case EGurneyMonsterStates::GMS_GoToPlayer:
-			state = "Current monster AI state: Go To Player";
-			break;
-		case EGurneyMonsterStates::GMS_Search:
-
-			DrawDebugSphere(GetWorld(), BlackboardComponent->GetValue<UBlackboardKeyType_Vector>(SearchCenterPointKeyID), 50, 4, FColor::Orange, false, -1.0f, 0, 2);
-			GEngine->AddOnScreenDebugMessage(-1, -1.0f, FColor::Orange, "Search Center Point: (" + FString::SanitizeFloat(BlackboardComponent->GetValue<UBlackboardKeyType_Vector>(SearchCenterPointKeyID).X) +
-				", " + FString::SanitizeFloat(BlackboardComponent->GetValue<UBlackboardKeyType_Vector>(SearchCenterPointKeyID).Y) +
-				", " + FString::SanitizeFloat(BlackboardComponent->GetValue<UBlackboardKeyType_Vector>(SearchCenterPointKeyID).Z) + ")");
-			state = "Current monster AI state: Search";
-			break;
-		case EGurneyMonsterStates::GMS_ListenToLog:
-			state = "Current monster AI state: ListenToLog";
-			break;
-		case EGurneyMonsterStates::GMS_Inactive:
-			state = "Current monster AI state: Inactive";
-			break;
-		default:
-			break;
-		}
-		GEngine->AddOnScreenDebugMessage(-1, -1.0f, FColor::Orange, state);
+		QueryScheduler->Cancel(this);
+	}
 
-		// time since pursue
-		GEngine->AddOnScreenDebugMessage(-1, -1.0f, FColor::Orange, "Time since pursue: " + FString::SanitizeFloat(BlackboardComponent->GetValue<UBlackboardKeyType_Float>(TimeSincePursueKeyID)));
-		GEngine->AddOnScreenDebugMessage(-1, -1.0f, FColor::White, "Target Location: (" + FString::SanitizeFloat(BlackboardComponent->GetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID).X) + 
-																	", " + FString::SanitizeFloat(BlackboardComponent->GetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID).Y) + 
-																	", " + FString::SanitizeFloat(BlackboardComponent->GetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID).Z) + ")");
+	if (NoiseBus)
+	{
+		NoiseBus->RemoveListener(this);
+	}
+	if (VisionSystem)
+	{
+		VisionSystem->RemoveWatcher(this);
 	}
+	if (Registry)
+	{
+		Registry->OnPlayerSafetyChanged.Remove(PlayerSafetyChangedHandle);
+	}
+
+	FMonsterTelemetry::OnEnabledChanged().Remove(TelemetryEnabledChangedHandle);
+	BlackboardComponent->UnregisterObserversFrom(this);
+	bObservingDecisions = false;
+
+	Super::OnUnPossess();
 }
 
-void AMonsterAIController::ReportSound(FVector Origin, float HearableRadius, bool IsOngoing /*= false*/, bool IsAudioLog /*= false*/, float HowLongToGoToPlayer /*= -1.0f*/, bool bOverrideSafeZone /*= false*/)
+void AMonsterAIController::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	//don't respond to sounds while inactive
-	if (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) == EGurneyMonsterStates::GMS_Inactive) { return; }
+	FMonsterTelemetry::OnEnabledChanged().Remove(TelemetryEnabledChangedHandle);
+	BlackboardComponent->UnregisterObserversFrom(this);
+	bObservingDecisions = false;
+	if (bHoldsFixedTimeStep)
+	{
+		ReleaseFixedTimeStep();
+		bHoldsFixedTimeStep = false;
+	}
+	if (bDeterministic)
+	{
+		DecisionLog.SaveToFile(FPaths::ProjectSavedDir() / TEXT("MonsterAI") / FString::Printf(TEXT("DecisionLog_%s_%d.csv"), *GetName(), RandomSeed));
+	}
 
-	//todo react to audio log
-	//this might need to be moved so that it has to hear it before reacting
-	if (IsAudioLog) { return; }
+	Super::EndPlay(EndPlayReason);
+}
 
-	//if player is safe and this sound isn't specifically set to ignore safe zones, don't respond
-	if (!Player)
+void AMonsterAIController::UpdateDecisionObservers()
+{
+	const AMonster* Monster = Cast<AMonster>(GetPawn());
+	const bool bObserve = bDeterministic || (Monster && FMonsterTelemetry::IsEnabled(Monster->drawDebugInfo));
+	if (bObserve == bObservingDecisions) { return; }
+
+	bObservingDecisions = bObserve;
+	if (!bObserve)
+	{
+		BlackboardComponent->UnregisterObserversFrom(this);
+		return;
+	}
+
+	const FOnBlackboardChangeNotification OnDecision = FOnBlackboardChangeNotification::CreateUObject(this, &AMonsterAIController::OnDecisionKeyChanged);
+	BlackboardComponent->RegisterObserver(MonsterBlackboard.GetStateKey(), this, OnDecision);
+	BlackboardComponent->RegisterObserver(MonsterBlackboard.GetTargetLocationKey(), this, OnDecision);
+	BlackboardComponent->RegisterObserver(MonsterBlackboard.GetSearchCenterPointKey(), this, OnDecision);
+}
+
+EBlackboardNotificationResult AMonsterAIController::OnDecisionKeyChanged(const UBlackboardComponent& InBlackboardComponent, const FBlackboard::FKey ChangedKey)
+{
+	if (ChangedKey == MonsterBlackboard.GetSearchCenterPointKey())
 	{
-		Player = Cast<UPlayerCharacterComponent>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0)->GetComponentByClass(UPlayerCharacterComponent::StaticClass()));
+		RecordTelemetry(EMonsterTelemetryEvent::SearchCenterChanged);
+		return EBlackboardNotificationResult::ContinueObserving;
 	}
-	if (Player)
+
+	const bool bStateChanged = ChangedKey == MonsterBlackboard.GetStateKey();
+	if (bDeterministic)
 	{
-		if (Player->IsPlayerProtectedBySafetyVolume())
-		{
-			return;
-		}
+		DecisionLog.Add(GetWorld()->GetTimeSeconds(), bStateChanged ? FName(TEXT("State")) : FName(TEXT("Target")), MonsterBlackboard.GetState(), MonsterBlackboard.GetTargetLocation());
 	}
+	RecordTelemetry(bStateChanged ? EMonsterTelemetryEvent::StateChanged : EMonsterTelemetryEvent::TargetChanged);
+	return EBlackboardNotificationResult::ContinueObserving;
+}
 
-	//debug printing
+void AMonsterAIController::RecordTelemetry(const EMonsterTelemetryEvent Event, const FVector& SoundOrigin /*= FVector::ZeroVector*/, const float HearableRadius /*= 0.0f*/, const float HearingDistance /*= 0.0f*/)
+{
+#if MONSTER_TELEMETRY
 	const AMonster* Monster = Cast<AMonster>(GetPawn());
-	if (Monster->drawDebugInfo)
+	if (!Monster || !FMonsterTelemetry::IsEnabled(Monster->drawDebugInfo)) { return; }
+
+	FMonsterTelemetrySample Sample;
+	Sample.Time = GetWorld()->GetTimeSeconds();
+	Sample.Event = Event;
+	Sample.State = MonsterBlackboard.GetState();
+	Sample.Location = Monster->GetActorLocation();
+	Sample.TargetLocation = MonsterBlackboard.GetTargetLocation();
+	Sample.SearchCenter = MonsterBlackboard.GetSearchCenterPoint();
+	Sample.PursueInsteadOfSearchRadius = MonsterBlackboard.GetPursueInsteadOfSearchRadius();
+	Sample.TimeSincePursue = GetTimeSincePursue();
+	//at most one of the timers runs at a time, the other reports -1
+	Sample.StateTimeRemaining = FMath::Max(GetWorldTimerManager().GetTimerRemaining(SearchTimerHandle), GetWorldTimerManager().GetTimerRemaining(GoToPlayerTimerHandle));
+	Sample.SoundOrigin = SoundOrigin;
+	Sample.HearableRadius = HearableRadius;
+	Sample.HearingDistance = HearingDistance;
+	Telemetry.Add(Sample);
+#endif
+}
+
+void AMonsterAIController::ReportSound(FVector Origin, float HearableRadius, bool IsOngoing /*= false*/, bool IsAudioLog /*= false*/, float HowLongToGoToPlayer /*= -1.0f*/, bool bOverrideSafeZone /*= false*/)
+{
+	FMonsterNoiseEvent Event;
+	Event.Origin = Origin;
+	Event.HearableRadius = HearableRadius;
+	Event.bIsOngoing = IsOngoing;
+	Event.bIsAudioLog = IsAudioLog;
+	Event.HowLongToGoToPlayer = HowLongToGoToPlayer;
+	Event.bOverrideSafeZone = bOverrideSafeZone;
+	Event.OriginRoom = NoiseBus ? NoiseBus->GetAcousticGraph().FindRoom(Origin) : INDEX_NONE;
+	HandleNoiseBatch({ Event });
+}
+
+void AMonsterAIController::HandleNoiseBatch(const TArray<FMonsterNoiseEvent>& Events)
+{
+	//don't respond to sounds while inactive
+	if (MonsterBlackboard.GetState() == EGurneyMonsterStates::GMS_Inactive) { return; }
+
+	//if player is safe and this sound isn't specifically set to ignore safe zones, don't respond
+	if (Registry && Registry->IsPlayerSafe()) { return; }
+
+	//the monster's room is the same for every sound in the batch
+	const int32 ListenerRoom = NoiseBus ? NoiseBus->GetAcousticGraph().FindRoom(GetPawn()->GetActorLocation()) : INDEX_NONE;
+
+	for (const FMonsterNoiseEvent& Event : Events)
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 3.0f, FColor::Orange, "Sound Reported and not early return");
+		//todo react to audio log
+		//this might need to be moved so that it has to hear it before reacting
+		if (Event.bIsAudioLog) { continue; }
+
+		ReactToSound(Event, ListenerRoom);
 	}
+}
+
+void AMonsterAIController::ReactToSound(const FMonsterNoiseEvent& Event, const int32 ListenerRoom)
+{
+	FVector Origin = Event.Origin;
 
-	//calculate distance to sound
-	const float VerticalDistance = FMath::Abs(Origin.Z - GetPawn()->GetActorLocation().Z) * 2; //vertical distance counts double
+	//calculate how far the sound travels to reach the monster, through doors and openings between rooms
+	float Distance = FMonsterAcousticGraph::GetDirectHearingDistance(Origin, GetPawn()->GetActorLocation());
+	if (NoiseBus)
+	{
+		Distance = NoiseBus->GetAcousticGraph().GetHearingDistance(Origin, Event.OriginRoom, GetPawn()->GetActorLocation(), ListenerRoom);
+	}
 	Origin.Z = GetPawn()->GetActorLocation().Z; //remove Z from further calculations
-	const float Distance = VerticalDistance + FVector::Distance(Origin, GetPawn()->GetActorLocation());
 
-	//debug stuff
-	const AMonster* Pawn = Cast<AMonster>(GetPawn());
-	if (Pawn->drawDebugInfo)
+	//the telemetry viewer draws the hearing radii around the monster
+	RecordTelemetry(Distance < Event.HearableRadius ? EMonsterTelemetryEvent::SoundHeard : EMonsterTelemetryEvent::SoundIgnored, Event.Origin, Event.HearableRadius, Distance);
+
+	MonsterStateRules::FInputs Inputs = GetStateInputs(MonsterStateRules::EEvent::Sound);
+	Inputs.Distance = Distance;
+	Inputs.HearableRadius = Event.HearableRadius;
+	Inputs.HowLongToGoToPlayer = Event.HowLongToGoToPlayer;
+	ApplyTransition(MonsterStateRules::Transition(Inputs), Origin);
+}
+
+void AMonsterAIController::ReportSight(const FVector& PlayerLocation)
+{
+	RecordTelemetry(EMonsterTelemetryEvent::PlayerSeen);
+
+	MonsterStateRules::FInputs Inputs = GetStateInputs(MonsterStateRules::EEvent::PlayerSeen);
+	Inputs.HowLongToGoToPlayer = SightGoToPlayerTime;
+
+	FVector Location = PlayerLocation;
+	Location.Z = GetPawn()->GetActorLocation().Z; //remove Z from further calculations
+	ApplyTransition(MonsterStateRules::Transition(Inputs), Location);
+}
+
+void AMonsterAIController::SetFollowPlayer()
+{
+	RecordTelemetry(EMonsterTelemetryEvent::FollowPlayer);
+	ApplyTransition(MonsterStateRules::Transition(GetStateInputs(MonsterStateRules::EEvent::FollowPlayer)), GetPawn()->GetActorLocation());
+}
+
+void AMonsterAIController::AIOnPlayerDeath()
+{
+	ApplyTransition(MonsterStateRules::Transition(GetStateInputs(MonsterStateRules::EEvent::PlayerDeath)), GetPawn()->GetActorLocation());
+}
+
+void AMonsterAIController::ActivateMonster()
+{
+	//activating an active monster sends it to the player
+	if (MonsterBlackboard.GetState() != EGurneyMonsterStates::GMS_Inactive)
 	{
-		DrawDebugSphere(GetPawn()->GetWorld(), GetPawn()->GetActorLocation(), HearableRadius, 15, FColor::Red, false, 1.5f, 0, 2);
-		DrawDebugSphere(GetPawn()->GetWorld(), GetPawn()->GetActorLocation(), BlackboardComponent->GetValue<UBlackboardKeyType_Float>(PursueInsteadOfSearchRadiusKeyID), 15, FColor::Green, false, 1.5f, 0, 2);
+		SetFollowPlayer();
+		return;
 	}
+	ApplyTransition(MonsterStateRules::Transition(GetStateInputs(MonsterStateRules::EEvent::Activate)), GetPawn()->GetActorLocation());
+}
+
+void AMonsterAIController::StartSearch(const FVector& SearchCenter)
+{
+	ApplyTransition(MonsterStateRules::Transition(GetStateInputs(MonsterStateRules::EEvent::StartSearch)), SearchCenter);
+}
+
+void AMonsterAIController::StartGoToPlayer(const float Duration)
+{
+	MonsterBlackboard.SetState(EGurneyMonsterStates::GMS_GoToPlayer);
+
+	//a zero length timer would never fire, the earliest it can end is next frame
+	GetWorldTimerManager().SetTimer(GoToPlayerTimerHandle, this, &AMonsterAIController::OnGoToPlayerTimeUp, FMath::Max(Duration, KINDA_SMALL_NUMBER), false);
+}
+
+void AMonsterAIController::OnSearchTimeUp()
+{
+	ApplyTransition(MonsterStateRules::Transition(GetStateInputs(MonsterStateRules::EEvent::SearchTimeUp)), GetPawn()->GetActorLocation());
+}
+
+void AMonsterAIController::OnGoToPlayerTimeUp()
+{
+	ApplyTransition(MonsterStateRules::Transition(GetStateInputs(MonsterStateRules::EEvent::GoToPlayerTimeUp)), GetPawn()->GetActorLocation());
+}
+
+MonsterStateRules::FInputs AMonsterAIController::GetStateInputs(const MonsterStateRules::EEvent Event) const
+{
+	MonsterStateRules::FInputs Inputs;
+	Inputs.State = static_cast<MonsterStateRules::EState>(MonsterBlackboard.GetState());
+	Inputs.Event = Event;
+	Inputs.Distance = FVector::Distance(GetPawn()->GetActorLocation(), MonsterBlackboard.GetTargetLocation());
+	Inputs.PursueInsteadOfSearchRadius = MonsterBlackboard.GetPursueInsteadOfSearchRadius();
+	Inputs.HowLongToGoToPlayer = MonsterBlackboard.GetHowLongToGoToPlayer();
+	return Inputs;
+}
+
+template <MonsterStateRules::EState State>
+void AMonsterAIController::OnExitState(const FVector& Location)
+{
+}
+
+template <>
+void AMonsterAIController::OnExitState<MonsterStateRules::EState::GoToPlayer>(const FVector& Location)
+{
+	GetWorldTimerManager().ClearTimer(GoToPlayerTimerHandle);
+}
+
+template <>
+void AMonsterAIController::OnExitState<MonsterStateRules::EState::Search>(const FVector& Location)
+{
+	GetWorldTimerManager().ClearTimer(SearchTimerHandle);
+}
+
+template <MonsterStateRules::EState State>
+void AMonsterAIController::OnEnterState(const MonsterStateRules::FTransition& Transition, const FVector& Location)
+{
+	MonsterBlackboard.SetState(static_cast<uint8>(State));
+}
+
+template <>
+void AMonsterAIController::OnEnterState<MonsterStateRules::EState::Wander>(const MonsterStateRules::FTransition& Transition, const FVector& Location)
+{
+	MonsterBlackboard.SetState(EGurneyMonsterStates::GMS_Wander);
+	if (Transition.Entry == MonsterStateRules::EEntry::None) { return; }
 
-	if (Distance < HearableRadius)
+	MonsterBlackboard.SetWanderRadius(DesiredWanderRadius);
+	MonsterBlackboard.SetTargetLocation(GetPawn()->GetActorLocation());
+	if (Transition.Entry == MonsterStateRules::EEntry::Reset)
 	{
-		if (Distance < BlackboardComponent->GetValue<UBlackboardKeyType_Float>(PursueInsteadOfSearchRadiusKeyID))
-		{
-			//follow player if told to
-			if (HowLongToGoToPlayer > 0)
-			{
-				//set monster to pursue the player
-				if (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_GoToPlayer &&
-					BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_Pursue)
-				{
-					// play transition sound
-					AMonster* MonsterPawn = Cast<AMonster>(GetPawn());
-					MonsterPawn->PlayMonsterSound("PlayMonsterDetected");
-				}
-				BlackboardComponent->SetValue<UBlackboardKeyType_Enum>(StateKeyID, EGurneyMonsterStates::GMS_GoToPlayer);
-				BlackboardComponent->SetValue<UBlackboardKeyType_Float>(HowLongToGoToPlayerKeyID, HowLongToGoToPlayer);
-				BlackboardComponent->SetValue<UBlackboardKeyType_Float>(GoToPlayerTotalTimeKeyID, 0);
-			}
-			// don't respond to sound if chasing player directly
-			else if (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_GoToPlayer)
-			{
-				//set monster to pursue the sound
-				if (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_Pursue
-					&& BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_GoToPlayer)
-				{
-					// play transition sound
-					AMonster* MonsterPawn = Cast<AMonster>(GetPawn());
-					MonsterPawn->PlayMonsterSound("PlayMonsterDetected");
-				}
-				BlackboardComponent->SetValue<UBlackboardKeyType_Enum>(StateKeyID, EGurneyMonsterStates::GMS_Pursue);
-				BlackboardComponent->SetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID, Origin);
-			}
-		}
+		MonsterBlackboard.SetWanderBiasStartRadius(DesiredWanderBiasRadius);
+		ClearStateTimers();
+		SetTimeSincePursue(-1);
+	}
+}
 
-		//dont go into search mode while in a more agressive mode
-		if (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_GoToPlayer &&
-			BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_Pursue)
-		{
-			if (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_Search)
-			{
-				AMonster* Monster = Cast<AMonster>(GetPawn());
-				Monster->PlayMonsterSound("PlayMonsterSearchLoop");
-			}
-
-			//investigate the general area
-			BlackboardComponent->SetValue<UBlackboardKeyType_Enum>(StateKeyID, EGurneyMonsterStates::GMS_Search);
-			BlackboardComponent->SetValue<UBlackboardKeyType_Float>(WanderRadiusKeyID, DesiredSearchRadius);
-			BlackboardComponent->SetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID, GetPawn()->GetActorLocation());
-			BlackboardComponent->SetValue<UBlackboardKeyType_Float>(TimeSincePursueKeyID, 0.0f);
-			BlackboardComponent->SetValue<UBlackboardKeyType_Vector>(SearchCenterPointKeyID, Origin);
+template <>
+void AMonsterAIController::OnEnterState<MonsterStateRules::EState::Pursue>(const MonsterStateRules::FTransition& Transition, const FVector& Location)
+{
+	MonsterBlackboard.SetState(EGurneyMonsterStates::GMS_Pursue);
 
-		}
+	//pursuing after go to player keeps heading for where the player was
+	if (Transition.Entry == MonsterStateRules::EEntry::Pursue)
+	{
+		MonsterBlackboard.SetTargetLocation(Location);
 	}
 }
 
-void AMonsterAIController::SetFollowPlayer()
+template <>
+void AMonsterAIController::OnEnterState<MonsterStateRules::EState::GoToPlayer>(const MonsterStateRules::FTransition& Transition, const FVector& Location)
 {
-	if (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_GoToPlayer &&
-	BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) != EGurneyMonsterStates::GMS_Pursue)
+	MonsterBlackboard.SetHowLongToGoToPlayer(Transition.GoToPlayerDuration);
+	StartGoToPlayer(Transition.GoToPlayerDuration);
+}
+
+template <>
+void AMonsterAIController::OnEnterState<MonsterStateRules::EState::Search>(const MonsterStateRules::FTransition& Transition, const FVector& Location)
+{
+	MonsterBlackboard.SetState(EGurneyMonsterStates::GMS_Search);
+	MonsterBlackboard.SetWanderRadius(DesiredSearchRadius);
+	MonsterBlackboard.SetTargetLocation(GetPawn()->GetActorLocation());
+	MonsterBlackboard.SetSearchCenterPoint(Location);
+
+	//the pursuit is over, search until the timer runs out
+	SetTimeSincePursue(0.0f);
+	GetWorldTimerManager().SetTimer(SearchTimerHandle, this, &AMonsterAIController::OnSearchTimeUp, DesiredSearchDuration, false);
+}
+
+void AMonsterAIController::PlayTransitionSound(const MonsterStateRules::ESound Sound, const FVector& Location)
+{
+	AMonster* Monster = Cast<AMonster>(GetPawn());
+	switch (Sound)
 	{
-		// play transition sound
-		AMonster* Monster = Cast<AMonster>(GetPawn());
-		Monster->PlayMonsterSound("PlayMonsterDetected");
+	case MonsterStateRules::ESound::Detected:	Monster->PlayMonsterSound("PlayMonsterDetected"); break;
+	case MonsterStateRules::ESound::SearchLoop:	Monster->PlayMonsterSound("PlayMonsterSearchLoop"); break;
+	case MonsterStateRules::ESound::IdleLoop:	Monster->PlayMonsterSound("PlayMonsterIdleLoop"); break;
+	default: break;
 	}
-	GEngine->AddOnScreenDebugMessage(-1, 10.0f, FColor::Purple, "SetFollowPlayer");
-	BlackboardComponent->SetValue<UBlackboardKeyType_Enum>(StateKeyID, EGurneyMonsterStates::GMS_GoToPlayer);
-	BlackboardComponent->SetValue<UBlackboardKeyType_Float>(GoToPlayerTotalTimeKeyID, 0);
 }
 
-void AMonsterAIController::AIOnPlayerDeath()
+void AMonsterAIController::ApplyTransition(const MonsterStateRules::FTransition& Transition, const FVector& Location)
 {
-	BlackboardComponent->SetValue<UBlackboardKeyType_Enum>(StateKeyID, EGurneyMonsterStates::GMS_Wander);
-	BlackboardComponent->SetValue<UBlackboardKeyType_Float>(WanderRadiusKeyID, DesiredWanderRadius);
-	BlackboardComponent->SetValue<UBlackboardKeyType_Vector>(TargetLocationKeyID, GetPawn()->GetActorLocation());
-	BlackboardComponent->SetValue<UBlackboardKeyType_Float>(WanderBiasStartRadiusKeyID, DesiredWanderBiasRadius);
-	BlackboardComponent->SetValue<UBlackboardKeyType_Float>(TimeSincePursueKeyID, -1);
-	BlackboardComponent->SetValue<UBlackboardKeyType_Float>(GoToPlayerTotalTimeKeyID, 0);
+	const MonsterStateRules::EState From = static_cast<MonsterStateRules::EState>(MonsterBlackboard.GetState());
+	MonsterStateRules::TStateMachine<AMonsterAIController>::Apply(*this, From, Transition, Location);
 }
 
-void AMonsterAIController::ActivateMonster()
+void AMonsterAIController::GetHordeMember(FMonsterHordeMember& OutMember) const
 {
-	if (BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID) == EGurneyMonsterStates::GMS_Inactive)
-	{ 
-		// play transition sound
-		AMonster* Monster = Cast<AMonster>(GetPawn());
-		Monster->PlayMonsterSound("PlayMonsterDetected");
-		BlackboardComponent->SetValue<UBlackboardKeyType_Enum>(StateKeyID, EGurneyMonsterStates::GMS_Wander);
-		BlackboardComponent->SetValue<UBlackboardKeyType_Float>(GoToPlayerTotalTimeKeyID, 0);
+	OutMember.State = MonsterBlackboard.GetState();
+	OutMember.TargetLocation = MonsterBlackboard.GetTargetLocation();
+	OutMember.SearchCenter = MonsterBlackboard.GetSearchCenterPoint();
+	OutMember.WanderRadius = MonsterBlackboard.GetWanderRadius();
+	OutMember.WalkSpeed = MonsterBlackboard.GetWalkSpeed();
+	OutMember.TimeSincePursue = GetTimeSincePursue();
+
+	//only the timer of the current state matters, the other one ignores the state it fires in
+	const float SearchTimeRemaining = GetWorldTimerManager().GetTimerRemaining(SearchTimerHandle);
+	const float GoToPlayerTimeRemaining = GetWorldTimerManager().GetTimerRemaining(GoToPlayerTimerHandle);
+	OutMember.StateTimeRemaining = FMath::Max(OutMember.State == EGurneyMonsterStates::GMS_Search ? SearchTimeRemaining : GoToPlayerTimeRemaining, 0.0f);
+}
+
+void AMonsterAIController::SetHordeMember(const FMonsterHordeMember& Member)
+{
+	if (!MonsterBlackboard.IsValid()) { return; }
+
+	MonsterBlackboard.SetState(Member.State);
+	MonsterBlackboard.SetTargetLocation(Member.TargetLocation);
+	MonsterBlackboard.SetSearchCenterPoint(Member.SearchCenter);
+	MonsterBlackboard.SetWanderRadius(Member.WanderRadius);
+	MonsterBlackboard.SetWalkSpeed(Member.WalkSpeed);
+	SetTimeSincePursue(Member.TimeSincePursue);
+
+	if (Member.StateTimeRemaining <= 0) { return; }
+	if (Member.State == EGurneyMonsterStates::GMS_Search)
+	{
+		GetWorldTimerManager().SetTimer(SearchTimerHandle, this, &AMonsterAIController::OnSearchTimeUp, Member.StateTimeRemaining, false);
 	}
-	else
+	else if (Member.State == EGurneyMonsterStates::GMS_GoToPlayer)
 	{
-		//set status and new target
-		SetFollowPlayer();
+		GetWorldTimerManager().SetTimer(GoToPlayerTimerHandle, this, &AMonsterAIController::OnGoToPlayerTimeUp, Member.StateTimeRemaining, false);
 	}
 }
 
-uint8 AMonsterAIController::GetMonsterCurrentState() const
+void AMonsterAIController::ClearStateTimers()
 {
-	return BlackboardComponent->GetValue<UBlackboardKeyType_Enum>(StateKeyID);
+	GetWorldTimerManager().ClearTimer(SearchTimerHandle);
+	GetWorldTimerManager().ClearTimer(GoToPlayerTimerHandle);
 }
 
-FVector AMonsterAIController::GetClosestRunawayLocation()
+void AMonsterAIController::OnPlayerSafetyChanged(const bool bPlayerSafe)
 {
-	const FVector MonsterLocation = GetPawn()->GetActorLocation();
+	//other states already ignore a safe player, and an unsafe one is picked up at the next wander target
+	if (!bPlayerSafe || !GetPawn() || MonsterBlackboard.GetState() != EGurneyMonsterStates::GMS_Wander) { return; }
+
+	//a wander target still being picked would replace the runaway location
+	AbortTargetLocationQuery();
+	if (QueryScheduler)
+	{
+		QueryScheduler->Cancel(this);
+	}
 
-	if (RunAwayLocations.Num() < 1) { return GetPawn()->GetActorLocation(); }
+	MonsterBlackboard.SetTargetLocation(GetFarthestRunawayLocationFromPlayer());
+}
+
+float AMonsterAIController::GetTimeSincePursue() const
+{
+	return PursueEndTime < 0 ? -1.0f : GetWorld()->GetTimeSeconds() - PursueEndTime;
+}
+
+void AMonsterAIController::SetTimeSincePursue(const float Seconds)
+{
+	PursueEndTime = Seconds < 0 ? -1.0f : GetWorld()->GetTimeSeconds() - Seconds;
+}
+
+bool AMonsterAIController::GetRandomReachablePoint(const FVector& Origin, const float Radius, FVector& OutPoint)
+{
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!NavSys || !NavSys->MainNavData) { return false; }
+
+	if (!bDeterministic)
+	{
+		MonsterAIStats::CountNavQuery();
+		return UNavigationSystemV1::K2_GetRandomReachablePointInRadius(GetWorld(), Origin, OutPoint, Radius, NavSys->MainNavData, nullptr);
+	}
 
-	FVector Location = MonsterLocation;
-	float Distance = INT_MAX;
-	for (int i = 0; i < RunAwayLocations.Num(); ++i)
+	//pick points in the circle from the seeded stream until one lands on the navmesh
+	for (int32 Attempt = 0; Attempt < 8; ++Attempt)
 	{
-		const float NewDistance = FVector::Distance(MonsterLocation, RunAwayLocations[i]);
-		if (NewDistance < Distance && NewDistance > 50)
+		const FVector Candidate = GetRandomPointInCircle(Origin, Radius);
+		FNavLocation Projected;
+		MonsterAIStats::CountNavQuery();
+		if (NavSys->ProjectPointToNavigation(Candidate, Projected, FVector(Radius * 0.25f, Radius * 0.25f, 500.0f), NavSys->MainNavData))
 		{
-			Location = RunAwayLocations[i];
-			Distance = NewDistance;
+			OutPoint = Projected.Location;
+			return true;
 		}
 	}
+	return false;
+}
+
+void AMonsterAIController::AddRandomTargetCandidates(const FVector& Origin, const float Radius, TArray<FVector>& Candidates)
+{
+	for (int32 i = 0; i < AsyncCandidatesPerArea; ++i)
+	{
+		Candidates.Add(GetRandomPointInCircle(Origin, Radius));
+	}
+}
+
+FVector AMonsterAIController::GetRandomPointInCircle(const FVector& Origin, const float Radius)
+{
+	const float Angle = RandomStream.FRandRange(0.0f, 2.0f * PI);
+	const float Distance = Radius * FMath::Sqrt(RandomStream.GetFraction());
+	return Origin + FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 0.0f);
+}
+
+bool AMonsterAIController::GetPooledTargetPoint(const FVector& Center, const float Radius, FVector& OutPoint)
+{
+	if (!PointPool || !GetPawn()) { return false; }
+
+	if (!PointPool->GetRandomPoint(GetPawn()->GetActorLocation(), Center, Radius, RandomStream, OutPoint)) { return false; }
+
+	//nothing to hand to the move task, it finds the move path itself
+	SetTargetPath(OutPoint, nullptr);
+	return true;
+}
+
+uint8 AMonsterAIController::GetMonsterCurrentState() const
+{
+	return MonsterBlackboard.GetState();
+}
 
-	return Location;
+const TArray<FVector>& AMonsterAIController::GetRunAwayLocations() const
+{
+	static const TArray<FVector> NoLocations;
+	return RunAwaySystem ? RunAwaySystem->GetLocations() : NoLocations;
 }
 
-FVector AMonsterAIController::GetFarthestRunawayLocation()
+FVector AMonsterAIController::GetClosestRunawayLocation() const
 {
 	const FVector MonsterLocation = GetPawn()->GetActorLocation();
+	if (!RunAwaySystem) { return MonsterLocation; }
+
+	//ignore the point the monster is already standing on
+	const int32 Closest = RunAwaySystem->FindClosest(MonsterLocation, 50, bUseNavDistanceTable);
+	return Closest != INDEX_NONE ? RunAwaySystem->GetLocations()[Closest] : MonsterLocation;
+}
+
+FVector AMonsterAIController::GetFarthestRunawayLocation() const
+{
+	const FVector MonsterLocation = GetPawn()->GetActorLocation();
+	if (!RunAwaySystem) { return MonsterLocation; }
+
+	const int32 Farthest = RunAwaySystem->FindFarthest(MonsterLocation, bUseNavDistanceTable);
+	return Farthest != INDEX_NONE ? RunAwaySystem->GetLocations()[Farthest] : MonsterLocation;
+}
+
+FVector AMonsterAIController::GetFarthestRunawayLocationFromPlayer() const
+{
+	const AActor* Player = Registry ? Registry->GetPlayer() : nullptr;
+	if (!Player || !RunAwaySystem) { return GetFarthestRunawayLocation(); }
+
+	const int32 Farthest = RunAwaySystem->FindFarthest(Player->GetActorLocation(), bUseNavDistanceTable);
+	return Farthest != INDEX_NONE ? RunAwaySystem->GetLocations()[Farthest] : GetPawn()->GetActorLocation();
+}
+
+void AMonsterAIController::RequestTargetLocationAsync(const TArray<FVector>& Candidates)
+{
+	//a newer request replaces whatever is still in flight
+	AbortTargetLocationQuery();
+
+	PendingTargetCandidates = Candidates;
+	PendingTargetQueryState = MonsterBlackboard.GetState();
+	PendingTargetQueryStartTime = FPlatformTime::Seconds();
+	bTargetQueryInFlight = true;
+	INC_DWORD_STAT(STAT_MonsterNavQueriesInFlight);
+
+	SubmitNextTargetCandidate();
+}
+
+void AMonsterAIController::AbortTargetLocationQuery()
+{
+	if (!bTargetQueryInFlight) { return; }
+
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (NavSys && IsTargetQueryPending())
+	{
+		NavSys->AbortAsyncFindPathRequest(PendingTargetQueryID);
+	}
+	bTargetQueryInFlight = false;
+	DEC_DWORD_STAT(STAT_MonsterNavQueriesInFlight);
+
+	PendingTargetQueryID = INVALID_NAVQUERYID;
+	PendingTargetCandidates.Reset();
+}
+
+void AMonsterAIController::SubmitNextTargetCandidate()
+{
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!NavSys || !NavSys->MainNavData || !GetPawn())
+	{
+		AbortTargetLocationQuery();
+		return;
+	}
+
+	//nothing left to test: last resort is a runaway location
+	if (PendingTargetCandidates.Num() < 1)
+	{
+		FinishTargetQuery(GetClosestRunawayLocation());
+		return;
+	}
+
+	//another monster may already have found this path
+	if (const FNavPathSharedPtr Cached = PathCache ? PathCache->FindCachedPath(this, GetPawn()->GetActorLocation(), PendingTargetCandidates[0]) : nullptr)
+	{
+		FinishTargetQuery(Cached->GetPathPoints().Last().Location, Cached);
+		return;
+	}
 
-	if (RunAwayLocations.Num() < 1) { return GetPawn()->GetActorLocation(); }
+	//same query FindPathToLocationSynchronously would run, just off the game thread
+	const FPathFindingQuery Query(this, *NavSys->MainNavData, GetPawn()->GetActorLocation(), PendingTargetCandidates[0]);
+	MonsterAIStats::CountNavQuery();
+	PendingTargetQueryID = NavSys->FindPathAsync(GetNavAgentPropertiesRef(), Query, FNavPathQueryDelegate::CreateUObject(this, &AMonsterAIController::OnTargetPathQueryFinished));
+	INC_DWORD_STAT(STAT_MonsterNavQueriesSubmitted);
+}
 
-	FVector Location = RunAwayLocations[0];
-	float Distance = 0;
-	for (int i = 0; i < RunAwayLocations.Num(); ++i)
+void AMonsterAIController::OnTargetPathQueryFinished(uint32 QueryID, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	//stale result from a query that was aborted or replaced
+	if (QueryID != PendingTargetQueryID) { return; }
+
+	//the monster changed state while the query was in flight, so the target it was choosing no longer applies
+	if (MonsterBlackboard.GetState() != PendingTargetQueryState)
 	{
-		const float NewDistance = FVector::Distance(MonsterLocation, RunAwayLocations[i]);
-		if (NewDistance > Distance)
+		AbortTargetLocationQuery();
+		return;
+	}
+
+	//determine if there is a valid path to the candidate
+	const bool bValid = Result == ENavigationQueryResult::Success && Path.IsValid() && Path->IsValid() && !Path->IsPartial();
+	if (bValid)
+	{
+		if (PathCache)
 		{
-			Location = RunAwayLocations[i];
-			Distance = NewDistance;
+			PathCache->AddPath(Path->GetPathPoints()[0].Location, PendingTargetCandidates[0], Path);
 		}
+
+		//candidates from AddRandomTargetCandidates may be off the navmesh, the path ends where the query projected them to
+		FinishTargetQuery(Path->GetPathPoints().Last().Location, Path);
+		return;
+	}
+
+	//try the next candidate, or fall back to a runaway location
+	PendingTargetCandidates.RemoveAt(0, 1, false);
+	SubmitNextTargetCandidate();
+}
+
+void AMonsterAIController::FinishTargetQuery(const FVector& NewTarget, FNavPathSharedPtr Path /*= nullptr*/)
+{
+	if (bTargetQueryInFlight)
+	{
+		bTargetQueryInFlight = false;
+		DEC_DWORD_STAT(STAT_MonsterNavQueriesInFlight);
+	}
+	PendingTargetQueryID = INVALID_NAVQUERYID;
+	PendingTargetCandidates.Reset();
+
+	LastTargetQueryLatency = (FPlatformTime::Seconds() - PendingTargetQueryStartTime) * 1000.0;
+	SET_FLOAT_STAT(STAT_MonsterNavQueryLatency, LastTargetQueryLatency);
+
+	//set the target location to the newly chosen target point, keeping the path so the move doesn't search for it again
+	SetTargetPath(NewTarget, Path);
+	MonsterBlackboard.SetTargetLocation(NewTarget);
+}
+
+void AMonsterAIController::ScheduleQuery(TFunction<void()> Query)
+{
+	//a query run on a later frame would make deterministic runs depend on frame timing
+	if (!QueryScheduler || bDeterministic)
+	{
+		Query();
+		return;
 	}
 
-	return Location;
+	//chasing the player matters more than picking the next wander point
+	EMonsterQueryPriority Priority;
+	switch (MonsterBlackboard.GetState())
+	{
+	case EGurneyMonsterStates::GMS_GoToPlayer:
+		Priority = EMonsterQueryPriority::GoToPlayer;
+		break;
+	case EGurneyMonsterStates::GMS_Pursue:
+		Priority = EMonsterQueryPriority::Pursue;
+		break;
+	case EGurneyMonsterStates::GMS_Search:
+		Priority = EMonsterQueryPriority::Search;
+		break;
+	default:
+		Priority = EMonsterQueryPriority::Wander;
+		break;
+	}
+
+	const uint8 State = MonsterBlackboard.GetState();
+	QueryScheduler->Enqueue(this, Priority, [this, State, Query = MoveTemp(Query)]()
+	{
+		//the monster changed state while the query waited, so the work no longer applies
+		if (!GetPawn() || MonsterBlackboard.GetState() != State) { return; }
+		Query();
+	});
+}
+
+bool AMonsterAIController::IsQueryScheduled() const
+{
+	return QueryScheduler && QueryScheduler->IsQueued(this);
+}
+
+void AMonsterAIController::SetTargetPath(const FVector& Goal, FNavPathSharedPtr Path)
+{
+	TargetPathGoal = Goal;
+	TargetPath = Path.IsValid() && Path->IsValid() && !Path->IsPartial() ? Path : nullptr;
+}
+
+FNavPathSharedPtr AMonsterAIController::GetTargetPath(const FVector& Goal) const
+{
+	if (!TargetPath.IsValid() || !TargetPath->IsValid() || !TargetPath->IsUpToDate() || !GetPawn()) { return nullptr; }
+
+	//the path has to lead to the location being moved to
+	if (!TargetPathGoal.Equals(Goal, 1.0f)) { return nullptr; }
+
+	//the path has to start roughly where the monster is now. It was found when the monster arrived within 150 of its last target
+	if (FVector::DistSquared(TargetPath->GetPathPoints()[0].Location, GetPawn()->GetActorLocation()) > FMath::Square(150.0f)) { return nullptr; }
+
+	return TargetPath;
 }
 
-FVector AMonsterAIController::GetFarthestRunawayLocationFromPlayer()
+FNavPathSharedPtr AMonsterAIController::FindPathTo(const FVector& Goal)
 {
-	const FVector PlayerLocation = UGameplayStatics::GetPlayerCharacter(GetWorld(), 0)->GetActorLocation();
+	if (!GetPawn()) { return nullptr; }
+	if (PathCache) { return PathCache->FindPath(this, GetPawn()->GetActorLocation(), Goal); }
 
-	if (RunAwayLocations.Num() < 1) { return GetPawn()->GetActorLocation(); }
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!NavSys || !NavSys->MainNavData) { return nullptr; }
+
+	MonsterAIStats::CountNavQuery();
+	return NavSys->FindPathSync(FPathFindingQuery(this, *NavSys->MainNavData, GetPawn()->GetActorLocation(), Goal)).Path;
+}
 
-	FVector Location = RunAwayLocations[0];
-	float Distance = 0;
-	for (int i = 0; i < RunAwayLocations.Num(); ++i)
+EPathFollowingRequestResult::Type AMonsterAIController::MoveToTargetLocation(const FVector& Goal, FNavPathSharedPtr Path)
+{
+	//the path is handed off once, a later move to the same location has to look again
+	TargetPath = nullptr;
+
+	if (!Path.IsValid())
 	{
-		const float NewDistance = FVector::Distance(PlayerLocation, RunAwayLocations[i]);
-		if (NewDistance > Distance)
+		//already on the way there, keep following the current path instead of finding it again
+		const FNavPathSharedPtr CurrentPath = GetPathFollowingComponent() ? GetPathFollowingComponent()->GetPath() : nullptr;
+		if (GetMoveStatus() == EPathFollowingStatus::Moving && CurrentPath.IsValid() && CurrentPath->IsValid() && !CurrentPath->IsPartial()
+			&& FVector::Dist2D(CurrentPath->GetEndLocation(), Goal) < 5.f)
 		{
-			Location = RunAwayLocations[i];
-			Distance = NewDistance;
+			INC_DWORD_STAT(STAT_MonsterMoveRequestsSkipped);
+			return EPathFollowingRequestResult::RequestSuccessful;
 		}
+
+		MonsterAIStats::CountNavQuery();
+		return MoveToLocation(Goal, 5.f, true, true, false, true, 0, true);
 	}
 
-	return Location;
+	//same request MoveToLocation builds, but skipping its pathfinding
+	FAIMoveRequest MoveReq(Goal);
+	MoveReq.SetUsePathfinding(true);
+	MoveReq.SetAllowPartialPath(true);
+	MoveReq.SetProjectGoalLocation(false);
+	MoveReq.SetNavigationFilter(GetDefaultNavigationFilterClass());
+	MoveReq.SetAcceptanceRadius(5.f);
+	MoveReq.SetReachTestIncludesAgentRadius(true);
+	MoveReq.SetCanStrafe(true);
+
+	//start from where the monster is standing instead of where it was when the path was found.
+	//the path can be shared with other monsters through the path cache, so the start is moved on a copy
+	TSharedRef<FNavMeshPath> Copy = MakeShared<FNavMeshPath>();
+	Copy->GetPathPoints() = Path->GetPathPoints();
+	Copy->GetPathPoints()[0].Location = GetPawn()->GetActorLocation();
+	if (const FNavMeshPath* NavMeshPath = Path->CastPath<FNavMeshPath>())
+	{
+		Copy->PathCorridor = NavMeshPath->PathCorridor;
+	}
+	Copy->SetNavigationDataUsed(Path->GetNavigationDataUsed());
+	Copy->SetQuerier(this);
+	Copy->MarkReady();
+
+	const FAIRequestID MoveId = RequestMove(MoveReq, Copy);
+	return MoveId.IsValid() ? EPathFollowingRequestResult::RequestSuccessful : EPathFollowingRequestResult::Failed;
 }
 
+bool AMonsterAIController::RepairTargetPath(const FVector& NewGoal)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterChasePathRepair);
+
+	UPathFollowingComponent* PathFollowing = GetPathFollowingComponent();
+	const FNavPathSharedPtr CurrentPath = PathFollowing ? PathFollowing->GetPath() : nullptr;
+	if (!GetPawn() || GetMoveStatus() != EPathFollowingStatus::Moving || !CurrentPath.IsValid() || !CurrentPath->IsValid() || CurrentPath->IsPartial()) { return false; }
+
+	const FNavMeshPath* CurrentNavMeshPath = CurrentPath->CastPath<FNavMeshPath>();
+	if (!CurrentNavMeshPath) { return false; }
+
+	//only worth it when the goal moved a short way further along. If it moved back towards the monster, extending would walk it past and back again
+	const FVector MonsterLocation = GetPawn()->GetActorLocation();
+	const FVector OldGoal = CurrentPath->GetEndLocation();
+	if (FVector::DistSquared(OldGoal, NewGoal) > FMath::Square(MaxPathRepairDistance)) { return false; }
+	if (FVector::DistSquared(MonsterLocation, NewGoal) < FVector::DistSquared(MonsterLocation, OldGoal)) { return false; }
+
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!NavSys || !NavSys->MainNavData) { return false; }
+
+	//short search from the old end instead of a full one from the monster
+	const FPathFindingQuery Query(this, *NavSys->MainNavData, OldGoal, NewGoal);
+	MonsterAIStats::CountNavQuery();
+	const FPathFindingResult Extension = NavSys->FindPathSync(GetNavAgentPropertiesRef(), Query);
+	if (!Extension.IsSuccessful() || Extension.IsPartial()) { return false; }
+
+	const FNavMeshPath* ExtensionNavMeshPath = Extension.Path->CastPath<FNavMeshPath>();
+	if (!ExtensionNavMeshPath) { return false; }
+
+	//the monster's location, the points of the current path it hasn't reached yet, then the extension without its first point (the old end)
+	TSharedRef<FNavMeshPath> Repaired = MakeShared<FNavMeshPath>();
+	TArray<FNavPathPoint>& Points = Repaired->GetPathPoints();
+	const TArray<FNavPathPoint>& CurrentPoints = CurrentPath->GetPathPoints();
+	const TArray<FNavPathPoint>& ExtensionPoints = Extension.Path->GetPathPoints();
+	const int32 NextPoint = FMath::Clamp(PathFollowing->GetCurrentPathIndex() + 1, 1, CurrentPoints.Num());
+	Points.Reserve(1 + CurrentPoints.Num() - NextPoint + ExtensionPoints.Num() - 1);
+	Points.Add(FNavPathPoint(MonsterLocation, CurrentPoints[NextPoint - 1].NodeRef));
+	Points.Append(CurrentPoints.GetData() + NextPoint, CurrentPoints.Num() - NextPoint);
+	Points.Append(ExtensionPoints.GetData() + 1, ExtensionPoints.Num() - 1);
+
+	//same for the corridor, from the poly the monster is walking through
+	const int32 CorridorStart = FMath::Max(CurrentNavMeshPath->PathCorridor.Find(CurrentPoints[NextPoint - 1].NodeRef), 0);
+	Repaired->PathCorridor.Append(CurrentNavMeshPath->PathCorridor.GetData() + CorridorStart, CurrentNavMeshPath->PathCorridor.Num() - CorridorStart);
+	Repaired->PathCorridor.Append(ExtensionNavMeshPath->PathCorridor.Num() > 0 ? ExtensionNavMeshPath->PathCorridor.GetData() + 1 : nullptr, FMath::Max(ExtensionNavMeshPath->PathCorridor.Num() - 1, 0));
+
+	Repaired->SetNavigationDataUsed(NavSys->MainNavData);
+	Repaired->SetQuerier(this);
+	Repaired->MarkReady();
+
+	INC_DWORD_STAT(STAT_MonsterChasePathRepairs);
+	SetTargetPath(NewGoal, Repaired);
+	return true;
+}
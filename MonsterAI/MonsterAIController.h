@@ -4,6 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "AIController.h"
+#include "MonsterBlackboard.h"
+#include "MonsterDecisionLog.h"
+#include "MonsterStateRules.h"
+#include "MonsterTelemetry.h"
 #include "MonsterAIController.generated.h"
 
 UCLASS()
@@ -27,6 +31,79 @@ protected:
 	float DesiredPursueInsteadOfSearchRadius = 400.0f;
 	UPROPERTY(EditAnywhere)
 	float DesiredSearchDuration = 30.0f;
+	/**
+	 * If true, the wander and search services test their next target point with a non-blocking path query
+	 * instead of pathfinding synchronously on the game thread
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bUseAsyncNavQueries = true;
+	/**
+	 * If true, runaway locations are ranked by baked navmesh walking distance instead of straight-line distance
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bUseNavDistanceTable = true;
+	/**
+	 * If true, wander and search pick their targets from the level's pool of known reachable points instead of sampling and path testing
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bUseReachablePointPool = true;
+	/**
+	 * If true, random choices come from RandomSeed, the game runs at a fixed time step, and every decision is recorded
+	 * to Saved/MonsterAI so two runs can be compared. Also turned on by the -MonsterAISeed=<seed> command line switch
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bDeterministic = false;
+	/**
+	 * Seed for the monster's random choices in deterministic mode
+	 */
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bDeterministic"))
+	int32 RandomSeed = 0;
+	/**
+	 * Length of a frame in seconds in deterministic mode
+	 */
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bDeterministic"))
+	float DeterministicTimeStep = 1.0f / 30.0f;
+	/**
+	 * If true, going to the player heads for where the player will be when the monster gets there instead of where they are now
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bPredictPlayerIntercept = true;
+	/**
+	 * Farthest ahead in seconds the player's movement is predicted
+	 */
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bPredictPlayerIntercept"))
+	float MaxInterceptPredictionTime = 1.5f;
+	/**
+	 * While going to the player, the target is only moved once the new intercept point is this far from it
+	 */
+	UPROPERTY(EditAnywhere)
+	float ChaseRepathDistance = 200.0f;
+	/**
+	 * A moved chase target is reached by extending the current path from its old end, if the two are closer than this.
+	 * Otherwise the path is found again from scratch
+	 */
+	UPROPERTY(EditAnywhere)
+	float MaxPathRepairDistance = 800.0f;
+	/**
+	 * If true, the monster notices the player by sight as well as by sound
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bCanSeePlayer = true;
+	/**
+	 * Farthest the monster can see the player from
+	 */
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bCanSeePlayer"))
+	float SightRange = 1500.0f;
+	/**
+	 * Half the angle of the monster's view cone, in degrees
+	 */
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bCanSeePlayer", ClampMin = "0", ClampMax = "180"))
+	float SightHalfAngle = 60.0f;
+	/**
+	 * Time in seconds to go to the player after seeing them. 0 or less pursues where they were seen instead
+	 */
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bCanSeePlayer"))
+	float SightGoToPlayerTime = 3.0f;
 #pragma endregion
 	
 protected:
@@ -43,35 +120,153 @@ protected:
 	class UBehaviorTreeComponent* BehaviorTreeComponent;
 
 	/**
-	 * List of locations that the monster can "run away" to
-	 * These are designer placed objects that are in convenient locations
+	 * The level's runaway locations, with the index and walking distance table over them that every monster shares
+	 */
+	UPROPERTY(Transient)
+	class UMonsterRunAwaySystem* RunAwaySystem;
+
+	/**
+	 * The world's actor registry, used to find the player and the runaway locations
+	 */
+	UPROPERTY(Transient)
+	class UWorldActorRegistry* Registry;
+
+	FDelegateHandle PlayerSafetyChangedHandle;
+
+	FDelegateHandle TelemetryEnabledChangedHandle;
+
+	/**
+	 * The noise bus this monster listens to. Also holds the level's acoustic graph
+	 */
+	UPROPERTY(Transient)
+	class UMonsterNoiseBus* NoiseBus;
+
+	/**
+	 * Checks whether this monster can see the player
+	 */
+	UPROPERTY(Transient)
+	class UMonsterVisionSystem* VisionSystem;
+
+	/**
+	 * The level's pool of reachable navmesh points
 	 */
-	TArray<FVector> RunAwayLocations;
+	UPROPERTY(Transient)
+	class UMonsterReachablePointPool* PointPool;
 
 	/**
-	 * Reference to current player's playercomponent. 
+	 * Runs the monster's expensive queries within the per-frame budget shared by every monster
 	 */
-	UPROPERTY()
-	class UPlayerCharacterComponent* Player;
+	UPROPERTY(Transient)
+	class UMonsterAIQueryScheduler* QueryScheduler;
+
+	/**
+	 * Paths found by any monster, shared by all of them
+	 */
+	UPROPERTY(Transient)
+	class UMonsterPathCache* PathCache;
+
+#pragma region Async Target Query
+	/**
+	 * Candidate target points that have not been path tested yet, in order of preference
+	 */
+	TArray<FVector> PendingTargetCandidates;
+
+	/**
+	 * ID of the path query currently in flight, INVALID_NAVQUERYID if there is none
+	 */
+	uint32 PendingTargetQueryID = INVALID_NAVQUERYID;
+
+	/**
+	 * True from RequestTargetLocationAsync until its result is applied or it is aborted, while it counts towards STAT_MonsterNavQueriesInFlight.
+	 * PendingTargetQueryID alone doesn't say, it is invalid between candidates and when a cached path answers without a query
+	 */
+	bool bTargetQueryInFlight = false;
+
+	/**
+	 * Monster state when the pending query was requested. The result is thrown away if the state has changed since
+	 */
+	uint8 PendingTargetQueryState = 0;
+
+	/**
+	 * Time in seconds (platform time) when the pending target query was requested
+	 */
+	double PendingTargetQueryStartTime = 0.0;
+
+	/**
+	 * Time in milliseconds between requesting the last finished target query and its result being applied
+	 */
+	float LastTargetQueryLatency = 0.0f;
+#pragma endregion
+
+#pragma region Target Path Handoff
+	/**
+	 * Path that has already been validated to TargetPathGoal. Handed from the service that chose the target to the move task,
+	 * so the move request doesn't pathfind to the same point again
+	 */
+	FNavPathSharedPtr TargetPath;
+
+	/**
+	 * The target location TargetPath leads to
+	 */
+	FVector TargetPathGoal;
+#pragma endregion
+
+#pragma region Determinism
+	/**
+	 * Source of the monster's random choices. Seeded from RandomSeed in deterministic mode
+	 */
+	FRandomStream RandomStream;
+
+	/**
+	 * Every state transition and target choice, recorded in deterministic mode
+	 */
+	FMonsterDecisionLog DecisionLog;
+
+	/**
+	 * True while the monster holds the game's fixed time step. The game goes back to its own time step settings once
+	 * the last deterministic monster ends play
+	 */
+	bool bHoldsFixedTimeStep = false;
+#pragma endregion
+
+#pragma region Telemetry
+	/**
+	 * The monster's most recent state changes and sounds heard, for the telemetry viewer. Empty unless telemetry is on
+	 */
+	FMonsterTelemetry Telemetry;
+
+	/**
+	 * True while OnDecisionKeyChanged observes the blackboard. Only in deterministic mode or while telemetry is on
+	 */
+	bool bObservingDecisions = false;
+#pragma endregion
+
+#pragma region State Timers
+	/**
+	 * World time the monster last stopped pursuing, or -1 if the timer isn't running. Replaces counting TimeSincePursue up every tick
+	 */
+	float PursueEndTime = -1.0f;
+
+	/**
+	 * Fires once the monster has searched for DesiredSearchDuration
+	 */
+	FTimerHandle SearchTimerHandle;
+
+	/**
+	 * Fires once the monster has gone to the player for HowLongToGoToPlayer
+	 */
+	FTimerHandle GoToPlayerTimerHandle;
+#pragma endregion
 
 #pragma region Blackboard Keys
-public:
-	uint8 StateKeyID;
-	uint8 TargetLocationKeyID;
-	uint8 WanderRadiusKeyID;
-	uint8 WanderBiasStartRadiusKeyID;
-	uint8 TimeSincePursueKeyID;
-	uint8 GoToPlayerTotalTimeKeyID;
-	uint8 WalkSpeedKeyID;
-	uint8 HowLongToGoToPlayerKeyID;
-	uint8 PursueInsteadOfSearchRadiusKeyID;
-	uint8 SearchCenterPointKeyID;
+	/**
+	 * Typed view of BlackboardComponent, with the IDs of every key in MONSTER_BLACKBOARD_KEYS
+	 */
+	FMonsterBlackboard MonsterBlackboard;
 #pragma endregion
 
 public:
 	AMonsterAIController();
-	
-	virtual void Tick(float DeltaTime) override;
 
 	/// <summary>
 	/// Additional logic to execute after this controller has possessed the monster character
@@ -94,7 +289,20 @@ public:
 	 * @param bOverrideSafeZone If true, the monster will pursue the player even if they are in a safe zone after hearing the sound
 	 */
 	virtual void ReportSound(FVector Origin, float HearableRadius, bool IsOngoing = false, bool IsAudioLog = false, float HowLongToGoToPlayer = -1.0f, bool bOverrideSafeZone = false);
+
+	/**
+	 * Handle every sound reported to the noise bus during the last frame. Checks that only depend on the monster and player
+	 * (inactive, player in a safe zone) are done once for the whole batch
+	 * @param Events The sounds, already merged by the noise bus
+	 */
+	virtual void HandleNoiseBatch(const TArray<struct FMonsterNoiseEvent>& Events);
 	
+	/**
+	 * Tell the monster it saw the player. Reacts like hearing the player up close
+	 * @param PlayerLocation Where the player was seen
+	 */
+	virtual void ReportSight(const FVector& PlayerLocation);
+
 	/**
 	 * Set the monster to follow the player's position for a set amount of time
 	 */
@@ -115,11 +323,172 @@ public:
 	 * Returns the list of "runaway locations"
 	 * @return The list
 	 */
-	TArray<FVector> GetRunAwayLocations() { return RunAwayLocations; }
+	const TArray<FVector>& GetRunAwayLocations() const;
+
+	/**
+	 * Returns the runaway location closest to the monster, ignoring any within 50 units of it.
+	 * Runaway location queries use walking distance where it has been baked, and straight-line distance otherwise
+	 * @return The location, or the monster's own location if there is none
+	 */
+	FVector GetClosestRunawayLocation() const;
+
+	/**
+	 * Returns the runaway location farthest from the monster
+	 * @return The location, or the monster's own location if there is none
+	 */
+	FVector GetFarthestRunawayLocation() const;
+
+	/**
+	 * Returns the runaway location farthest from the player
+	 * @return The location, or the monster's own location if there is none
+	 */
+	FVector GetFarthestRunawayLocationFromPlayer() const;
+
+	/**
+	 * Number of candidates AddRandomTargetCandidates adds for an area
+	 */
+	static constexpr int32 AsyncCandidatesPerArea = 3;
 
-	FVector GetClosestRunawayLocation();
-	FVector GetFarthestRunawayLocation();
-	FVector GetFarthestRunawayLocationFromPlayer();
+	/**
+	 * Choose a new target location without blocking the game thread.
+	 * Each candidate is path tested in order by an async nav query, and the end of the first complete path becomes the TargetLocation.
+	 * If every candidate fails the closest runaway location is used instead. The current target is kept until the result comes back.
+	 * @param Candidates Possible target points, in order of preference
+	 */
+	void RequestTargetLocationAsync(const TArray<FVector>& Candidates);
+
+	/**
+	 * Adds AsyncCandidatesPerArea random points within Radius of Origin to the candidates for RequestTargetLocationAsync.
+	 * The points are only picked in the circle, which costs no nav query: the async path test projects them onto the navmesh
+	 * off the game thread
+	 * @param Origin Center of the area
+	 * @param Radius Radius of the area
+	 * @param Candidates The candidates to add to
+	 */
+	void AddRandomTargetCandidates(const FVector& Origin, float Radius, TArray<FVector>& Candidates);
+
+	/**
+	 * Cancels the target query in flight, if any. The current target location is left unchanged
+	 */
+	void AbortTargetLocationQuery();
+
+	/**
+	 * @return True if a target query has been requested and its result hasn't been applied yet
+	 */
+	bool IsTargetQueryPending() const { return PendingTargetQueryID != INVALID_NAVQUERYID; }
+
+	/**
+	 * @return True if the services should use RequestTargetLocationAsync instead of synchronous pathfinding.
+	 * Always false in deterministic mode, since async results can come back on a different frame each run
+	 */
+	bool UseAsyncNavQueries() const { return bUseAsyncNavQueries && !bDeterministic; }
+
+	/**
+	 * @return True if runaway locations are ranked by baked walking distance where it is known
+	 */
+	bool UseNavDistanceTable() const { return bUseNavDistanceTable; }
+
+	/**
+	 * @return Latency of the last finished target query in milliseconds
+	 */
+	float GetLastTargetQueryLatency() const { return LastTargetQueryLatency; }
+
+	/**
+	 * Queue expensive work (random reachable points, synchronous pathfinding) with the query scheduler, at the priority of the monster's
+	 * current state. The work is dropped if the monster changes state before it runs. Runs immediately in deterministic mode
+	 * @param Query The work to do
+	 */
+	void ScheduleQuery(TFunction<void()> Query);
+
+	/**
+	 * @return True if the monster has a scheduled query that hasn't run yet
+	 */
+	bool IsQueryScheduled() const;
+
+	/**
+	 * Attach an already validated path to a target location so the next move to that location can reuse it
+	 * @param Goal The target location the path leads to
+	 * @param Path The validated path. Passing an invalid path clears the stored one
+	 */
+	void SetTargetPath(const FVector& Goal, FNavPathSharedPtr Path);
+
+	/**
+	 * Returns the stored path if it still leads to Goal and starts where the monster is standing
+	 * @param Goal The target location the path should lead to
+	 * @return The stored path, or an invalid pointer if there is no usable one
+	 */
+	FNavPathSharedPtr GetTargetPath(const FVector& Goal) const;
+
+	/**
+	 * Finds a path from the monster to a location, from the shared path cache if a monster has found one between the same places before
+	 * @param Goal Where the path should end
+	 * @return The path, which may be partial. Null if there is none
+	 */
+	FNavPathSharedPtr FindPathTo(const FVector& Goal);
+
+	/**
+	 * Move the monster to a target location. Uses Path directly if it is valid, otherwise pathfinds like MoveToLocation
+	 * @param Goal The location to move to
+	 * @param Path A path to Goal found earlier, can be invalid
+	 * @return Result of the move request
+	 */
+	EPathFollowingRequestResult::Type MoveToTargetLocation(const FVector& Goal, FNavPathSharedPtr Path);
+
+	/**
+	 * Builds a path to a moved target by keeping the rest of the path being followed and extending it from its old end to NewGoal,
+	 * then hands it to the next move like SetTargetPath. Only done when NewGoal is close to the old end and further along the way
+	 * @param NewGoal The new target location
+	 * @return True if the path was repaired. False if the next move has to find its path from scratch
+	 */
+	bool RepairTargetPath(const FVector& NewGoal);
+
+	/**
+	 * Finds a random point on the navmesh within Radius of Origin.
+	 * In deterministic mode the point comes from the seeded RandomStream, otherwise from the navigation system's own randomness
+	 * @param Origin Center of the search
+	 * @param Radius Radius of the search
+	 * @param OutPoint The point found, left unchanged if there is none
+	 * @return True if a point was found
+	 */
+	bool GetRandomReachablePoint(const FVector& Origin, float Radius, FVector& OutPoint);
+
+	/**
+	 * Picks a point within Radius of Center from the level's reachable point pool. The monster is known to be able to walk to it
+	 * @param Center Center of the area to pick from
+	 * @param Radius Radius of the area to pick from
+	 * @param OutPoint The point picked, left unchanged if there is none
+	 * @return True if a point was picked. False if the pool is turned off or has no point in the area
+	 */
+	bool GetPooledTargetPoint(const FVector& Center, float Radius, FVector& OutPoint);
+
+	/**
+	 * @return True if the monster is running in deterministic mode
+	 */
+	bool IsDeterministic() const { return bDeterministic; }
+
+	/**
+	 * Switch to searching around a point, as decided by MonsterStateRules. Searching ends on its own after DesiredSearchDuration
+	 * @param SearchCenter The point to search around
+	 */
+	void StartSearch(const FVector& SearchCenter);
+
+	/**
+	 * Switch to going to the player. The state ends on its own after Duration
+	 * @param Duration Time in seconds to go directly to the player
+	 */
+	void StartGoToPlayer(float Duration);
+
+	/**
+	 * Returns how long it has been since the monster stopped pursuing
+	 * @return Time in seconds, or -1 if the timer isn't running
+	 */
+	float GetTimeSincePursue() const;
+
+	/**
+	 * Restarts the time since the monster stopped pursuing as if it had already run for Seconds
+	 * @param Seconds Time already passed. Negative stops the timer
+	 */
+	void SetTimeSincePursue(float Seconds);
 
 	/**
 	 * Returns the monster's current state. 
@@ -127,6 +496,36 @@ public:
 	 */
 	uint8 GetMonsterCurrentState() const;
 
+	/**
+	 * Returns the typed view of the monster's blackboard. Services and tasks read and write the blackboard through this
+	 * @return The blackboard view
+	 */
+	FMonsterBlackboard& GetMonsterBlackboard() { return MonsterBlackboard; }
+
+	/**
+	 * Drops the blackboard values the monster has cached this frame. Blueprint tasks and decorators that write
+	 * the blackboard directly call this afterwards, so the monster sees the write straight away
+	 */
+	UFUNCTION(BlueprintCallable)
+	void InvalidateBlackboardCache() { MonsterBlackboard.Invalidate(); }
+
+	/**
+	 * Copies the monster's AI state out for the horde system to carry on with
+	 * @param OutMember The monster's state
+	 */
+	void GetHordeMember(struct FMonsterHordeMember& OutMember) const;
+
+	/**
+	 * Carries on from the AI state the horde system left the monster in. Call after possessing the monster
+	 * @param Member The monster's state
+	 */
+	void SetHordeMember(const struct FMonsterHordeMember& Member);
+
+	/**
+	 * @return The monster's recorded telemetry
+	 */
+	const FMonsterTelemetry& GetTelemetry() const { return Telemetry; }
+
 #pragma region Get Desired AI Values
 public:
 		float GetDesiredWanderRadius() const { return DesiredWanderRadius; }
@@ -136,5 +535,139 @@ public:
 		float GetDesiredRunSpeed() const { return DesiredRunSpeed; }
 		float GetDesiredPursueInsteadOfSearchRadius() const { return DesiredPursueInsteadOfSearchRadius; }
 		float GetDesiredSearchDuration() const { return DesiredSearchDuration; }
+		bool ShouldPredictPlayerIntercept() const { return bPredictPlayerIntercept; }
+		float GetMaxInterceptPredictionTime() const { return MaxInterceptPredictionTime; }
+		float GetChaseRepathDistance() const { return ChaseRepathDistance; }
+		bool CanSeePlayer() const { return bCanSeePlayer; }
+		float GetSightRange() const { return SightRange; }
+		float GetSightHalfAngle() const { return SightHalfAngle; }
 #pragma endregion
+
+protected:
+	virtual void OnUnPossess() override;
+
+	/**
+	 * Writes the decision log in deterministic mode
+	 * @param EndPlayReason Why play is ending
+	 */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/**
+	 * Changes state in response to a single sound, if the monster can hear it
+	 * @param Event The sound
+	 * @param ListenerRoom The acoustic room the monster is in
+	 */
+	void ReactToSound(const struct FMonsterNoiseEvent& Event, int32 ListenerRoom);
+
+	/**
+	 * Called once the monster has searched for DesiredSearchDuration. Switches back to wandering
+	 */
+	void OnSearchTimeUp();
+
+	/**
+	 * Called once the monster has gone to the player for as long as it was told to. Switches to search or pursue
+	 */
+	void OnGoToPlayerTimeUp();
+
+	/**
+	 * Picks a point within Radius of Origin from RandomStream, at Origin's height. Not projected onto the navmesh
+	 * @param Origin Center of the circle
+	 * @param Radius Radius of the circle
+	 * @return The point
+	 */
+	FVector GetRandomPointInCircle(const FVector& Origin, float Radius);
+
+	/**
+	 * Stops the search and go to player timers
+	 */
+	void ClearStateTimers();
+
+	/**
+	 * Called by the registry when the player becomes safe or unsafe. A wandering monster heads for a runaway location away from the player
+	 * as soon as they're safe, instead of when it next reaches its target
+	 * @param bPlayerSafe True if the player is now protected by a safety volume
+	 */
+	void OnPlayerSafetyChanged(bool bPlayerSafe);
+
+	/**
+	 * Fills in the state rules' inputs from the blackboard. Distance is the distance to the target location
+	 * @param Event What happened
+	 * @return The inputs
+	 */
+	MonsterStateRules::FInputs GetStateInputs(MonsterStateRules::EEvent Event) const;
+
+	/**
+	 * Carries out a transition worked out by the state rules through MonsterStateRules::TStateMachine and the hooks below
+	 * @param Transition The transition
+	 * @param Location Where the event happened. The sound for pursue entries, the point to search around for search entries
+	 */
+	void ApplyTransition(const MonsterStateRules::FTransition& Transition, const FVector& Location);
+
+	friend struct MonsterStateRules::TStateMachine<AMonsterAIController>;
+
+	/**
+	 * Plays a transition's sound
+	 * @param Sound The sound
+	 * @param Location Where the event happened
+	 */
+	void PlayTransitionSound(MonsterStateRules::ESound Sound, const FVector& Location);
+
+	/**
+	 * Stops whatever the state left running. Only called when the state actually changes
+	 * @param Location Where the event happened
+	 */
+	template <MonsterStateRules::EState State>
+	void OnExitState(const FVector& Location);
+
+	/**
+	 * Writes the state and whatever else its entry needs to the blackboard, and starts its timer
+	 * @param Transition The transition
+	 * @param Location Where the event happened
+	 */
+	template <MonsterStateRules::EState State>
+	void OnEnterState(const MonsterStateRules::FTransition& Transition, const FVector& Location);
+
+	/**
+	 * Records a telemetry sample of the monster's current state, if telemetry is on. Compiled out of shipping builds
+	 * @param Event What caused the sample
+	 * @param SoundOrigin For sound events: where the sound came from
+	 * @param HearableRadius For sound events: radius the sound can be heard in
+	 * @param HearingDistance For sound events: how far the sound travelled to reach the monster
+	 */
+	void RecordTelemetry(EMonsterTelemetryEvent Event, const FVector& SoundOrigin = FVector::ZeroVector, float HearableRadius = 0.0f, float HearingDistance = 0.0f);
+
+	/**
+	 * Records state transitions and target choices to DecisionLog and telemetry
+	 * @param BlackboardComponent The blackboard that changed
+	 * @param ChangedKey The key that changed
+	 * @return Whether to keep observing the key
+	 */
+	EBlackboardNotificationResult OnDecisionKeyChanged(const UBlackboardComponent& BlackboardComponent, FBlackboard::FKey ChangedKey);
+
+	/**
+	 * Starts observing the decision keys with OnDecisionKeyChanged if the monster is deterministic or telemetry is on,
+	 * and stops once neither is. Nothing is observed otherwise, so the blackboard writes cost nothing extra
+	 */
+	void UpdateDecisionObservers();
+
+	/**
+	 * Submits an async path query from the monster to the next pending target candidate
+	 */
+	void SubmitNextTargetCandidate();
+
+	/**
+	 * Called on the game thread when an async target path query finishes
+	 * @param QueryID ID of the finished query
+	 * @param Result Result of the pathfinding
+	 * @param Path The path found, if any
+	 */
+	void OnTargetPathQueryFinished(uint32 QueryID, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	/**
+	 * Applies the result of a finished target query and clears the pending query
+	 * @param NewTarget The location to set as TargetLocation
+	 * @param Path The validated path to NewTarget, if there is one
+	 */
+	void FinishTargetQuery(const FVector& NewTarget, FNavPathSharedPtr Path = nullptr);
 };
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterAIQueryScheduler.h"
+
+#include "MonsterAIController.h"
+#include "MonsterAIStats.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	TAutoConsoleVariable<float> CVarMonsterQueryBudgetMs(
+		TEXT("MonsterAI.QueryBudgetMs"),
+		1.0f,
+		TEXT("Milliseconds per frame the monsters' scheduled queries may take. At least one query runs every frame regardless"));
+}
+
+bool UMonsterAIQueryScheduler::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have monsters to schedule for
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMonsterAIQueryScheduler::Enqueue(const AMonsterAIController* Owner, const EMonsterQueryPriority Priority, TFunction<void()> Query)
+{
+	Cancel(Owner);
+
+	//keep the queue sorted, behind every query of the same or higher priority
+	int32 Index = 0;
+	while (Index < Queue.Num() && Queue[Index].Priority >= Priority)
+	{
+		++Index;
+	}
+	Queue.Insert({ Owner, Priority, NextSequence++, MoveTemp(Query) }, Index);
+	SET_DWORD_STAT(STAT_MonsterQueryQueueDepth, Queue.Num());
+}
+
+void UMonsterAIQueryScheduler::Cancel(const AMonsterAIController* Owner)
+{
+	Queue.RemoveAll([Owner](const FScheduledQuery& Scheduled) { return Scheduled.Owner == Owner; });
+	SET_DWORD_STAT(STAT_MonsterQueryQueueDepth, Queue.Num());
+}
+
+bool UMonsterAIQueryScheduler::IsQueued(const AMonsterAIController* Owner) const
+{
+	return Queue.ContainsByPredicate([Owner](const FScheduledQuery& Scheduled) { return Scheduled.Owner == Owner; });
+}
+
+void UMonsterAIQueryScheduler::Tick(float DeltaTime)
+{
+	if (Queue.Num() < 1) { return; }
+
+	SCOPE_CYCLE_COUNTER(STAT_MonsterQuerySchedulerTick);
+
+	const double Budget = CVarMonsterQueryBudgetMs.GetValueOnGameThread() / 1000.0;
+	const double Start = FPlatformTime::Seconds();
+	int32 NumRun = 0;
+
+	//at least one query runs every frame, so a budget smaller than a single query can't stall the monsters
+	while (Queue.Num() > 0 && (NumRun < 1 || FPlatformTime::Seconds() - Start < Budget))
+	{
+		//take the query out first, it may queue a new one for its monster
+		FScheduledQuery Scheduled = MoveTemp(Queue[0]);
+		Queue.RemoveAt(0, 1, false);
+		++NumRun;
+
+		if (Scheduled.Owner.IsValid())
+		{
+			Scheduled.Query();
+		}
+	}
+
+	const double Elapsed = FPlatformTime::Seconds() - Start;
+	if (Elapsed > Budget)
+	{
+		++NumOverruns;
+		INC_DWORD_STAT(STAT_MonsterQueryBudgetOverruns);
+		UE_LOG(LogMonsterAI, Verbose, TEXT("Monster queries took %.2fms, over the %.2fms budget (%d run, %d carried over)"), Elapsed * 1000.0, Budget * 1000.0, NumRun, Queue.Num());
+	}
+
+	INC_DWORD_STAT_BY(STAT_MonsterQueriesRun, NumRun);
+	SET_DWORD_STAT(STAT_MonsterQueryQueueDepth, Queue.Num());
+}
+
+ETickableTickType UMonsterAIQueryScheduler::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UMonsterAIQueryScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonsterAIQueryScheduler, STATGROUP_Tickables);
+}
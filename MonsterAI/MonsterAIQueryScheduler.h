@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterAIQueryScheduler.generated.h"
+
+/**
+ * Priority of a scheduled query. Higher priorities run first
+ */
+enum class EMonsterQueryPriority : uint8
+{
+	Wander,
+	Search,
+	Pursue,
+	GoToPlayer
+};
+
+/**
+ * Runs the monsters' expensive queries (random reachable points, synchronous pathfinding, traces) within a time budget each frame,
+ * instead of whenever a service happens to fire. Queries that don't fit in this frame's budget carry over to the next one.
+ * Each monster has at most one query queued, a newer one replaces it. The budget is set with MonsterAI.QueryBudgetMs
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterAIQueryScheduler : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/**
+	 * Queue a query to run once the queries ahead of it are done and there is budget left
+	 * @param Owner The monster the query is for. Replaces the query it already has queued, if any
+	 * @param Priority Priority of the query
+	 * @param Query The work to do
+	 */
+	void Enqueue(const class AMonsterAIController* Owner, EMonsterQueryPriority Priority, TFunction<void()> Query);
+
+	/**
+	 * Drop a monster's queued query, if it has one
+	 * @param Owner The monster
+	 */
+	void Cancel(const class AMonsterAIController* Owner);
+
+	/**
+	 * @param Owner The monster
+	 * @return True if the monster has a query waiting to run
+	 */
+	bool IsQueued(const class AMonsterAIController* Owner) const;
+
+	/**
+	 * @return Number of queries waiting to run
+	 */
+	int32 GetQueueDepth() const { return Queue.Num(); }
+
+	/**
+	 * @return Number of frames since the level started where the queries run went over the budget
+	 */
+	int64 GetNumOverruns() const { return NumOverruns; }
+
+#pragma region FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+#pragma endregion
+
+private:
+	struct FScheduledQuery
+	{
+		/** The monster the query is for */
+		TWeakObjectPtr<const class AMonsterAIController> Owner;
+		/** Priority of the query */
+		EMonsterQueryPriority Priority;
+		/** Order the query was queued in, queries of the same priority run oldest first */
+		uint64 Sequence;
+		/** The work to do */
+		TFunction<void()> Query;
+	};
+
+	/**
+	 * Queries waiting to run, highest priority first
+	 */
+	TArray<FScheduledQuery> Queue;
+
+	/**
+	 * Sequence number of the next query queued
+	 */
+	uint64 NextSequence = 0;
+
+	int64 NumOverruns = 0;
+};
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterAIStats.h"
+
+DEFINE_LOG_CATEGORY(LogMonsterAI);
+
+#pragma region Navigation Queries
+DEFINE_STAT(STAT_MonsterNavQueries);
+DEFINE_STAT(STAT_MonsterNavQueriesInFlight);
+DEFINE_STAT(STAT_MonsterNavQueriesSubmitted);
+DEFINE_STAT(STAT_MonsterNavQueryLatency);
+#pragma endregion
+
+#pragma region Runaway Locations
+DEFINE_STAT(STAT_MonsterRunAwayQuery);
+DEFINE_STAT(STAT_MonsterNavDistanceBake);
+#pragma endregion
+
+#pragma region Reachable Point Pool
+DEFINE_STAT(STAT_MonsterPointPoolUpdate);
+DEFINE_STAT(STAT_MonsterPointPoolQuery);
+DEFINE_STAT(STAT_MonsterPointPoolSize);
+#pragma endregion
+
+#pragma region Noise
+DEFINE_STAT(STAT_MonsterNoiseSubmitted);
+DEFINE_STAT(STAT_MonsterNoiseDelivered);
+DEFINE_STAT(STAT_MonsterNoiseListenersVisited);
+DEFINE_STAT(STAT_MonsterNoiseDelivery);
+#pragma endregion
+
+#pragma region Chase
+DEFINE_STAT(STAT_MonsterChaseRetargets);
+DEFINE_STAT(STAT_MonsterChasePathRepairs);
+DEFINE_STAT(STAT_MonsterMoveRequestsSkipped);
+DEFINE_STAT(STAT_MonsterChasePathRepair);
+#pragma endregion
+
+#pragma region Query Scheduler
+DEFINE_STAT(STAT_MonsterQueryQueueDepth);
+DEFINE_STAT(STAT_MonsterQueriesRun);
+DEFINE_STAT(STAT_MonsterQueryBudgetOverruns);
+DEFINE_STAT(STAT_MonsterQuerySchedulerTick);
+#pragma endregion
+
+#pragma region Presence Heat Map
+DEFINE_STAT(STAT_MonsterHeatMapCells);
+DEFINE_STAT(STAT_MonsterHeatMapQuery);
+#pragma endregion
+
+#pragma region Decisions
+DEFINE_STAT(STAT_MonsterDecisions);
+DEFINE_STAT(STAT_MonsterDecisionGather);
+DEFINE_STAT(STAT_MonsterDecisionDecide);
+DEFINE_STAT(STAT_MonsterDecisionApply);
+#pragma endregion
+
+#pragma region Horde
+DEFINE_STAT(STAT_MonsterHordeMembers);
+DEFINE_STAT(STAT_MonsterHordePaths);
+DEFINE_STAT(STAT_MonsterHordePromotions);
+DEFINE_STAT(STAT_MonsterHordeDemotions);
+DEFINE_STAT(STAT_MonsterHordeTick);
+#pragma endregion
+
+#pragma region Path Cache
+DEFINE_STAT(STAT_MonsterPathCacheHits);
+DEFINE_STAT(STAT_MonsterPathCacheMisses);
+DEFINE_STAT(STAT_MonsterPathCacheEvictions);
+DEFINE_STAT(STAT_MonsterPathCacheEntries);
+DEFINE_STAT(STAT_MonsterPathCacheMemory);
+#pragma endregion
+
+#pragma region Vision
+DEFINE_STAT(STAT_MonsterVisionChecks);
+DEFINE_STAT(STAT_MonsterVisionTraces);
+DEFINE_STAT(STAT_MonsterVisionSightings);
+DEFINE_STAT(STAT_MonsterVisionQueuedTraces);
+DEFINE_STAT(STAT_MonsterVisionTick);
+#pragma endregion
+
+namespace MonsterAIStats
+{
+	namespace
+	{
+		int64 NumNavQueries = 0;
+	}
+
+	void CountNavQuery()
+	{
+		++NumNavQueries;
+		INC_DWORD_STAT(STAT_MonsterNavQueries);
+	}
+
+	int64 GetNumNavQueries()
+	{
+		return NumNavQueries;
+	}
+}
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+SPOOKYGAME_API DECLARE_LOG_CATEGORY_EXTERN(LogMonsterAI, Log, All);
+
+/**
+ * Stat group for the monster AI. View in game with "stat MonsterAI"
+ */
+DECLARE_STATS_GROUP(TEXT("MonsterAI"), STATGROUP_MonsterAI, STATCAT_Advanced);
+
+#pragma region Navigation Queries
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nav Queries"), STAT_MonsterNavQueries, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Nav Queries In Flight"), STAT_MonsterNavQueriesInFlight, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nav Queries Submitted"), STAT_MonsterNavQueriesSubmitted, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Nav Query Latency (ms)"), STAT_MonsterNavQueryLatency, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Runaway Locations
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Runaway Location Query"), STAT_MonsterRunAwayQuery, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Nav Distance Bake"), STAT_MonsterNavDistanceBake, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Reachable Point Pool
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Point Pool Update"), STAT_MonsterPointPoolUpdate, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Point Pool Query"), STAT_MonsterPointPoolQuery, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Point Pool Size"), STAT_MonsterPointPoolSize, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Noise
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Noise Reports Submitted"), STAT_MonsterNoiseSubmitted, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Noise Events Delivered"), STAT_MonsterNoiseDelivered, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Noise Listeners Visited"), STAT_MonsterNoiseListenersVisited, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Noise Delivery"), STAT_MonsterNoiseDelivery, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Chase
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Chase Retargets"), STAT_MonsterChaseRetargets, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Chase Path Repairs"), STAT_MonsterChasePathRepairs, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Move Requests Skipped"), STAT_MonsterMoveRequestsSkipped, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Chase Path Repair"), STAT_MonsterChasePathRepair, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Query Scheduler
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Query Queue Depth"), STAT_MonsterQueryQueueDepth, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Queries Run"), STAT_MonsterQueriesRun, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Query Budget Overruns"), STAT_MonsterQueryBudgetOverruns, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Query Scheduler"), STAT_MonsterQuerySchedulerTick, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Presence Heat Map
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Heat Map Cells"), STAT_MonsterHeatMapCells, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Heat Map Query"), STAT_MonsterHeatMapQuery, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Decisions
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Decisions"), STAT_MonsterDecisions, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decision Gather"), STAT_MonsterDecisionGather, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decision Decide"), STAT_MonsterDecisionDecide, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decision Apply"), STAT_MonsterDecisionApply, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Horde
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Horde Members"), STAT_MonsterHordeMembers, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Horde Paths"), STAT_MonsterHordePaths, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Horde Promotions"), STAT_MonsterHordePromotions, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Horde Demotions"), STAT_MonsterHordeDemotions, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Horde Tick"), STAT_MonsterHordeTick, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Path Cache
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Path Cache Hits"), STAT_MonsterPathCacheHits, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Path Cache Misses"), STAT_MonsterPathCacheMisses, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Path Cache Evictions"), STAT_MonsterPathCacheEvictions, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Path Cache Entries"), STAT_MonsterPathCacheEntries, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Path Cache Memory"), STAT_MonsterPathCacheMemory, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+#pragma region Vision
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sight Checks"), STAT_MonsterVisionChecks, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sight Traces"), STAT_MonsterVisionTraces, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sightings"), STAT_MonsterVisionSightings, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Queued Sight Traces"), STAT_MonsterVisionQueuedTraces, STATGROUP_MonsterAI, SPOOKYGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Vision Tick"), STAT_MonsterVisionTick, STATGROUP_MonsterAI, SPOOKYGAME_API);
+#pragma endregion
+
+namespace MonsterAIStats
+{
+	/**
+	 * Counts a navigation query (pathfind, random point or projection) run by a monster, in the Nav Queries stat
+	 * and in a running total that is kept in every build configuration
+	 */
+	SPOOKYGAME_API void CountNavQuery();
+
+	/**
+	 * @return Number of navigation queries the monsters have run since startup
+	 */
+	SPOOKYGAME_API int64 GetNumNavQueries();
+}
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterAcousticGraph.h"
+
+#include "EngineUtils.h"
+#include "MonsterAcousticPortal.h"
+#include "MonsterAcousticRoom.h"
+#include "MonsterAIStats.h"
+
+void FMonsterAcousticGraph::Build(UWorld* World)
+{
+	Rooms.Reset();
+	Portals.Reset();
+	PortalDistances.Reset();
+
+	//gather rooms
+	TMap<const AMonsterAcousticRoom*, int32> RoomIndices;
+	for (TActorIterator<AMonsterAcousticRoom> It(World); It; ++It)
+	{
+		RoomIndices.Add(*It, Rooms.Num());
+		FRoom& Room = Rooms.AddDefaulted_GetRef();
+		Room.Volume = *It;
+		Room.Bounds = It->GetComponentsBoundingBox(true);
+	}
+
+	//gather portals between gathered rooms
+	TArray<TPair<int32, int32>> PortalRooms;
+	for (TActorIterator<AMonsterAcousticPortal> It(World); It; ++It)
+	{
+		const int32* RoomA = RoomIndices.Find(It->RoomA);
+		const int32* RoomB = RoomIndices.Find(It->RoomB);
+		if (!RoomA || !RoomB)
+		{
+			UE_LOG(LogMonsterAI, Warning, TEXT("Acoustic portal %s doesn't connect two rooms and will be ignored"), *It->GetName());
+			continue;
+		}
+
+		const int32 PortalIndex = Portals.Add({ It->GetActorLocation(), It->Attenuation });
+		PortalRooms.Emplace(*RoomA, *RoomB);
+		Rooms[*RoomA].Portals.Add(PortalIndex);
+		Rooms[*RoomB].Portals.AddUnique(PortalIndex);
+	}
+
+	//portals sharing a room are directly connected
+	const int32 NumPortals = Portals.Num();
+	PortalDistances.Init(MAX_flt, NumPortals * NumPortals);
+	for (int32 i = 0; i < NumPortals; ++i)
+	{
+		PortalDistances[i * NumPortals + i] = 0.0f;
+	}
+	for (const FRoom& Room : Rooms)
+	{
+		for (const int32 From : Room.Portals)
+		{
+			for (const int32 To : Room.Portals)
+			{
+				if (From == To) { continue; }
+				const float Distance = GetDirectHearingDistance(Portals[From].Location, Portals[To].Location) + Portals[To].Attenuation;
+				PortalDistances[From * NumPortals + To] = FMath::Min(PortalDistances[From * NumPortals + To], Distance);
+			}
+		}
+	}
+
+	//all pairs shortest distances. Levels have tens of portals, so this is cheap at load
+	for (int32 k = 0; k < NumPortals; ++k)
+	{
+		for (int32 i = 0; i < NumPortals; ++i)
+		{
+			const float ToK = PortalDistances[i * NumPortals + k];
+			if (ToK == MAX_flt) { continue; }
+			for (int32 j = 0; j < NumPortals; ++j)
+			{
+				const float FromK = PortalDistances[k * NumPortals + j];
+				if (FromK != MAX_flt && ToK + FromK < PortalDistances[i * NumPortals + j])
+				{
+					PortalDistances[i * NumPortals + j] = ToK + FromK;
+				}
+			}
+		}
+	}
+
+	UE_LOG(LogMonsterAI, Log, TEXT("Built acoustic graph with %d rooms and %d portals"), Rooms.Num(), NumPortals);
+}
+
+int32 FMonsterAcousticGraph::FindRoom(const FVector& Location) const
+{
+	for (int32 i = 0; i < Rooms.Num(); ++i)
+	{
+		if (Rooms[i].Bounds.IsInsideOrOn(Location) && Rooms[i].Volume.IsValid() && Rooms[i].Volume->EncompassesPoint(Location))
+		{
+			return i;
+		}
+	}
+	return INDEX_NONE;
+}
+
+float FMonsterAcousticGraph::GetHearingDistance(const FVector& Origin, const int32 OriginRoom, const FVector& Listener, const int32 ListenerRoom) const
+{
+	//without markup around both points there is nothing to go on but the direct distance
+	if (OriginRoom == INDEX_NONE || ListenerRoom == INDEX_NONE || OriginRoom == ListenerRoom)
+	{
+		return GetDirectHearingDistance(Origin, Listener);
+	}
+
+	//shortest route out of the origin's room, through the graph, and into the listener's room
+	float Best = MAX_flt;
+	for (const int32 Exit : Rooms[OriginRoom].Portals)
+	{
+		const float ToExit = GetDirectHearingDistance(Origin, Portals[Exit].Location) + Portals[Exit].Attenuation;
+		for (const int32 Entry : Rooms[ListenerRoom].Portals)
+		{
+			const float Between = GetPortalDistance(Exit, Entry);
+			if (Between == MAX_flt) { continue; }
+			Best = FMath::Min(Best, ToExit + Between + GetDirectHearingDistance(Portals[Entry].Location, Listener));
+		}
+	}
+	return Best;
+}
+
+float FMonsterAcousticGraph::GetDirectHearingDistance(const FVector& A, const FVector& B)
+{
+	//vertical distance counts double
+	return FMath::Abs(A.Z - B.Z) * 2 + FVector::Dist2D(A, B);
+}
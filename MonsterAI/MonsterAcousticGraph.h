@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Precomputed graph of AMonsterAcousticRooms connected through AMonsterAcousticPortals.
+ * Shortest distances between every pair of portals are computed once when the graph is built,
+ * so the distance a sound travels to reach a listener is a lookup over the portals of two rooms, with no traces or path queries.
+ */
+struct SPOOKYGAME_API FMonsterAcousticGraph
+{
+public:
+	/**
+	 * Rebuilds the graph from the room and portal actors in a world
+	 * @param World The world to gather rooms and portals from
+	 */
+	void Build(UWorld* World);
+
+	/**
+	 * @return True if the level has any acoustic rooms
+	 */
+	bool HasRooms() const { return Rooms.Num() > 0; }
+
+	/**
+	 * Finds the room containing a point
+	 * @param Location The point
+	 * @return Index of the room, INDEX_NONE if the point isn't in any room
+	 */
+	int32 FindRoom(const FVector& Location) const;
+
+	/**
+	 * Returns how far a sound has to travel to reach a listener. Travels through portals between rooms,
+	 * and falls back to the direct hearing distance when either point is outside every room
+	 * @param Origin Origin point of the sound
+	 * @param OriginRoom Room containing Origin, from FindRoom
+	 * @param Listener Location of the listener
+	 * @param ListenerRoom Room containing Listener, from FindRoom
+	 * @return The distance, or MAX_flt if no portals connect the two rooms
+	 */
+	float GetHearingDistance(const FVector& Origin, int32 OriginRoom, const FVector& Listener, int32 ListenerRoom) const;
+
+	/**
+	 * Distance a sound travels between two points with nothing in the way. Vertical distance counts double
+	 * @param A One point
+	 * @param B The other point
+	 * @return The distance
+	 */
+	static float GetDirectHearingDistance(const FVector& A, const FVector& B);
+
+private:
+	struct FRoom
+	{
+		/** The room volume, used for the precise containment test */
+		TWeakObjectPtr<class AMonsterAcousticRoom> Volume;
+		/** Bounds of the volume, checked first since it is much cheaper */
+		FBox Bounds;
+		/** Indices of the portals leading out of this room */
+		TArray<int32> Portals;
+	};
+
+	struct FPortal
+	{
+		FVector Location;
+		float Attenuation;
+	};
+
+	/**
+	 * @return Shortest distance from portal From to portal To, including To's attenuation but not From's
+	 */
+	float GetPortalDistance(const int32 From, const int32 To) const { return PortalDistances[From * Portals.Num() + To]; }
+
+	TArray<FRoom> Rooms;
+	TArray<FPortal> Portals;
+
+	/** Portals.Num() x Portals.Num() shortest distances between portals */
+	TArray<float> PortalDistances;
+};
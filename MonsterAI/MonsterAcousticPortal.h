@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "MonsterAcousticPortal.generated.h"
+
+/**
+ * Designer placed opening that lets sound travel between two AMonsterAcousticRooms, e.g. a door, a stairwell or a hole in the floor.
+ * Place it where the sound passes through.
+ */
+UCLASS()
+class SPOOKYGAME_API AMonsterAcousticPortal : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AMonsterAcousticPortal();
+
+	/**
+	 * One of the rooms this portal connects
+	 */
+	UPROPERTY(EditAnywhere, Category = "Acoustics")
+	class AMonsterAcousticRoom* RoomA;
+
+	/**
+	 * The other room this portal connects
+	 */
+	UPROPERTY(EditAnywhere, Category = "Acoustics")
+	class AMonsterAcousticRoom* RoomB;
+
+	/**
+	 * Extra distance added to sounds passing through, e.g. for a door that muffles them. 0 for an open doorway
+	 */
+	UPROPERTY(EditAnywhere, Category = "Acoustics", meta = (ClampMin = "0"))
+	float Attenuation = 0.0f;
+};
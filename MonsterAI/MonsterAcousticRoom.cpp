@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterAcousticRoom.h"
+
+#include "Components/BrushComponent.h"
+
+AMonsterAcousticRoom::AMonsterAcousticRoom()
+{
+	//markup only, nothing should collide with or overlap it.
+	//queries stay enabled so the brush keeps a body for EncompassesPoint
+	GetBrushComponent()->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	GetBrushComponent()->SetCollisionResponseToAllChannels(ECR_Ignore);
+	GetBrushComponent()->SetGenerateOverlapEvents(false);
+}
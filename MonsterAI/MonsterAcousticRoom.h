@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Volume.h"
+#include "MonsterAcousticRoom.generated.h"
+
+/**
+ * Designer placed volume marking out a room for monster hearing.
+ * Sounds reach the monster directly inside a room, and only through AMonsterAcousticPortals between rooms.
+ */
+UCLASS()
+class SPOOKYGAME_API AMonsterAcousticRoom : public AVolume
+{
+	GENERATED_BODY()
+
+public:
+	AMonsterAcousticRoom();
+};
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Enum.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Float.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
+
+/**
+ * Every blackboard key the monster AI uses: Key(Name, value type, blackboard key type).
+ * Name is both the key's name in the blackboard asset and the name of its accessors on FMonsterBlackboard
+ */
+#define MONSTER_BLACKBOARD_KEYS(Key) \
+	Key(State,						uint8,		Enum) \
+	Key(TargetLocation,				FVector,	Vector) \
+	Key(WanderRadius,				float,		Float) \
+	Key(WanderBiasStartRadius,		float,		Float) \
+	Key(WalkSpeed,					float,		Float) \
+	Key(HowLongToGoToPlayer,		float,		Float) \
+	Key(PursueInsteadOfSearchRadius,float,		Float) \
+	Key(SearchCenterPoint,			FVector,	Vector)
+
+/**
+ * Typed view of the monster's blackboard, generated from MONSTER_BLACKBOARD_KEYS.
+ * Each key gets Get<Name>() and Set<Name>(Value) with the key's value type, and Get<Name>Key() for registering observers.
+ * Reads are cached for the rest of the frame, so checking the state several times only reads the blackboard once,
+ * and writes of the value a key already has are skipped. Anything that writes the blackboard without going through the view
+ * (blueprint tasks, decorators) must call Invalidate afterwards, or the view can hide the write until the next frame
+ */
+struct FMonsterBlackboard
+{
+#define MONSTER_BLACKBOARD_VALUE_TYPE(Name, ValueType, KeyType) using F##Name##Type = ValueType;
+	MONSTER_BLACKBOARD_KEYS(MONSTER_BLACKBOARD_VALUE_TYPE)
+#undef MONSTER_BLACKBOARD_VALUE_TYPE
+
+	/**
+	 * Looks up the key IDs in the component's blackboard asset. Call after the component has been initialized
+	 * @param InComponent The blackboard component to read and write
+	 */
+	void Init(UBlackboardComponent* InComponent)
+	{
+		Component = InComponent;
+#define MONSTER_BLACKBOARD_INIT(Name, ValueType, KeyType) \
+		Name.KeyID = Component->GetKeyID(TEXT(#Name)); \
+		Name.Frame = MAX_uint64;
+		MONSTER_BLACKBOARD_KEYS(MONSTER_BLACKBOARD_INIT)
+#undef MONSTER_BLACKBOARD_INIT
+	}
+
+	/**
+	 * Drops every cached value, so the next read of each key goes to the blackboard
+	 */
+	void Invalidate()
+	{
+#define MONSTER_BLACKBOARD_INVALIDATE(Name, ValueType, KeyType) \
+		Name.Frame = MAX_uint64;
+		MONSTER_BLACKBOARD_KEYS(MONSTER_BLACKBOARD_INVALIDATE)
+#undef MONSTER_BLACKBOARD_INVALIDATE
+	}
+
+	/**
+	 * @return True once Init has been called
+	 */
+	bool IsValid() const { return Component != nullptr; }
+
+	/**
+	 * @return The blackboard component this is a view of
+	 */
+	UBlackboardComponent* GetComponent() const { return Component; }
+
+#define MONSTER_BLACKBOARD_ACCESSORS(Name, ValueType, KeyType) \
+	FBlackboard::FKey Get##Name##Key() const { return Name.KeyID; } \
+	ValueType Get##Name() const \
+	{ \
+		if (Name.Frame != GFrameCounter) \
+		{ \
+			Name.Value = Component->GetValue<UBlackboardKeyType_##KeyType>(Name.KeyID); \
+			Name.Frame = GFrameCounter; \
+		} \
+		return Name.Value; \
+	} \
+	void Set##Name(const ValueType& NewValue) \
+	{ \
+		if (Get##Name() == NewValue) { return; } \
+		/* observers are told inside SetValue, and the ones reading through the view must see the new value */ \
+		Name.Value = NewValue; \
+		Name.Frame = GFrameCounter; \
+		Component->SetValue<UBlackboardKeyType_##KeyType>(Name.KeyID, NewValue); \
+	}
+	MONSTER_BLACKBOARD_KEYS(MONSTER_BLACKBOARD_ACCESSORS)
+#undef MONSTER_BLACKBOARD_ACCESSORS
+
+private:
+	/**
+	 * A key's ID and the value read from it this frame
+	 */
+	template<typename ValueType>
+	struct TKey
+	{
+		FBlackboard::FKey KeyID = FBlackboard::InvalidKey;
+		mutable ValueType Value = ValueType();
+		mutable uint64 Frame = MAX_uint64;
+	};
+
+	UBlackboardComponent* Component = nullptr;
+
+#define MONSTER_BLACKBOARD_MEMBER(Name, ValueType, KeyType) TKey<ValueType> Name;
+	MONSTER_BLACKBOARD_KEYS(MONSTER_BLACKBOARD_MEMBER)
+#undef MONSTER_BLACKBOARD_MEMBER
+};
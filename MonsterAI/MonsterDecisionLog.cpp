@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterDecisionLog.h"
+
+#include "MonsterAIStats.h"
+#include "Misc/FileHelper.h"
+
+void FMonsterDecisionLog::Add(const float Time, const FName Kind, const uint8 State, const FVector& TargetLocation)
+{
+	Entries.Add({ Time, Kind, State, TargetLocation });
+}
+
+bool FMonsterDecisionLog::SaveToFile(const FString& Path) const
+{
+	FString Csv = TEXT("Time,Kind,State,TargetX,TargetY,TargetZ\n");
+	for (const FMonsterDecisionLogEntry& Entry : Entries)
+	{
+		Csv += FString::Printf(TEXT("%.3f,%s,%d,%.1f,%.1f,%.1f\n"), Entry.Time, *Entry.Kind.ToString(), Entry.State,
+			Entry.TargetLocation.X, Entry.TargetLocation.Y, Entry.TargetLocation.Z);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *Path))
+	{
+		UE_LOG(LogMonsterAI, Warning, TEXT("Couldn't write monster decision log to %s"), *Path);
+		return false;
+	}
+
+	UE_LOG(LogMonsterAI, Log, TEXT("Wrote %d monster decisions to %s"), Entries.Num(), *Path);
+	return true;
+}
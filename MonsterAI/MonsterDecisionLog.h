@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * One decision made by a monster: the state it was in and the target it chose
+ */
+struct FMonsterDecisionLogEntry
+{
+	/**
+	 * World time of the decision
+	 */
+	float Time;
+
+	/**
+	 * What changed: "State" or "Target"
+	 */
+	FName Kind;
+
+	/**
+	 * The monster's state after the decision
+	 */
+	uint8 State;
+
+	/**
+	 * The monster's target location after the decision
+	 */
+	FVector TargetLocation;
+};
+
+/**
+ * Record of every state transition and target choice a monster makes.
+ * With the same seed and inputs two deterministic runs produce identical logs, so they can be diffed to check an AI change
+ * didn't alter behavior
+ */
+struct FMonsterDecisionLog
+{
+	/**
+	 * Records a decision
+	 * @param Time World time of the decision
+	 * @param Kind What changed
+	 * @param State The monster's state after the decision
+	 * @param TargetLocation The monster's target location after the decision
+	 */
+	void Add(float Time, FName Kind, uint8 State, const FVector& TargetLocation);
+
+	/**
+	 * Removes every recorded decision
+	 */
+	void Reset() { Entries.Reset(); }
+
+	/**
+	 * @return The recorded decisions, oldest first
+	 */
+	const TArray<FMonsterDecisionLogEntry>& GetEntries() const { return Entries; }
+
+	/**
+	 * Writes the log as CSV. Values are rounded so logs from identical runs compare equal as text
+	 * @param Path File to write
+	 * @return True if the file was written
+	 */
+	bool SaveToFile(const FString& Path) const;
+
+private:
+	TArray<FMonsterDecisionLogEntry> Entries;
+};
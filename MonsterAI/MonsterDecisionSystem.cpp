@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterDecisionSystem.h"
+
+#include "BTService_CheckGoToPlayerStatus.h"
+#include "BTService_CheckSearchStatus.h"
+#include "BTService_CheckWanderStatus.h"
+#include "Monster.h"
+#include "MonsterAIController.h"
+#include "MonsterAIStats.h"
+#include "MonsterStateRules.h"
+#include "MonsterStates.h"
+#include "WorldActorRegistry.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarMonsterParallelDecisions(
+		TEXT("MonsterAI.ParallelDecisions"),
+		1,
+		TEXT("1: the monsters' decide pass runs across worker threads, 0: it runs on the game thread"));
+}
+
+bool UMonsterDecisionSystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have monsters to decide for
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMonsterDecisionSystem::AddMonster(AMonsterAIController* Controller, const uint8 ServiceState, const float Interval)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	//like a service tick, the first decision comes one interval after becoming relevant
+	FEntry* Entry = FindEntry(Controller, ServiceState);
+	if (!Entry)
+	{
+		Entry = &Entries.AddDefaulted_GetRef();
+		Entry->Controller = Controller;
+		Entry->ServiceState = ServiceState;
+	}
+	Entry->Interval = Interval;
+	Entry->NextDecisionTime = Now + Interval;
+	Entry->LastQueryTime = Now;
+}
+
+void UMonsterDecisionSystem::RemoveMonster(const AMonsterAIController* Controller, const uint8 ServiceState)
+{
+	Entries.RemoveAll([Controller, ServiceState](const FEntry& Entry) { return Entry.Controller == Controller && Entry.ServiceState == ServiceState; });
+}
+
+UMonsterDecisionSystem::FEntry* UMonsterDecisionSystem::FindEntry(const AMonsterAIController* Controller, const uint8 ServiceState)
+{
+	return Entries.FindByPredicate([Controller, ServiceState](const FEntry& Entry) { return Entry.Controller == Controller && Entry.ServiceState == ServiceState; });
+}
+
+void UMonsterDecisionSystem::Tick(float DeltaTime)
+{
+	if (Entries.Num() < 1) { return; }
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	Gather(Now);
+	if (Snapshots.Num() < 1) { return; }
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_MonsterDecisionDecide);
+
+		Decisions.SetNum(Snapshots.Num(), false);
+		const bool bSingleThreaded = Snapshots.Num() < MinParallelDecisions || CVarMonsterParallelDecisions.GetValueOnGameThread() == 0;
+		ParallelFor(Snapshots.Num(), [this](const int32 Index)
+		{
+			Decisions[Index] = Decide(Snapshots[Index]);
+		}, bSingleThreaded);
+	}
+
+	Apply(Now);
+}
+
+void UMonsterDecisionSystem::Gather(const float Now)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterDecisionGather);
+
+	DueControllers.Reset();
+	Snapshots.Reset();
+
+	//the player is the same for every monster
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	const AActor* Player = Registry ? Registry->GetPlayer() : nullptr;
+
+	for (int32 i = Entries.Num() - 1; i >= 0; --i)
+	{
+		if (!Entries[i].Controller.IsValid() || !Entries[i].Controller->GetPawn())
+		{
+			Entries.RemoveAt(i, 1, false);
+		}
+	}
+
+	for (FEntry& Entry : Entries)
+	{
+		if (Now < Entry.NextDecisionTime) { continue; }
+		Entry.NextDecisionTime = Now + Entry.Interval;
+
+		AMonsterAIController* Controller = Entry.Controller.Get();
+		FMonsterBlackboard& Blackboard = Controller->GetMonsterBlackboard();
+
+		FMonsterDecisionSnapshot& Snapshot = Snapshots.AddDefaulted_GetRef();
+		Snapshot.ServiceState = Entry.ServiceState;
+		Snapshot.MonsterLocation = Controller->GetPawn()->GetActorLocation();
+		Snapshot.TargetLocation = Blackboard.GetTargetLocation();
+		Snapshot.bTargetQueryPending = Controller->IsTargetQueryPending() || Controller->IsQueryScheduled();
+		Snapshot.WanderRadius = Blackboard.GetWanderRadius();
+		Snapshot.DesiredWanderRadius = Controller->GetDesiredWanderRadius();
+		Snapshot.TimeSinceLastQuery = Now - Entry.LastQueryTime;
+		Snapshot.RunSpeed = Controller->GetDesiredRunSpeed();
+		Snapshot.bPredictIntercept = Controller->ShouldPredictPlayerIntercept();
+		Snapshot.MaxInterceptPredictionTime = Controller->GetMaxInterceptPredictionTime();
+		Snapshot.ChaseRepathDistance = Controller->GetChaseRepathDistance();
+		Snapshot.bHasPlayer = Player != nullptr;
+		if (Player)
+		{
+			Snapshot.PlayerLocation = Player->GetActorLocation();
+			Snapshot.PlayerVelocity = Player->GetVelocity();
+		}
+		DueControllers.Add(Controller);
+	}
+
+	INC_DWORD_STAT_BY(STAT_MonsterDecisions, Snapshots.Num());
+}
+
+FMonsterDecisionResult UMonsterDecisionSystem::Decide(const FMonsterDecisionSnapshot& Snapshot)
+{
+	FMonsterDecisionResult Result;
+
+	//get distance to current target point
+	const float Distance = FVector::Distance(Snapshot.MonsterLocation, Snapshot.TargetLocation);
+
+	switch (Snapshot.ServiceState)
+	{
+	case EGurneyMonsterStates::GMS_Wander:
+		//if within a tolerable radius of the target location, choose a new target. Unless one is already being chosen
+		if (Distance < MonsterStateRules::ArrivalRadius && !Snapshot.bTargetQueryPending)
+		{
+			//the wander radius grows 3 units a second up to the desired radius
+			float WanderRadius = Snapshot.WanderRadius;
+			if (WanderRadius < Snapshot.DesiredWanderRadius)
+			{
+				WanderRadius = FMath::Min(WanderRadius + Snapshot.TimeSinceLastQuery * 3, Snapshot.DesiredWanderRadius);
+			}
+			Result.Decision = EMonsterDecision::ChooseWanderTarget;
+			Result.Radius = WanderRadius;
+		}
+		break;
+
+	case EGurneyMonsterStates::GMS_Search:
+		//the controller's search timer switches back to wandering after DesiredSearchDuration
+		if (Distance < MonsterStateRules::ArrivalRadius && !Snapshot.bTargetQueryPending)
+		{
+			Result.Decision = EMonsterDecision::ChooseSearchTarget;
+			Result.Radius = Snapshot.WanderRadius;
+		}
+		break;
+
+	case EGurneyMonsterStates::GMS_Pursue:
+	{
+		//reached the sound, search around it
+		MonsterStateRules::FInputs Inputs;
+		Inputs.State = MonsterStateRules::EState::Pursue;
+		Inputs.Event = MonsterStateRules::EEvent::ReachedTarget;
+		Inputs.Distance = Distance;
+		if (MonsterStateRules::Transition(Inputs).State == MonsterStateRules::EState::Search)
+		{
+			Result.Decision = EMonsterDecision::StartSearch;
+			Result.Location = Snapshot.MonsterLocation;
+		}
+		break;
+	}
+
+	case EGurneyMonsterStates::GMS_GoToPlayer:
+	{
+		//the monster stops going to the player when the controller's go to player timer runs out
+		if (!Snapshot.bHasPlayer) { break; }
+
+		//roughly how long the monster needs to get to the player, the player keeps moving at the same velocity for that long
+		FVector Intercept = Snapshot.PlayerLocation;
+		if (Snapshot.bPredictIntercept)
+		{
+			const float TimeToReach = FMath::Min(FVector::Dist(Snapshot.MonsterLocation, Snapshot.PlayerLocation) / FMath::Max(Snapshot.RunSpeed, 1.0f), Snapshot.MaxInterceptPredictionTime);
+			Intercept += Snapshot.PlayerVelocity * TimeToReach;
+		}
+
+		//moving the target makes the monster find a new path, so leave it alone until the prediction has drifted far enough.
+		//the allowed drift shrinks as the monster closes in, so it doesn't stop short of the player on the last stretch
+		const float RepathDistance = FMath::Min(Snapshot.ChaseRepathDistance, FVector::Dist(Snapshot.MonsterLocation, Intercept) * 0.5f);
+		if (FVector::DistSquared(Snapshot.TargetLocation, Intercept) >= FMath::Square(RepathDistance))
+		{
+			Result.Decision = EMonsterDecision::MoveChaseTarget;
+			Result.Location = Intercept;
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	return Result;
+}
+
+void UMonsterDecisionSystem::Apply(const float Now)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterDecisionApply);
+
+	for (int32 i = 0; i < Decisions.Num(); ++i)
+	{
+		const FMonsterDecisionResult& Result = Decisions[i];
+		AMonsterAIController* Controller = DueControllers[i].Get();
+		const AMonster* Monster = Controller ? Cast<AMonster>(Controller->GetPawn()) : nullptr;
+		if (Result.Decision == EMonsterDecision::None || !Monster) { continue; }
+
+		switch (Result.Decision)
+		{
+		case EMonsterDecision::ChooseWanderTarget:
+		{
+			//bring the stored radius up to date now that it is about to be used
+			Controller->GetMonsterBlackboard().SetWanderRadius(Result.Radius);
+			if (FEntry* Entry = FindEntry(Controller, Snapshots[i].ServiceState))
+			{
+				Entry->LastQueryTime = Now;
+			}
+
+			//choosing the target is the expensive part, it runs when the query scheduler has budget for it
+			const TWeakObjectPtr<const AMonster> WeakMonster(Monster);
+			const float WanderRadius = Result.Radius;
+			Controller->ScheduleQuery([Controller, WeakMonster, WanderRadius]()
+			{
+				if (WeakMonster.IsValid())
+				{
+					UBTService_CheckWanderStatus::ChooseTarget(*Controller, *WeakMonster, WanderRadius);
+				}
+			});
+			break;
+		}
+
+		case EMonsterDecision::ChooseSearchTarget:
+		{
+			const TWeakObjectPtr<const AMonster> WeakMonster(Monster);
+			const float WanderRadius = Result.Radius;
+			Controller->ScheduleQuery([Controller, WeakMonster, WanderRadius]()
+			{
+				if (WeakMonster.IsValid())
+				{
+					UBTService_CheckSearchStatus::ChooseTarget(*Controller, *WeakMonster, WanderRadius);
+				}
+			});
+			break;
+		}
+
+		case EMonsterDecision::StartSearch:
+			Controller->StartSearch(Result.Location);
+			break;
+
+		case EMonsterDecision::MoveChaseTarget:
+			UBTService_CheckGoToPlayerStatus::MoveChaseTarget(*Controller, Result.Location, Snapshots[i].PlayerLocation);
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+ETickableTickType UMonsterDecisionSystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UMonsterDecisionSystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonsterDecisionSystem, STATGROUP_Tickables);
+}
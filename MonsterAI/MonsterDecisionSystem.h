@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterDecisionSystem.generated.h"
+
+/**
+ * Copy of everything a monster's state service needs to decide what to do, taken on the game thread
+ */
+struct FMonsterDecisionSnapshot
+{
+	/** State of the service that is deciding, an EGurneyMonsterStates */
+	uint8 ServiceState = 0;
+	/** Where the monster is */
+	FVector MonsterLocation = FVector::ZeroVector;
+	/** The monster's target location */
+	FVector TargetLocation = FVector::ZeroVector;
+	/** True if a new target is already being chosen */
+	bool bTargetQueryPending = false;
+	/** Wander radius stored on the blackboard */
+	float WanderRadius = 0.0f;
+	/** Radius the wander radius grows towards */
+	float DesiredWanderRadius = 0.0f;
+	/** Seconds since the monster last chose a wander target, or since wandering started */
+	float TimeSinceLastQuery = 0.0f;
+	/** The monster's run speed */
+	float RunSpeed = 0.0f;
+	/** True if going to the player heads for a predicted intercept point */
+	bool bPredictIntercept = false;
+	/** Farthest ahead in seconds the player's movement is predicted */
+	float MaxInterceptPredictionTime = 0.0f;
+	/** How far the intercept point has to drift before the chase target moves */
+	float ChaseRepathDistance = 0.0f;
+	/** True if there is a player */
+	bool bHasPlayer = false;
+	/** Where the player is */
+	FVector PlayerLocation = FVector::ZeroVector;
+	/** How fast the player is moving */
+	FVector PlayerVelocity = FVector::ZeroVector;
+};
+
+/**
+ * What a monster decided to do
+ */
+enum class EMonsterDecision : uint8
+{
+	None,
+	/** Choose a new wander target within Radius */
+	ChooseWanderTarget,
+	/** Choose a new search target within Radius */
+	ChooseSearchTarget,
+	/** Start searching around Location */
+	StartSearch,
+	/** Move the chase target to the predicted intercept point at Location */
+	MoveChaseTarget
+};
+
+struct FMonsterDecisionResult
+{
+	EMonsterDecision Decision = EMonsterDecision::None;
+	FVector Location = FVector::ZeroVector;
+	float Radius = 0.0f;
+};
+
+/**
+ * Runs the monster state services' decisions for every monster at once, in three passes:
+ * gather snapshots of each monster and the player on the game thread, decide from the snapshots across worker threads,
+ * then apply the decisions (blackboard writes, sounds, queries and moves) back on the game thread.
+ * A service adds its monster while it is relevant in the behavior tree, and the monster decides as often as the service's interval
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterDecisionSystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * With fewer monsters deciding than this in a frame, the decide pass runs on the game thread. Waking workers would cost more
+	 */
+	static constexpr int32 MinParallelDecisions = 8;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/**
+	 * Start running a state service's decisions for a monster
+	 * @param Controller The monster's controller
+	 * @param ServiceState State of the service, an EGurneyMonsterStates
+	 * @param Interval Seconds between decisions
+	 */
+	void AddMonster(class AMonsterAIController* Controller, uint8 ServiceState, float Interval);
+
+	/**
+	 * Stop running a state service's decisions for a monster
+	 * @param Controller The monster's controller
+	 * @param ServiceState State of the service, an EGurneyMonsterStates
+	 */
+	void RemoveMonster(const class AMonsterAIController* Controller, uint8 ServiceState);
+
+	/**
+	 * Decides what a monster should do. Reads nothing but the snapshot, so it is safe to call from any thread
+	 * @param Snapshot The monster's snapshot
+	 * @return The decision
+	 */
+	static FMonsterDecisionResult Decide(const FMonsterDecisionSnapshot& Snapshot);
+
+#pragma region FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+#pragma endregion
+
+private:
+	struct FEntry
+	{
+		/** The monster's controller */
+		TWeakObjectPtr<class AMonsterAIController> Controller;
+		/** State of the service deciding for it */
+		uint8 ServiceState;
+		/** Seconds between decisions */
+		float Interval;
+		/** World time of the next decision */
+		float NextDecisionTime;
+		/** World time a wander target was last chosen, or wandering started */
+		float LastQueryTime;
+	};
+
+	/**
+	 * Takes snapshots of the monsters due to decide this frame
+	 * @param Now The current world time
+	 */
+	void Gather(float Now);
+
+	/**
+	 * Carries out the decisions
+	 * @param Now The current world time
+	 */
+	void Apply(float Now);
+
+	/**
+	 * @param Controller The monster's controller
+	 * @param ServiceState State of the service
+	 * @return The monster's entry for the service, or nullptr if it has none
+	 */
+	FEntry* FindEntry(const class AMonsterAIController* Controller, uint8 ServiceState);
+
+	/**
+	 * The monsters with a relevant state service, in the order they were added
+	 */
+	TArray<FEntry> Entries;
+
+	/**
+	 * This frame's passes. Kept between frames so they don't allocate
+	 */
+	TArray<TWeakObjectPtr<class AMonsterAIController>> DueControllers;
+	TArray<FMonsterDecisionSnapshot> Snapshots;
+	TArray<FMonsterDecisionResult> Decisions;
+};
@@ -0,0 +1,644 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterHordeSystem.h"
+
+#include "Monster.h"
+#include "MonsterAcousticGraph.h"
+#include "MonsterAIController.h"
+#include "MonsterAIStats.h"
+#include "MonsterNoiseBus.h"
+#include "MonsterPathCache.h"
+#include "MonsterReachablePointPool.h"
+#include "MonsterRunAwaySystem.h"
+#include "MonsterStates.h"
+#include "WorldActorRegistry.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarMonsterHordeFullMonsters(
+		TEXT("MonsterAI.HordeFullMonsters"),
+		-1,
+		TEXT("Number of active monsters nearest the player that keep a full AI controller, the rest are run by the horde system. Negative turns the horde off"));
+}
+
+#pragma region FMonsterHorde
+int32 FMonsterHorde::Add(AMonster* Monster, const FMonsterHordeMember& Member, const float HalfHeight, const int32 Tuning, const float Now)
+{
+	Monsters.Add(Monster);
+	States.Add(Member.State);
+	Locations.Add(Monster->GetActorLocation());
+	TargetLocations.Add(Member.TargetLocation);
+	SearchCenters.Add(Member.SearchCenter);
+	WanderRadii.Add(Member.WanderRadius);
+	StateTimeRemaining.Add(Member.StateTimeRemaining);
+	WalkSpeeds.Add(Member.WalkSpeed);
+	PursueEndTimes.Add(Member.TimeSincePursue < 0 ? -1.0f : Now - Member.TimeSincePursue);
+	HalfHeights.Add(HalfHeight);
+	Tunings.Add(Tuning);
+	NeedsPath.Add(true);
+	NextRepathTimes.Add(0.0f);
+	PathPoints.AddZeroed(MaxPathPoints);
+	PathLengths.Add(0);
+	PathIndices.Add(0);
+	return Monsters.Num() - 1;
+}
+
+void FMonsterHorde::RemoveAtSwap(const int32 Index)
+{
+	Monsters.RemoveAtSwap(Index, 1, false);
+	States.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	TargetLocations.RemoveAtSwap(Index, 1, false);
+	SearchCenters.RemoveAtSwap(Index, 1, false);
+	WanderRadii.RemoveAtSwap(Index, 1, false);
+	StateTimeRemaining.RemoveAtSwap(Index, 1, false);
+	WalkSpeeds.RemoveAtSwap(Index, 1, false);
+	PursueEndTimes.RemoveAtSwap(Index, 1, false);
+	HalfHeights.RemoveAtSwap(Index, 1, false);
+	Tunings.RemoveAtSwap(Index, 1, false);
+	NeedsPath.RemoveAtSwap(Index, 1, false);
+	NextRepathTimes.RemoveAtSwap(Index, 1, false);
+	PathLengths.RemoveAtSwap(Index, 1, false);
+	PathIndices.RemoveAtSwap(Index, 1, false);
+
+	//the path points move in blocks, the last monster's block takes the removed one's place
+	const int32 LastBlock = PathPoints.Num() - MaxPathPoints;
+	if (Index * MaxPathPoints != LastBlock)
+	{
+		FMemory::Memcpy(&PathPoints[Index * MaxPathPoints], &PathPoints[LastBlock], MaxPathPoints * sizeof(FVector));
+	}
+	PathPoints.RemoveAt(LastBlock, MaxPathPoints, false);
+}
+
+FMonsterHordeMember FMonsterHorde::GetMember(const int32 Index, const float Now) const
+{
+	FMonsterHordeMember Member;
+	Member.State = States[Index];
+	Member.TargetLocation = TargetLocations[Index];
+	Member.SearchCenter = SearchCenters[Index];
+	Member.WanderRadius = WanderRadii[Index];
+	Member.StateTimeRemaining = StateTimeRemaining[Index];
+	Member.WalkSpeed = WalkSpeeds[Index];
+	Member.TimeSincePursue = PursueEndTimes[Index] < 0 ? -1.0f : Now - PursueEndTimes[Index];
+	return Member;
+}
+#pragma endregion
+
+bool UMonsterHordeSystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have monsters to run
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMonsterHordeSystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterHordeTick);
+
+	const int32 MaxFullMonsters = CVarMonsterHordeFullMonsters.GetValueOnGameThread();
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (LastRebalanceTime < 0 || Now - LastRebalanceTime >= RebalanceInterval)
+	{
+		LastRebalanceTime = Now;
+
+		//with the horde off there is nothing to do unless it was just turned off and still has members to hand back
+		if (MaxFullMonsters >= 0 || Horde.Num() > 0)
+		{
+			Rebalance(MaxFullMonsters, Now);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_MonsterHordeMembers, Horde.Num());
+	if (Horde.Num() < 1) { return; }
+
+	UpdateTimers(DeltaTime);
+	UpdateTargets(Now);
+	UpdatePaths();
+	UpdateMovement(DeltaTime);
+}
+
+void UMonsterHordeSystem::Rebalance(const int32 MaxFullMonsters, const float Now)
+{
+	//members whose monster was destroyed
+	for (int32 i = Horde.Num() - 1; i >= 0; --i)
+	{
+		if (!Horde.Monsters[i].IsValid())
+		{
+			Horde.RemoveAtSwap(i);
+		}
+	}
+
+	//monsters that switched long enough ago are free to switch again
+	for (auto It = SwitchTimes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || Now - It.Value() >= MinSwitchInterval)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if (MaxFullMonsters < 0)
+	{
+		while (Horde.Num() > 0)
+		{
+			Promote(Horde.Num() - 1);
+		}
+		SwitchTimes.Reset();
+		return;
+	}
+
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	const AActor* Player = Registry ? Registry->GetPlayer() : nullptr;
+	if (!Player) { return; }
+	const FVector PlayerLocation = Player->GetActorLocation();
+
+	//every active monster, full or in the horde, ranked by distance to the player
+	struct FCandidate
+	{
+		float DistSquared;
+		AMonster* Monster;
+		AMonsterAIController* Controller;
+	};
+	TArray<FCandidate> Candidates;
+	int32 NumFull = 0;
+	for (TActorIterator<AMonster> It(GetWorld()); It; ++It)
+	{
+		AMonsterAIController* Controller = Cast<AMonsterAIController>(It->GetController());
+		if (!Controller) { continue; }
+
+		//inactive monsters are waiting to be activated through their controller
+		if (Controller->GetMonsterCurrentState() == EGurneyMonsterStates::GMS_Inactive) { continue; }
+
+		Candidates.Add({ FVector::DistSquared(It->GetActorLocation(), PlayerLocation), *It, Controller });
+		++NumFull;
+	}
+	for (int32 i = 0; i < Horde.Num(); ++i)
+	{
+		Candidates.Add({ FVector::DistSquared(Horde.Locations[i], PlayerLocation), Horde.Monsters[i].Get(), nullptr });
+	}
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.DistSquared < B.DistSquared; });
+
+	//full monsters past the cut off are demoted, farthest first, once they are well past it or there are too many of them
+	const float DemoteDistSquared = MaxFullMonsters > 0 && Candidates.IsValidIndex(MaxFullMonsters - 1)
+		? Candidates[MaxFullMonsters - 1].DistSquared * FMath::Square(DemoteDistanceRatio)
+		: 0.0f;
+	for (int32 i = Candidates.Num() - 1; i >= MaxFullMonsters; --i)
+	{
+		if (!Candidates[i].Controller || SwitchTimes.Contains(Candidates[i].Monster)) { continue; }
+		if (NumFull <= MaxFullMonsters && Candidates[i].DistSquared <= DemoteDistSquared) { continue; }
+
+		SwitchTimes.Add(Candidates[i].Monster, Now);
+		Demote(Candidates[i].Controller);
+		--NumFull;
+	}
+
+	//members within the cut off are promoted, nearest first, into whatever slots are free
+	for (int32 i = 0; i < Candidates.Num() && i < MaxFullMonsters && NumFull < MaxFullMonsters; ++i)
+	{
+		if (Candidates[i].Controller || SwitchTimes.Contains(Candidates[i].Monster)) { continue; }
+
+		SwitchTimes.Add(Candidates[i].Monster, Now);
+		Promote(Horde.Monsters.IndexOfByKey(Candidates[i].Monster));
+		++NumFull;
+	}
+}
+
+void UMonsterHordeSystem::Demote(AMonsterAIController* Controller)
+{
+	AMonster* Monster = Cast<AMonster>(Controller->GetPawn());
+	if (!Monster) { return; }
+
+	FMonsterHordeMember Member;
+	Controller->GetHordeMember(Member);
+	const int32 Tuning = FindOrAddTuning(Controller);
+
+	Controller->UnPossess();
+	Controller->Destroy();
+
+	//the horde moves the monster itself
+	if (UPawnMovementComponent* Movement = Monster->GetMovementComponent())
+	{
+		Movement->StopMovementImmediately();
+		Movement->SetComponentTickEnabled(false);
+	}
+
+	Horde.Add(Monster, Member, Monster->GetSimpleCollisionHalfHeight(), Tuning, GetWorld()->GetTimeSeconds());
+	INC_DWORD_STAT(STAT_MonsterHordeDemotions);
+}
+
+void UMonsterHordeSystem::Promote(const int32 Index)
+{
+	if (!Horde.Monsters.IsValidIndex(Index)) { return; }
+
+	AMonster* Monster = Horde.Monsters[Index].Get();
+	const FMonsterHordeMember Member = Horde.GetMember(Index, GetWorld()->GetTimeSeconds());
+	Horde.RemoveAtSwap(Index);
+	if (!Monster) { return; }
+
+	if (UPawnMovementComponent* Movement = Monster->GetMovementComponent())
+	{
+		Movement->SetComponentTickEnabled(true);
+	}
+
+	//possessing sets the controller up from scratch, then it carries on from where the horde left off
+	Monster->SpawnDefaultController();
+	if (AMonsterAIController* Controller = Cast<AMonsterAIController>(Monster->GetController()))
+	{
+		Controller->SetHordeMember(Member);
+	}
+	INC_DWORD_STAT(STAT_MonsterHordePromotions);
+}
+
+int32 UMonsterHordeSystem::FindOrAddTuning(const AMonsterAIController* Controller)
+{
+	const AMonsterAIController* Defaults = Controller->GetClass()->GetDefaultObject<AMonsterAIController>();
+	const int32 Existing = Tunings.IndexOfByPredicate([Defaults](const FTuning& Tuning) { return Tuning.Defaults == Defaults; });
+	if (Existing != INDEX_NONE) { return Existing; }
+
+	FTuning& Tuning = Tunings.AddDefaulted_GetRef();
+	Tuning.Defaults = Defaults;
+	Tuning.WanderRadius = Defaults->GetDesiredWanderRadius();
+	Tuning.SearchRadius = Defaults->GetDesiredSearchRadius();
+	Tuning.SearchDuration = Defaults->GetDesiredSearchDuration();
+	Tuning.RunSpeed = Defaults->GetDesiredRunSpeed();
+	Tuning.PursueInsteadOfSearchRadius = Defaults->GetDesiredPursueInsteadOfSearchRadius();
+	Tuning.bUseNavDistanceTable = Defaults->UseNavDistanceTable();
+	return Tunings.Num() - 1;
+}
+
+void UMonsterHordeSystem::HandleNoiseBatch(const TArray<FMonsterNoiseEvent>& Events)
+{
+	if (Horde.Num() < 1) { return; }
+
+	//if player is safe, don't respond
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	if (Registry && Registry->IsPlayerSafe()) { return; }
+
+	for (const FMonsterNoiseEvent& Event : Events)
+	{
+		if (Event.bIsAudioLog) { continue; }
+
+		const float HearableRadiusSquared = FMath::Square(Event.HearableRadius);
+		for (int32 i = 0; i < Horde.Num(); ++i)
+		{
+			//the hearing distance is never shorter than the straight line
+			if (FVector::DistSquared(Event.Origin, Horde.Locations[i]) >= HearableRadiusSquared) { continue; }
+
+			MonsterStateRules::FInputs Inputs;
+			Inputs.State = static_cast<MonsterStateRules::EState>(Horde.States[i]);
+			Inputs.Event = MonsterStateRules::EEvent::Sound;
+			Inputs.Distance = FMonsterAcousticGraph::GetDirectHearingDistance(Event.Origin, Horde.Locations[i]);
+			Inputs.HearableRadius = Event.HearableRadius;
+			Inputs.PursueInsteadOfSearchRadius = Tunings[Horde.Tunings[i]].PursueInsteadOfSearchRadius;
+			Inputs.HowLongToGoToPlayer = Event.HowLongToGoToPlayer;
+
+			FVector Origin = Event.Origin;
+			Origin.Z = Horde.Locations[i].Z;
+			ApplyTransition(i, MonsterStateRules::Transition(Inputs), Origin);
+		}
+	}
+}
+
+void UMonsterHordeSystem::UpdateTimers(const float DeltaTime)
+{
+	for (int32 i = 0; i < Horde.Num(); ++i)
+	{
+		if (Horde.StateTimeRemaining[i] <= 0) { continue; }
+
+		Horde.StateTimeRemaining[i] -= DeltaTime;
+		if (Horde.StateTimeRemaining[i] > 0) { continue; }
+		Horde.StateTimeRemaining[i] = 0.0f;
+
+		//one timer serves both states, leaving either stops it
+		MonsterStateRules::FInputs Inputs;
+		Inputs.State = static_cast<MonsterStateRules::EState>(Horde.States[i]);
+		Inputs.Event = Horde.States[i] == EGurneyMonsterStates::GMS_Search ? MonsterStateRules::EEvent::SearchTimeUp : MonsterStateRules::EEvent::GoToPlayerTimeUp;
+		Inputs.Distance = FVector::Distance(Horde.Locations[i], Horde.TargetLocations[i]);
+		ApplyTransition(i, MonsterStateRules::Transition(Inputs), Horde.Locations[i]);
+	}
+}
+
+void UMonsterHordeSystem::UpdateTargets(const float Now)
+{
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	const AActor* Player = Registry ? Registry->GetPlayer() : nullptr;
+	const bool bPlayerSafe = Player && Registry->IsPlayerSafe();
+
+	//like full monsters, wandering members head away from the player as soon as they are safe
+	const uint32 SafetyChangeCount = Registry ? Registry->GetPlayerSafetyChangeCount() : 0;
+	const bool bBecameSafe = bPlayerSafe && SafetyChangeCount != PlayerSafetyChangeCount;
+	PlayerSafetyChangeCount = SafetyChangeCount;
+
+	for (int32 i = 0; i < Horde.Num(); ++i)
+	{
+		const float Distance = FVector::Distance(Horde.Locations[i], Horde.TargetLocations[i]);
+		const bool bReachedTarget = !Horde.NeedsPath[i] && Distance < MonsterStateRules::ArrivalRadius;
+
+		switch (Horde.States[i])
+		{
+		case EGurneyMonsterStates::GMS_Wander:
+			//if within a tolerable radius of the target location, choose a new target
+			if (!bReachedTarget && !bBecameSafe) { break; }
+
+			Horde.TargetLocations[i] = ChooseWanderTarget(i, Now, Player, bPlayerSafe);
+			Horde.NeedsPath[i] = true;
+			break;
+
+		case EGurneyMonsterStates::GMS_Search:
+			if (!bReachedTarget) { break; }
+
+			Horde.TargetLocations[i] = ChooseSearchTarget(i);
+			Horde.NeedsPath[i] = true;
+			break;
+
+		case EGurneyMonsterStates::GMS_Pursue:
+		{
+			MonsterStateRules::FInputs Inputs;
+			Inputs.State = MonsterStateRules::EState::Pursue;
+			Inputs.Event = MonsterStateRules::EEvent::ReachedTarget;
+			Inputs.Distance = Distance;
+			ApplyTransition(i, MonsterStateRules::Transition(Inputs), Horde.Locations[i]);
+			break;
+		}
+
+		case EGurneyMonsterStates::GMS_GoToPlayer:
+			if (Player && Now >= Horde.NextRepathTimes[i])
+			{
+				Horde.NextRepathTimes[i] = Now + GoToPlayerRepathInterval;
+				Horde.TargetLocations[i] = Player->GetActorLocation();
+				Horde.NeedsPath[i] = true;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+FVector UMonsterHordeSystem::ChooseWanderTarget(const int32 Index, const float Now, const AActor* Player, const bool bPlayerSafe)
+{
+	const FVector& Location = Horde.Locations[Index];
+
+	//the same choice the wander service makes, with the member's own time since pursue
+	MonsterStateRules::FWanderChoice Choice;
+	if (Player)
+	{
+		MonsterStateRules::FWanderInputs Inputs;
+		Inputs.bPlayerSafe = bPlayerSafe;
+		Inputs.DistanceToPlayer = FVector::Distance(Player->GetActorLocation(), Location);
+		Inputs.TimeSincePursue = Horde.PursueEndTimes[Index] < 0 ? -1.0f : Now - Horde.PursueEndTimes[Index];
+		Choice = MonsterStateRules::ChooseWanderTarget(Inputs);
+		if (Choice.TimeSincePursue != Inputs.TimeSincePursue)
+		{
+			Horde.PursueEndTimes[Index] = Choice.TimeSincePursue < 0 ? -1.0f : Now - Choice.TimeSincePursue;
+		}
+	}
+
+	const UMonsterRunAwaySystem* RunAwaySystem = GetWorld()->GetSubsystem<UMonsterRunAwaySystem>();
+	const bool bUseNavDistanceTable = Tunings[Horde.Tunings[Index]].bUseNavDistanceTable;
+	int32 RunAway = INDEX_NONE;
+	switch (Choice.Target)
+	{
+	case MonsterStateRules::EWanderTarget::AwayFromPlayer:
+		RunAway = RunAwaySystem ? RunAwaySystem->FindFarthest(Player->GetActorLocation(), bUseNavDistanceTable) : INDEX_NONE;
+		break;
+
+	case MonsterStateRules::EWanderTarget::FarthestRunaway:
+		RunAway = RunAwaySystem ? RunAwaySystem->FindFarthest(Location, bUseNavDistanceTable) : INDEX_NONE;
+		break;
+
+	case MonsterStateRules::EWanderTarget::RandomPoint:
+	{
+		UMonsterReachablePointPool* PointPool = GetWorld()->GetSubsystem<UMonsterReachablePointPool>();
+		FVector Point;
+		if (PointPool && PointPool->GetRandomPoint(Location, Location, Horde.WanderRadii[Index], Random, Point)) { return Point; }
+
+		//no point to wander to, head for a runaway location instead of standing on the old target
+		return GetClosestRunawayLocation(Index);
+	}
+	}
+	return RunAway != INDEX_NONE ? RunAwaySystem->GetLocations()[RunAway] : Location;
+}
+
+FVector UMonsterHordeSystem::ChooseSearchTarget(const int32 Index)
+{
+	const FVector& Location = Horde.Locations[Index];
+
+	//search around the search focus area, then around self, and as a last resort go to a runaway location
+	UMonsterReachablePointPool* PointPool = GetWorld()->GetSubsystem<UMonsterReachablePointPool>();
+	FVector Point;
+	if (PointPool && (PointPool->GetRandomPoint(Location, Horde.SearchCenters[Index], Horde.WanderRadii[Index], Random, Point)
+		|| PointPool->GetRandomPoint(Location, Location, Horde.WanderRadii[Index], Random, Point)))
+	{
+		return Point;
+	}
+	return GetClosestRunawayLocation(Index);
+}
+
+FVector UMonsterHordeSystem::GetClosestRunawayLocation(const int32 Index) const
+{
+	const FVector& Location = Horde.Locations[Index];
+	const UMonsterRunAwaySystem* RunAwaySystem = GetWorld()->GetSubsystem<UMonsterRunAwaySystem>();
+	if (!RunAwaySystem) { return Location; }
+
+	const int32 Closest = RunAwaySystem->FindClosest(Location, 50, Tunings[Horde.Tunings[Index]].bUseNavDistanceTable);
+	return Closest != INDEX_NONE ? RunAwaySystem->GetLocations()[Closest] : Location;
+}
+
+void UMonsterHordeSystem::UpdatePaths()
+{
+	UMonsterPathCache* PathCache = GetWorld()->GetSubsystem<UMonsterPathCache>();
+	if (!PathCache) { return; }
+
+	//take turns, so a crowd needing paths at once is served over a few frames
+	int32 NumPaths = 0;
+	int32 Checked = 0;
+	for (; Checked < Horde.Num() && NumPaths < MaxPathsPerFrame; ++Checked)
+	{
+		const int32 i = (NextPathIndex + Checked) % Horde.Num();
+		if (!Horde.NeedsPath[i]) { continue; }
+		Horde.NeedsPath[i] = false;
+		Horde.PathLengths[i] = 0;
+		Horde.PathIndices[i] = 0;
+		++NumPaths;
+
+		//the horde shares its paths with the full monsters
+		const FNavPathSharedPtr Path = PathCache->FindPath(this, Horde.Locations[i] - FVector(0.0f, 0.0f, Horde.HalfHeights[i]), Horde.TargetLocations[i]);
+		if (!Path.IsValid())
+		{
+			//give up on the target, the monster arrives where it stands and picks or gets another
+			Horde.TargetLocations[i] = Horde.Locations[i];
+			continue;
+		}
+
+		//the first point is where the monster already is
+		const TArray<FNavPathPoint>& Points = Path->GetPathPoints();
+		const int32 NumPoints = FMath::Min(Points.Num() - 1, FMonsterHorde::MaxPathPoints);
+		for (int32 Point = 0; Point < NumPoints; ++Point)
+		{
+			Horde.PathPoints[i * FMonsterHorde::MaxPathPoints + Point] = Points[Point + 1].Location;
+		}
+		Horde.PathLengths[i] = NumPoints;
+	}
+	NextPathIndex = Horde.Num() > 0 ? (NextPathIndex + Checked) % Horde.Num() : 0;
+	INC_DWORD_STAT_BY(STAT_MonsterHordePaths, NumPaths);
+}
+
+void UMonsterHordeSystem::UpdateMovement(const float DeltaTime)
+{
+	for (int32 i = 0; i < Horde.Num(); ++i)
+	{
+		if (Horde.PathIndices[i] >= Horde.PathLengths[i]) { continue; }
+
+		const bool bRunning = MonsterStateRules::IsAggressive(static_cast<MonsterStateRules::EState>(Horde.States[i]));
+		float Step = (bRunning ? Tunings[Horde.Tunings[i]].RunSpeed : Horde.WalkSpeeds[i]) * DeltaTime;
+		FVector& Location = Horde.Locations[i];
+		FVector Direction = FVector::ZeroVector;
+
+		while (Step > 0 && Horde.PathIndices[i] < Horde.PathLengths[i])
+		{
+			const FVector Point = Horde.PathPoints[i * FMonsterHorde::MaxPathPoints + Horde.PathIndices[i]] + FVector(0.0f, 0.0f, Horde.HalfHeights[i]);
+			const FVector ToPoint = Point - Location;
+			const float PointDistance = ToPoint.Size();
+			if (PointDistance > KINDA_SMALL_NUMBER)
+			{
+				Direction = ToPoint / PointDistance;
+			}
+			if (PointDistance <= Step)
+			{
+				Location = Point;
+				Step -= PointDistance;
+				++Horde.PathIndices[i];
+				continue;
+			}
+			Location += Direction * Step;
+			Step = 0.0f;
+		}
+
+		//the stored path was cut short, find the rest
+		if (Horde.PathIndices[i] >= Horde.PathLengths[i] && FVector::DistSquared2D(Location, Horde.TargetLocations[i]) > FMath::Square(PathEndRadius))
+		{
+			Horde.NeedsPath[i] = true;
+		}
+
+		if (AMonster* Monster = Horde.Monsters[i].Get())
+		{
+			const FRotator Facing = Direction.IsNearlyZero() ? Monster->GetActorRotation() : FRotator(0.0f, Direction.Rotation().Yaw, 0.0f);
+			Monster->SetActorLocationAndRotation(Location, Facing);
+		}
+	}
+}
+
+template <MonsterStateRules::EState State>
+void UMonsterHordeSystem::OnExitState(const int32 Index, const FVector& Location)
+{
+}
+
+template <>
+void UMonsterHordeSystem::OnExitState<MonsterStateRules::EState::GoToPlayer>(const int32 Index, const FVector& Location)
+{
+	Horde.StateTimeRemaining[Index] = 0.0f;
+}
+
+template <>
+void UMonsterHordeSystem::OnExitState<MonsterStateRules::EState::Search>(const int32 Index, const FVector& Location)
+{
+	Horde.StateTimeRemaining[Index] = 0.0f;
+}
+
+template <MonsterStateRules::EState State>
+void UMonsterHordeSystem::OnEnterState(const MonsterStateRules::FTransition& Transition, const int32 Index, const FVector& Location)
+{
+	Horde.States[Index] = static_cast<uint8>(State);
+}
+
+template <>
+void UMonsterHordeSystem::OnEnterState<MonsterStateRules::EState::Wander>(const MonsterStateRules::FTransition& Transition, const int32 Index, const FVector& Location)
+{
+	Horde.States[Index] = EGurneyMonsterStates::GMS_Wander;
+	if (Transition.Entry == MonsterStateRules::EEntry::None) { return; }
+
+	Horde.WanderRadii[Index] = Tunings[Horde.Tunings[Index]].WanderRadius;
+	Horde.TargetLocations[Index] = Horde.Locations[Index];
+	Horde.NeedsPath[Index] = false;
+	Horde.PathLengths[Index] = 0;
+	if (Transition.Entry == MonsterStateRules::EEntry::Reset)
+	{
+		Horde.StateTimeRemaining[Index] = 0.0f;
+		Horde.PursueEndTimes[Index] = -1.0f;
+	}
+}
+
+template <>
+void UMonsterHordeSystem::OnEnterState<MonsterStateRules::EState::Pursue>(const MonsterStateRules::FTransition& Transition, const int32 Index, const FVector& Location)
+{
+	Horde.States[Index] = EGurneyMonsterStates::GMS_Pursue;
+
+	//pursuing after go to player keeps heading for where the player was
+	if (Transition.Entry == MonsterStateRules::EEntry::Pursue)
+	{
+		Horde.TargetLocations[Index] = Location;
+		Horde.NeedsPath[Index] = true;
+	}
+}
+
+template <>
+void UMonsterHordeSystem::OnEnterState<MonsterStateRules::EState::GoToPlayer>(const MonsterStateRules::FTransition& Transition, const int32 Index, const FVector& Location)
+{
+	Horde.States[Index] = EGurneyMonsterStates::GMS_GoToPlayer;
+
+	//a zero length state would never end, the earliest it can end is next frame
+	Horde.StateTimeRemaining[Index] = FMath::Max(Transition.GoToPlayerDuration, KINDA_SMALL_NUMBER);
+	Horde.NextRepathTimes[Index] = 0.0f;
+}
+
+template <>
+void UMonsterHordeSystem::OnEnterState<MonsterStateRules::EState::Search>(const MonsterStateRules::FTransition& Transition, const int32 Index, const FVector& Location)
+{
+	const FTuning& Tuning = Tunings[Horde.Tunings[Index]];
+	Horde.States[Index] = EGurneyMonsterStates::GMS_Search;
+	Horde.WanderRadii[Index] = Tuning.SearchRadius;
+	Horde.TargetLocations[Index] = Horde.Locations[Index];
+	Horde.SearchCenters[Index] = Location;
+	Horde.StateTimeRemaining[Index] = Tuning.SearchDuration;
+	Horde.NeedsPath[Index] = false;
+
+	//the pursuit is over, search until the timer runs out
+	Horde.PursueEndTimes[Index] = GetWorld()->GetTimeSeconds();
+	Horde.PathLengths[Index] = 0;
+}
+
+void UMonsterHordeSystem::PlayTransitionSound(const MonsterStateRules::ESound Sound, const int32 Index, const FVector& Location)
+{
+	AMonster* Monster = Horde.Monsters[Index].Get();
+	if (!Monster) { return; }
+
+	switch (Sound)
+	{
+	case MonsterStateRules::ESound::Detected:	Monster->PlayMonsterSound("PlayMonsterDetected"); break;
+	case MonsterStateRules::ESound::SearchLoop:	Monster->PlayMonsterSound("PlayMonsterSearchLoop"); break;
+	case MonsterStateRules::ESound::IdleLoop:	Monster->PlayMonsterSound("PlayMonsterIdleLoop"); break;
+	default: break;
+	}
+}
+
+void UMonsterHordeSystem::ApplyTransition(const int32 Index, const MonsterStateRules::FTransition& Transition, const FVector& Location)
+{
+	const MonsterStateRules::EState From = static_cast<MonsterStateRules::EState>(Horde.States[Index]);
+	MonsterStateRules::TStateMachine<UMonsterHordeSystem>::Apply(*this, From, Transition, Index, Location);
+}
+
+ETickableTickType UMonsterHordeSystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UMonsterHordeSystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonsterHordeSystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,317 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MonsterStateRules.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterHordeSystem.generated.h"
+
+/**
+ * One monster's AI state, handed over when a monster joins or leaves the horde
+ */
+struct FMonsterHordeMember
+{
+	/** The monster's state, an EGurneyMonsterStates */
+	uint8 State = 0;
+	/** The monster's target location */
+	FVector TargetLocation = FVector::ZeroVector;
+	/** Center of the area the monster searches */
+	FVector SearchCenter = FVector::ZeroVector;
+	/** Radius the monster picks wander and search targets in */
+	float WanderRadius = 0.0f;
+	/** Seconds until the search or go to player state ends on its own, 0 if neither is running */
+	float StateTimeRemaining = 0.0f;
+	/** The monster's walk speed */
+	float WalkSpeed = 0.0f;
+	/** Seconds since the monster stopped pursuing or came near the player, negative if it hasn't since it last left */
+	float TimeSincePursue = -1.0f;
+};
+
+/**
+ * The horde's monsters, stored as one array per field so each pass over the horde only touches the fields it needs.
+ * Every array has an element per monster, except PathPoints which has MaxPathPoints per monster
+ */
+struct FMonsterHorde
+{
+	/**
+	 * Most path points stored for a monster. Longer paths are cut short, the monster finds the rest when it reaches the end
+	 */
+	static constexpr int32 MaxPathPoints = 8;
+
+	TArray<TWeakObjectPtr<class AMonster>> Monsters;
+	/** EGurneyMonsterStates */
+	TArray<uint8> States;
+	TArray<FVector> Locations;
+	TArray<FVector> TargetLocations;
+	TArray<FVector> SearchCenters;
+	TArray<float> WanderRadii;
+	TArray<float> StateTimeRemaining;
+	TArray<float> WalkSpeeds;
+	/** World time the monster stopped pursuing or came near the player, negative if it hasn't since it last left */
+	TArray<float> PursueEndTimes;
+	/** Distance from the navmesh up to the monster's pivot */
+	TArray<float> HalfHeights;
+	/** Index into UMonsterHordeSystem's tunings, one per controller class */
+	TArray<int32> Tunings;
+	/** True when the monster needs a path to its target location */
+	TArray<bool> NeedsPath;
+	/** World time the monster next finds a new path to the player while going to the player */
+	TArray<float> NextRepathTimes;
+	TArray<FVector> PathPoints;
+	TArray<uint8> PathLengths;
+	/** Path point the monster is walking towards */
+	TArray<uint8> PathIndices;
+
+	/**
+	 * @return Number of monsters in the horde
+	 */
+	int32 Num() const { return Monsters.Num(); }
+
+	/**
+	 * Adds a monster to the end of every array
+	 * @param Monster The monster
+	 * @param Member The monster's AI state
+	 * @param HalfHeight Distance from the navmesh up to the monster's pivot
+	 * @param Tuning Index of the monster's tuning
+	 * @param Now The current world time
+	 * @return The monster's index
+	 */
+	int32 Add(class AMonster* Monster, const FMonsterHordeMember& Member, float HalfHeight, int32 Tuning, float Now);
+
+	/**
+	 * Removes a monster by moving the last monster into its place
+	 * @param Index The monster's index
+	 */
+	void RemoveAtSwap(int32 Index);
+
+	/**
+	 * @param Index The monster's index
+	 * @param Now The current world time
+	 * @return The monster's AI state
+	 */
+	FMonsterHordeMember GetMember(int32 Index, float Now) const;
+};
+
+/**
+ * Runs crowds of simple monsters without an AI controller, behavior tree or blackboard each.
+ * Only the MonsterAI.HordeFullMonsters active monsters nearest the player keep a full AMonsterAIController,
+ * the rest join the horde, whose state lives in FMonsterHorde and is updated for every member in a few tight passes a frame:
+ * state timers, target choices, pathfinding within a per-frame limit, then movement.
+ * Members follow MonsterStateRules, including its choice of wander target, and hear sounds from the noise bus like full
+ * monsters do, but choose their random targets from the reachable point pool without the heat map and use the straight line
+ * as the hearing distance.
+ * Members are moved directly along their paths with their movement component turned off, and are promoted back to
+ * full monsters as the player gets close. Off when MonsterAI.HordeFullMonsters is negative, the default
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterHordeSystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Seconds between choosing which monsters are full monsters
+	 */
+	static constexpr float RebalanceInterval = 1.0f;
+
+	/**
+	 * A full monster that is no longer one of the nearest keeps its controller until it is this many times farther from the player
+	 * than the farthest monster that is, so monsters near the cut off don't swap back and forth
+	 */
+	static constexpr float DemoteDistanceRatio = 1.25f;
+
+	/**
+	 * Seconds a promoted or demoted monster stays as it is before it can switch again, unless the horde is turned off
+	 */
+	static constexpr float MinSwitchInterval = 5.0f;
+
+	/**
+	 * Most paths found for the horde in one frame
+	 */
+	static constexpr int32 MaxPathsPerFrame = 4;
+
+	/**
+	 * Seconds between new paths to the player while going to the player
+	 */
+	static constexpr float GoToPlayerRepathInterval = 1.0f;
+
+	/**
+	 * A member that runs out of path points farther than this from its target finds the rest of the path
+	 */
+	static constexpr float PathEndRadius = 30.0f;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/**
+	 * Hands a batch of sounds to the horde. Called by the noise bus once the full monsters have had theirs
+	 * @param Events The sounds
+	 */
+	void HandleNoiseBatch(const TArray<struct FMonsterNoiseEvent>& Events);
+
+	/**
+	 * @return The horde's monsters
+	 */
+	const FMonsterHorde& GetHorde() const { return Horde; }
+
+#pragma region FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+#pragma endregion
+
+private:
+	/**
+	 * Settings taken from a monster controller class's defaults
+	 */
+	struct FTuning
+	{
+		const class AMonsterAIController* Defaults;
+		float WanderRadius;
+		float SearchRadius;
+		float SearchDuration;
+		float RunSpeed;
+		float PursueInsteadOfSearchRadius;
+		bool bUseNavDistanceTable;
+	};
+
+	/**
+	 * Promotes the monsters nearest the player to full monsters and demotes the rest into the horde,
+	 * within DemoteDistanceRatio and MinSwitchInterval
+	 * @param MaxFullMonsters Number of full monsters to keep
+	 * @param Now The current world time
+	 */
+	void Rebalance(int32 MaxFullMonsters, float Now);
+
+	/**
+	 * Takes a monster's controller away and adds it to the horde
+	 * @param Controller The monster's controller
+	 */
+	void Demote(class AMonsterAIController* Controller);
+
+	/**
+	 * Removes a monster from the horde and gives it a full controller again
+	 * @param Index The monster's index in the horde
+	 */
+	void Promote(int32 Index);
+
+	/**
+	 * Counts down the state timers and ends the states whose time is up
+	 * @param DeltaTime Seconds since last frame
+	 */
+	void UpdateTimers(float DeltaTime);
+
+	/**
+	 * Picks new targets for the members that reached theirs, and for wandering members when the player becomes safe,
+	 * and keeps the members going to the player on the player
+	 * @param Now The current world time
+	 */
+	void UpdateTargets(float Now);
+
+	/**
+	 * Picks a wandering member's next target the way the wander service does, without the heat map
+	 * @param Index The member
+	 * @param Now The current world time
+	 * @param Player The player, if there is one
+	 * @param bPlayerSafe True if the player is in a safe zone
+	 * @return The target
+	 */
+	FVector ChooseWanderTarget(int32 Index, float Now, const AActor* Player, bool bPlayerSafe);
+
+	/**
+	 * Picks a searching member's next target the way the search service does: around the search center, then around itself
+	 * @param Index The member
+	 * @return The target
+	 */
+	FVector ChooseSearchTarget(int32 Index);
+
+	/**
+	 * @param Index The member
+	 * @return The runaway location closest to the member, or its own location if there is none
+	 */
+	FVector GetClosestRunawayLocation(int32 Index) const;
+
+	/**
+	 * Finds paths for the members that need one, up to MaxPathsPerFrame
+	 */
+	void UpdatePaths();
+
+	/**
+	 * Moves the members along their paths and writes their locations to their actors
+	 * @param DeltaTime Seconds since last frame
+	 */
+	void UpdateMovement(float DeltaTime);
+
+	/**
+	 * Carries out a transition worked out by MonsterStateRules for a member, through MonsterStateRules::TStateMachine and the hooks below
+	 * @param Index The member
+	 * @param Transition The transition
+	 * @param Location Where the event happened
+	 */
+	void ApplyTransition(int32 Index, const MonsterStateRules::FTransition& Transition, const FVector& Location);
+
+	friend struct MonsterStateRules::TStateMachine<UMonsterHordeSystem>;
+
+	/**
+	 * Plays a transition's sound on a member's actor
+	 * @param Sound The sound
+	 * @param Index The member
+	 * @param Location Where the event happened
+	 */
+	void PlayTransitionSound(MonsterStateRules::ESound Sound, int32 Index, const FVector& Location);
+
+	/**
+	 * Stops whatever the state left running for a member. Only called when the state actually changes
+	 * @param Index The member
+	 * @param Location Where the event happened
+	 */
+	template <MonsterStateRules::EState State>
+	void OnExitState(int32 Index, const FVector& Location);
+
+	/**
+	 * Writes the state and whatever else its entry needs for a member
+	 * @param Transition The transition
+	 * @param Index The member
+	 * @param Location Where the event happened
+	 */
+	template <MonsterStateRules::EState State>
+	void OnEnterState(const MonsterStateRules::FTransition& Transition, int32 Index, const FVector& Location);
+
+	/**
+	 * @param Controller A monster's controller
+	 * @return Index of the tuning for the controller's class, added if it is new
+	 */
+	int32 FindOrAddTuning(const class AMonsterAIController* Controller);
+
+	FMonsterHorde Horde;
+
+	TArray<FTuning> Tunings;
+
+	/**
+	 * Member to look at first for a path next frame, so every member gets its turn
+	 */
+	int32 NextPathIndex = 0;
+
+	/**
+	 * World time of the last rebalance
+	 */
+	float LastRebalanceTime = -1.0f;
+
+	/**
+	 * World time each monster was last promoted or demoted, for the monsters that did so within MinSwitchInterval
+	 */
+	TMap<TWeakObjectPtr<class AMonster>, float> SwitchTimes;
+
+	/**
+	 * Source of the members' wander and search targets
+	 */
+	FRandomStream Random;
+
+	/**
+	 * The registry's player safety change count when the targets were last updated
+	 */
+	uint32 PlayerSafetyChangeCount = 0;
+};
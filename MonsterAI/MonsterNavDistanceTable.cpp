@@ -0,0 +1,425 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterNavDistanceTable.h"
+
+#include "MonsterAIStats.h"
+#include "NavigationSystem.h"
+#include "Detour/DetourNavMesh.h"
+#include "NavMesh/RecastHelpers.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	/** Bump when the file layout changes so old caches get rebaked */
+	constexpr int32 NavDistanceTableVersion = 3;
+
+	/** Upper bound on grid cells, the cell size grows to stay under it on very large maps */
+	constexpr int32 MaxCells = 16384;
+
+	/**
+	 * A polygon waiting to be expanded by a flood, ordered so the heap pops the cheapest first
+	 */
+	struct FOpenPoly
+	{
+		float Cost;
+		int32 Poly;
+
+		bool operator<(const FOpenPoly& Other) const { return Cost < Other.Cost; }
+	};
+
+	/**
+	 * @param DetourMesh The navmesh
+	 * @param TileFirstPoly Index of the first polygon of each tile, INDEX_NONE for empty tiles
+	 * @param Ref A polygon on the navmesh
+	 * @return The polygon's index in the numbering TileFirstPoly was built for, INDEX_NONE if it isn't in it
+	 */
+	int32 GetPolyIndex(const dtNavMesh& DetourMesh, const TArray<int32>& TileFirstPoly, const NavNodeRef Ref)
+	{
+		unsigned int Salt = 0;
+		unsigned int TileIndex = 0;
+		unsigned int PolyIndex = 0;
+		DetourMesh.decodePolyId(Ref, Salt, TileIndex, PolyIndex);
+		if (!TileFirstPoly.IsValidIndex(TileIndex) || TileFirstPoly[TileIndex] == INDEX_NONE) { return INDEX_NONE; }
+
+		return TileFirstPoly[TileIndex] + (int32)PolyIndex;
+	}
+}
+
+bool FMonsterNavDistanceTable::Build(UWorld* World, const TArray<FVector>& InTargets, const float InCellSize, const float InCellHeight)
+{
+	ResetBake();
+	Targets = InTargets;
+	CellRows.Reset();
+	Costs.Reset();
+	NumRows = 0;
+
+	const UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(World);
+	const ARecastNavMesh* NavMesh = NavSys ? Cast<ARecastNavMesh>(NavSys->MainNavData) : nullptr;
+	if (!NavMesh || !NavMesh->GetRecastMesh() || Targets.Num() < 1 || InCellSize <= 0 || InCellHeight <= 0) { return false; }
+
+	//lay the grid over the navmesh
+	const FBox NavBounds = NavMesh->GetBounds();
+	if (!NavBounds.IsValid) { return false; }
+
+	CellSize = InCellSize;
+	CellHeight = InCellHeight;
+	NavDataHash = HashNavData(*NavMesh);
+	Origin = NavBounds.Min;
+	const FVector Size = NavBounds.GetSize();
+	do
+	{
+		Dimensions = FIntVector(FMath::Max(1, FMath::CeilToInt(Size.X / CellSize)), FMath::Max(1, FMath::CeilToInt(Size.Y / CellSize)), FMath::Max(1, FMath::CeilToInt(Size.Z / CellHeight)));
+		if (Dimensions.X * Dimensions.Y * Dimensions.Z > MaxCells) { CellSize *= 1.5f; }
+	}
+	while (Dimensions.X * Dimensions.Y * Dimensions.Z > MaxCells);
+
+	//use the cached copy if nothing it depends on has changed
+	CachePath = GetCachePath(World);
+	TArray<uint8> FileData;
+	if (FFileHelper::LoadFileToArray(FileData, *CachePath, FILEREAD_Silent))
+	{
+		FMemoryReader Reader(FileData);
+		int32 Version = 0;
+		uint32 Hash = 0;
+		Reader << Version << Hash;
+		if (Version == NavDistanceTableVersion && Hash == GetSourceHash())
+		{
+			Serialize(Reader);
+			if (!Reader.IsError() && CellRows.Num() == Dimensions.X * Dimensions.Y * Dimensions.Z && Costs.Num() == NumRows * Targets.Num())
+			{
+				UE_LOG(LogMonsterAI, Log, TEXT("Loaded nav distance table from %s (%d regions, %d runaway locations)"), *CachePath, NumRows, Targets.Num());
+				return IsValid();
+			}
+		}
+		CellRows.Reset();
+		Costs.Reset();
+		NumRows = 0;
+	}
+
+	BeginBake(*NavMesh);
+	return false;
+}
+
+void FMonsterNavDistanceTable::BeginBake(const ARecastNavMesh& NavMesh)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterNavDistanceBake);
+	const double BakeStart = FPlatformTime::Seconds();
+	const dtNavMesh& DetourMesh = *NavMesh.GetRecastMesh();
+
+	//number the polygons tile by tile
+	TArray<int32> TileFirstPoly;
+	TileFirstPoly.Init(INDEX_NONE, DetourMesh.getMaxTiles());
+	int32 NumPolys = 0;
+	for (int32 i = 0; i < DetourMesh.getMaxTiles(); ++i)
+	{
+		const dtMeshTile* Tile = DetourMesh.getTile(i);
+		if (!Tile || !Tile->header) { continue; }
+
+		TileFirstPoly[i] = NumPolys;
+		NumPolys += Tile->header->polyCount;
+	}
+
+	//the middle of each polygon stands in for all of it, and the flood steps between the middles of linked polygons
+	TArray<FBox> PolyBounds;
+	PolyBounds.Reserve(NumPolys);
+	PolyCenters.Reset(NumPolys);
+	PolyLinkStart.Reset(NumPolys + 1);
+	PolyLinks.Reset();
+	for (int32 i = 0; i < DetourMesh.getMaxTiles(); ++i)
+	{
+		const dtMeshTile* Tile = DetourMesh.getTile(i);
+		if (TileFirstPoly[i] == INDEX_NONE) { continue; }
+
+		for (int32 p = 0; p < Tile->header->polyCount; ++p)
+		{
+			const dtPoly& Poly = Tile->polys[p];
+			FBox Bounds(ForceInit);
+			FVector Center = FVector::ZeroVector;
+			for (int32 v = 0; v < Poly.vertCount; ++v)
+			{
+				const FVector Vert = Recast2UnrealPoint(&Tile->verts[Poly.verts[v] * 3]);
+				Bounds += Vert;
+				Center += Vert;
+			}
+			PolyBounds.Add(Bounds);
+			PolyCenters.Add(Poly.vertCount > 0 ? Center / Poly.vertCount : Center);
+
+			PolyLinkStart.Add(PolyLinks.Num());
+			for (unsigned int Link = Poly.firstLink; Link != DT_NULL_LINK; Link = DetourMesh.getLink(Tile, Link).next)
+			{
+				const int32 Neighbour = GetPolyIndex(DetourMesh, TileFirstPoly, DetourMesh.getLink(Tile, Link).ref);
+				if (Neighbour != INDEX_NONE)
+				{
+					PolyLinks.Add(Neighbour);
+				}
+			}
+		}
+	}
+	PolyLinkStart.Add(PolyLinks.Num());
+
+	//each region is anchored to the polygon overlapping it whose middle is nearest the middle of the cell
+	const int32 NumCells = Dimensions.X * Dimensions.Y * Dimensions.Z;
+	TArray<int32> CellPolys;
+	TArray<float> CellPolyDistSquared;
+	CellPolys.Init(INDEX_NONE, NumCells);
+	CellPolyDistSquared.Init(MAX_flt, NumCells);
+	for (int32 Poly = 0; Poly < NumPolys; ++Poly)
+	{
+		if (!PolyBounds[Poly].IsValid) { continue; }
+
+		const int32 MinX = FMath::Clamp(FMath::FloorToInt((PolyBounds[Poly].Min.X - Origin.X) / CellSize), 0, Dimensions.X - 1);
+		const int32 MinY = FMath::Clamp(FMath::FloorToInt((PolyBounds[Poly].Min.Y - Origin.Y) / CellSize), 0, Dimensions.Y - 1);
+		const int32 MinZ = FMath::Clamp(FMath::FloorToInt((PolyBounds[Poly].Min.Z - Origin.Z) / CellHeight), 0, Dimensions.Z - 1);
+		const int32 MaxX = FMath::Clamp(FMath::FloorToInt((PolyBounds[Poly].Max.X - Origin.X) / CellSize), 0, Dimensions.X - 1);
+		const int32 MaxY = FMath::Clamp(FMath::FloorToInt((PolyBounds[Poly].Max.Y - Origin.Y) / CellSize), 0, Dimensions.Y - 1);
+		const int32 MaxZ = FMath::Clamp(FMath::FloorToInt((PolyBounds[Poly].Max.Z - Origin.Z) / CellHeight), 0, Dimensions.Z - 1);
+		for (int32 Z = MinZ; Z <= MaxZ; ++Z)
+		{
+			for (int32 Y = MinY; Y <= MaxY; ++Y)
+			{
+				for (int32 X = MinX; X <= MaxX; ++X)
+				{
+					const int32 Cell = (Z * Dimensions.Y + Y) * Dimensions.X + X;
+					const FVector CellCenter = Origin + FVector((X + 0.5f) * CellSize, (Y + 0.5f) * CellSize, (Z + 0.5f) * CellHeight);
+					const float DistSquared = FVector::DistSquared(CellCenter, PolyCenters[Poly]);
+					if (DistSquared < CellPolyDistSquared[Cell])
+					{
+						CellPolys[Cell] = Poly;
+						CellPolyDistSquared[Cell] = DistSquared;
+					}
+				}
+			}
+		}
+	}
+
+	CellRows.Init(INDEX_NONE, NumCells);
+	RowPolys.Reset();
+	for (int32 Cell = 0; Cell < NumCells; ++Cell)
+	{
+		if (CellPolys[Cell] == INDEX_NONE) { continue; }
+
+		CellRows[Cell] = NumRows++;
+		RowPolys.Add(CellPolys[Cell]);
+	}
+	Costs.Init(-1.0f, NumRows * Targets.Num());
+
+	//the floods start from the polygon each target stands on
+	const FVector TargetExtent(CellSize * 0.5f, CellSize * 0.5f, CellHeight * 0.5f);
+	TargetPolys.Reset(Targets.Num());
+	for (const FVector& Target : Targets)
+	{
+		const NavNodeRef Ref = NavMesh.FindNearestPoly(Target, TargetExtent);
+		TargetPolys.Add(Ref != INVALID_NAVNODEREF ? GetPolyIndex(DetourMesh, TileFirstPoly, Ref) : INDEX_NONE);
+	}
+
+	NextBakeTarget = 0;
+	BakeSeconds = FPlatformTime::Seconds() - BakeStart;
+	BakeSteps = 1;
+}
+
+bool FMonsterNavDistanceTable::BakeStep(const double MaxSeconds)
+{
+	if (!IsBaking()) { return true; }
+
+	SCOPE_CYCLE_COUNTER(STAT_MonsterNavDistanceBake);
+	const double StepStart = FPlatformTime::Seconds();
+	do
+	{
+		FloodTarget(NextBakeTarget++);
+	}
+	while (NextBakeTarget < Targets.Num() && FPlatformTime::Seconds() - StepStart < MaxSeconds);
+
+	BakeSeconds += FPlatformTime::Seconds() - StepStart;
+	++BakeSteps;
+	if (NextBakeTarget < Targets.Num()) { return false; }
+
+	FinishBake();
+	return true;
+}
+
+void FMonsterNavDistanceTable::FloodTarget(const int32 TargetIndex)
+{
+	const int32 Start = TargetPolys[TargetIndex];
+	if (Start == INDEX_NONE) { return; }
+
+	//Dijkstra from the target outward. Navmesh links almost always go both ways, so the distance out from the target
+	//is the distance back to it
+	TArray<float> PolyCosts;
+	PolyCosts.Init(-1.0f, PolyCenters.Num());
+	TArray<FOpenPoly> Open;
+	PolyCosts[Start] = FVector::Dist(Targets[TargetIndex], PolyCenters[Start]);
+	Open.HeapPush({ PolyCosts[Start], Start });
+	while (Open.Num() > 0)
+	{
+		FOpenPoly Current;
+		Open.HeapPop(Current, false);
+		if (Current.Cost > PolyCosts[Current.Poly]) { continue; }
+
+		for (int32 Link = PolyLinkStart[Current.Poly]; Link < PolyLinkStart[Current.Poly + 1]; ++Link)
+		{
+			const int32 Neighbour = PolyLinks[Link];
+			const float Cost = Current.Cost + FVector::Dist(PolyCenters[Current.Poly], PolyCenters[Neighbour]);
+			if (PolyCosts[Neighbour] < 0 || Cost < PolyCosts[Neighbour])
+			{
+				PolyCosts[Neighbour] = Cost;
+				Open.HeapPush({ Cost, Neighbour });
+			}
+		}
+	}
+
+	for (int32 Row = 0; Row < NumRows; ++Row)
+	{
+		Costs[Row * Targets.Num() + TargetIndex] = PolyCosts[RowPolys[Row]];
+	}
+}
+
+void FMonsterNavDistanceTable::FinishBake()
+{
+	//regions that can't reach anything aren't worth a row
+	TArray<int32> KeptRows;
+	KeptRows.Init(INDEX_NONE, NumRows);
+	int32 NumKept = 0;
+	for (int32 Row = 0; Row < NumRows; ++Row)
+	{
+		const float* RowCosts = &Costs[Row * Targets.Num()];
+		bool bAnyReachable = false;
+		for (int32 i = 0; i < Targets.Num() && !bAnyReachable; ++i)
+		{
+			bAnyReachable = RowCosts[i] >= 0;
+		}
+		if (!bAnyReachable) { continue; }
+
+		FMemory::Memmove(&Costs[NumKept * Targets.Num()], RowCosts, Targets.Num() * sizeof(float));
+		KeptRows[Row] = NumKept++;
+	}
+	for (int32& Row : CellRows)
+	{
+		if (Row != INDEX_NONE) { Row = KeptRows[Row]; }
+	}
+	Costs.SetNum(NumKept * Targets.Num());
+	NumRows = NumKept;
+
+	UE_LOG(LogMonsterAI, Log, TEXT("Baked nav distance table in %.1f ms over %d frames (%d polygons, %d regions, %d runaway locations)"), BakeSeconds * 1000.0, BakeSteps, PolyCenters.Num(), NumRows, Targets.Num());
+	ResetBake();
+
+	//save it for next time
+	TArray<uint8> SaveData;
+	FMemoryWriter Writer(SaveData);
+	int32 Version = NavDistanceTableVersion;
+	uint32 Hash = GetSourceHash();
+	Writer << Version << Hash;
+	Serialize(Writer);
+	FFileHelper::SaveArrayToFile(SaveData, *CachePath);
+}
+
+void FMonsterNavDistanceTable::ResetBake()
+{
+	NextBakeTarget = INDEX_NONE;
+	PolyCenters.Empty();
+	PolyLinkStart.Empty();
+	PolyLinks.Empty();
+	RowPolys.Empty();
+	TargetPolys.Empty();
+}
+
+int32 FMonsterNavDistanceTable::FindRow(const FVector& Location) const
+{
+	if (!IsValid()) { return INDEX_NONE; }
+
+	const FVector Local = Location - Origin;
+	const int32 X = FMath::FloorToInt(Local.X / CellSize);
+	const int32 Y = FMath::FloorToInt(Local.Y / CellSize);
+	const int32 Z = FMath::FloorToInt(Local.Z / CellHeight);
+	if (X < 0 || Y < 0 || Z < 0 || X >= Dimensions.X || Y >= Dimensions.Y || Z >= Dimensions.Z) { return INDEX_NONE; }
+
+	return CellRows[(Z * Dimensions.Y + Y) * Dimensions.X + X];
+}
+
+int32 FMonsterNavDistanceTable::FindClosest(const FVector& Location, const float MinDistance /*= 0.0f*/) const
+{
+	const int32 Row = FindRow(Location);
+	if (Row == INDEX_NONE) { return INDEX_NONE; }
+
+	const float MinDistSquared = FMath::Square(MinDistance);
+	const float* RowCosts = &Costs[Row * Targets.Num()];
+	int32 Best = INDEX_NONE;
+	for (int32 i = 0; i < Targets.Num(); ++i)
+	{
+		if (RowCosts[i] < 0 || FVector::DistSquared(Location, Targets[i]) <= MinDistSquared) { continue; }
+		if (Best == INDEX_NONE || RowCosts[i] < RowCosts[Best])
+		{
+			Best = i;
+		}
+	}
+	return Best;
+}
+
+int32 FMonsterNavDistanceTable::FindFarthest(const FVector& Location) const
+{
+	const int32 Row = FindRow(Location);
+	if (Row == INDEX_NONE) { return INDEX_NONE; }
+
+	const float* RowCosts = &Costs[Row * Targets.Num()];
+	int32 Best = INDEX_NONE;
+	for (int32 i = 0; i < Targets.Num(); ++i)
+	{
+		if (RowCosts[i] >= 0 && (Best == INDEX_NONE || RowCosts[i] > RowCosts[Best]))
+		{
+			Best = i;
+		}
+	}
+	return Best;
+}
+
+float FMonsterNavDistanceTable::GetTravelCost(const FVector& Location, const int32 TargetIndex) const
+{
+	const int32 Row = FindRow(Location);
+	if (Row == INDEX_NONE || !Targets.IsValidIndex(TargetIndex)) { return -1.0f; }
+
+	return Costs[Row * Targets.Num() + TargetIndex];
+}
+
+void FMonsterNavDistanceTable::Serialize(FArchive& Ar)
+{
+	Ar << Origin << Dimensions << CellSize << CellHeight;
+	Ar << CellRows << Costs << NumRows;
+}
+
+uint32 FMonsterNavDistanceTable::GetSourceHash() const
+{
+	uint32 Hash = FCrc::MemCrc32(Targets.GetData(), Targets.Num() * Targets.GetTypeSize());
+	Hash = FCrc::MemCrc32(&Origin, sizeof(Origin), Hash);
+	Hash = FCrc::MemCrc32(&Dimensions, sizeof(Dimensions), Hash);
+	Hash = FCrc::MemCrc32(&CellSize, sizeof(CellSize), Hash);
+	Hash = FCrc::MemCrc32(&CellHeight, sizeof(CellHeight), Hash);
+	return FCrc::MemCrc32(&NavDataHash, sizeof(NavDataHash), Hash);
+}
+
+uint32 FMonsterNavDistanceTable::HashNavData(const ANavigationData& NavData)
+{
+	const ARecastNavMesh* NavMesh = Cast<const ARecastNavMesh>(&NavData);
+	const dtNavMesh* DetourMesh = NavMesh ? NavMesh->GetRecastMesh() : nullptr;
+	if (!DetourMesh) { return 0; }
+
+	//the tiles' data is everything the paths are found on
+	uint32 Hash = 0;
+	for (int32 i = 0; i < DetourMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* Tile = DetourMesh->getTile(i);
+		if (Tile && Tile->header && Tile->data)
+		{
+			Hash = FCrc::MemCrc32(Tile->data, Tile->dataSize, Hash);
+		}
+	}
+	return Hash;
+}
+
+FString FMonsterNavDistanceTable::GetCachePath(UWorld* World)
+{
+	return FPaths::ProjectSavedDir() / TEXT("MonsterAI") / FString::Printf(TEXT("NavDistance_%s.bin"), *UGameplayStatics::GetCurrentLevelName(World, true));
+}
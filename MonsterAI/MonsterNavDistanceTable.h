@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Baked navmesh travel distances from a coarse grid of navmesh regions to each runaway location.
+ * Lets the monster rank runaway locations by how far it actually has to walk with a table lookup,
+ * instead of by straight-line distance or by pathfinding to every candidate.
+ * The table is baked with one flood over the navmesh polygons per target, spread over as many frames as it takes, and cached
+ * on disk under Saved/MonsterAI. It answers nothing until the bake is done. UMonsterRunAwaySystem owns the level's copy.
+ */
+struct SPOOKYGAME_API FMonsterNavDistanceTable
+{
+public:
+	/**
+	 * Loads the table for the current map from disk, or starts baking it if there is no up to date copy.
+	 * Starting a bake only numbers the navmesh polygons, the floods run in BakeStep
+	 * @param World The world to bake the table in
+	 * @param InTargets The runaway locations. Query results are indices into this array
+	 * @param InCellSize Width and depth of a grid region
+	 * @param InCellHeight Height of a grid region
+	 * @return True if the table was loaded and is usable now
+	 */
+	bool Build(UWorld* World, const TArray<FVector>& InTargets, float InCellSize, float InCellHeight);
+
+	/**
+	 * Floods from the targets still left to bake until MaxSeconds have passed, at least one per call.
+	 * Saves the table once the last target is done
+	 * @param MaxSeconds Time budget for the step
+	 * @return True once the bake is done
+	 */
+	bool BakeStep(double MaxSeconds);
+
+	/**
+	 * @return True while a bake is under way
+	 */
+	bool IsBaking() const { return NextBakeTarget != INDEX_NONE; }
+
+	/**
+	 * @return True if the table has been built and has at least one region
+	 */
+	bool IsValid() const { return NumRows > 0 && !IsBaking(); }
+
+	/**
+	 * Finds the target with the shortest walk from a location, ignoring targets within MinDistance (straight-line) of it
+	 * @param Location The location to walk from
+	 * @param MinDistance Targets this close or closer are ignored
+	 * @return Index of the target, INDEX_NONE if the location isn't in a baked region or no target is reachable from it
+	 */
+	int32 FindClosest(const FVector& Location, float MinDistance = 0.0f) const;
+
+	/**
+	 * Finds the target with the longest walk from a location
+	 * @param Location The location to walk from
+	 * @return Index of the target, INDEX_NONE if the location isn't in a baked region or no target is reachable from it
+	 */
+	int32 FindFarthest(const FVector& Location) const;
+
+	/**
+	 * Returns the baked walking distance from a location to a target
+	 * @param Location The location to walk from
+	 * @param TargetIndex Index of the target
+	 * @return The distance, or a negative value if it isn't known or the target isn't reachable
+	 */
+	float GetTravelCost(const FVector& Location, int32 TargetIndex) const;
+
+private:
+	/**
+	 * @return Index of the row of travel costs for the region containing Location, INDEX_NONE if there is none
+	 */
+	int32 FindRow(const FVector& Location) const;
+
+	/**
+	 * Numbers the navmesh polygons, links them up, anchors every grid region to a polygon and finds each target's polygon
+	 * @param NavMesh The navmesh to bake on
+	 */
+	void BeginBake(const class ARecastNavMesh& NavMesh);
+
+	/**
+	 * Fills in one target's column with a Dijkstra flood outward from its polygon
+	 * @param TargetIndex Index of the target
+	 */
+	void FloodTarget(int32 TargetIndex);
+
+	/**
+	 * Frees the bake's working data and saves the table
+	 */
+	void FinishBake();
+
+	/**
+	 * Drops any bake under way
+	 */
+	void ResetBake();
+
+	/**
+	 * Serializes the table (everything except Targets) to or from an archive
+	 */
+	void Serialize(FArchive& Ar);
+
+	/**
+	 * @return Hash of everything the baked data depends on, used to tell if a cached copy is out of date
+	 */
+	uint32 GetSourceHash() const;
+
+	/**
+	 * @param NavData The navigation data the table is baked on
+	 * @return Hash of the navmesh's tiles, so a cached table is rebaked once the navmesh is rebuilt with different geometry
+	 */
+	static uint32 HashNavData(const class ANavigationData& NavData);
+
+	/**
+	 * @return Path of the cached table for a world
+	 */
+	static FString GetCachePath(UWorld* World);
+
+	/** Locations the costs lead to */
+	TArray<FVector> Targets;
+
+	/** Min corner and dimensions of the grid */
+	FVector Origin = FVector::ZeroVector;
+	FIntVector Dimensions = FIntVector::ZeroValue;
+	float CellSize = 0.0f;
+	float CellHeight = 0.0f;
+
+	/** HashNavData of the navmesh the table is built for */
+	uint32 NavDataHash = 0;
+
+	/** Row index for every grid cell, INDEX_NONE if the cell has no navmesh */
+	TArray<int32> CellRows;
+
+	/** Travel costs, one row of Targets.Num() entries per region. Negative entries are unreachable */
+	TArray<float> Costs;
+	int32 NumRows = 0;
+
+	/** Where the table is cached on disk */
+	FString CachePath;
+
+	/** Next target to flood from, INDEX_NONE when not baking */
+	int32 NextBakeTarget = INDEX_NONE;
+
+	/** Seconds spent baking so far and number of steps it took, for the log */
+	double BakeSeconds = 0.0;
+	int32 BakeSteps = 0;
+
+	/** The navmesh polygons while baking: center of each, and the polygons each links to (PolyLinks[PolyLinkStart[i]] on) */
+	TArray<FVector> PolyCenters;
+	TArray<int32> PolyLinkStart;
+	TArray<int32> PolyLinks;
+
+	/** Polygon each row's region is anchored to, and the polygon each target stands on (INDEX_NONE if off the navmesh) */
+	TArray<int32> RowPolys;
+	TArray<int32> TargetPolys;
+};
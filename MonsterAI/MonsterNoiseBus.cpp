@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterNoiseBus.h"
+
+#include "MonsterAIController.h"
+#include "MonsterAIStats.h"
+#include "MonsterHordeSystem.h"
+#include "MonsterPresenceHeatMap.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+UMonsterNoiseBus::UMonsterNoiseBus()
+	: ListenerHash(ListenerCellSize)
+{
+}
+
+bool UMonsterNoiseBus::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have monsters to listen
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMonsterNoiseBus::ReportNoise(const FMonsterNoiseEvent& Event)
+{
+	++NumSubmitted;
+	INC_DWORD_STAT(STAT_MonsterNoiseSubmitted);
+
+	//merge with an overlapping report from the same source, keeping the loudest
+	for (FMonsterNoiseEvent& Pending : PendingEvents)
+	{
+		if (Pending.Source == Event.Source && Pending.bIsAudioLog == Event.bIsAudioLog && FVector::DistSquared(Pending.Origin, Event.Origin) <= FMath::Square(MergeDistance))
+		{
+			if (Event.HearableRadius > Pending.HearableRadius)
+			{
+				Pending.Origin = Event.Origin;
+				Pending.HearableRadius = Event.HearableRadius;
+			}
+			Pending.HowLongToGoToPlayer = FMath::Max(Pending.HowLongToGoToPlayer, Event.HowLongToGoToPlayer);
+			Pending.bIsOngoing |= Event.bIsOngoing;
+			Pending.bOverrideSafeZone |= Event.bOverrideSafeZone;
+			return;
+		}
+	}
+
+	PendingEvents.Add(Event);
+}
+
+void UMonsterNoiseBus::AddListener(AMonsterAIController* Listener)
+{
+	//the level's rooms are in place by the time the first monster starts listening
+	if (!bAcousticGraphBuilt)
+	{
+		AcousticGraph.Build(GetWorld());
+		bAcousticGraphBuilt = true;
+	}
+
+	Listeners.AddUnique(Listener);
+	if (Listener->GetPawn())
+	{
+		ListenerHash.Update(Listener, Listener->GetPawn()->GetActorLocation());
+	}
+}
+
+void UMonsterNoiseBus::RemoveListener(AMonsterAIController* Listener)
+{
+	Listeners.Remove(Listener);
+	ListenerHash.Remove(Listener);
+}
+
+void UMonsterNoiseBus::RefreshListenerLocations()
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (LastListenerRefreshTime >= 0 && Now - LastListenerRefreshTime < ListenerRefreshInterval) { return; }
+	LastListenerRefreshTime = Now;
+
+	for (int32 i = Listeners.Num() - 1; i >= 0; --i)
+	{
+		const TWeakObjectPtr<AMonsterAIController>& Listener = Listeners[i];
+		if (!Listener.IsValid() || !Listener->GetPawn())
+		{
+			ListenerHash.Remove(Listener);
+			Listeners.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+		ListenerHash.Update(Listener, Listener->GetPawn()->GetActorLocation());
+	}
+}
+
+void UMonsterNoiseBus::Tick(float DeltaTime)
+{
+	if (PendingEvents.Num() < 1) { return; }
+
+	SCOPE_CYCLE_COUNTER(STAT_MonsterNoiseDelivery);
+
+	//swap out the batch first, listeners reacting to it may report new sounds for next frame
+	TArray<FMonsterNoiseEvent> Batch = MoveTemp(PendingEvents);
+	PendingEvents.Reset();
+
+	//each sound's room only has to be found once, however many monsters hear it
+	if (AcousticGraph.HasRooms())
+	{
+		for (FMonsterNoiseEvent& Event : Batch)
+		{
+			Event.OriginRoom = AcousticGraph.FindRoom(Event.Origin);
+		}
+	}
+
+	//the monsters' wander is drawn to where sounds were made
+	if (UMonsterPresenceHeatMap* HeatMap = GetWorld()->GetSubsystem<UMonsterPresenceHeatMap>())
+	{
+		for (const FMonsterNoiseEvent& Event : Batch)
+		{
+			if (!Event.bIsAudioLog)
+			{
+				HeatMap->AddNoise(Event.Origin, Event.HearableRadius);
+			}
+		}
+	}
+
+	RefreshListenerLocations();
+
+	//sort the sounds into a batch for each listener near enough to hear them.
+	//the hearing distance is never shorter than the straight line, so listeners outside the radius can't hear the sound
+	TMap<TWeakObjectPtr<AMonsterAIController>, TArray<FMonsterNoiseEvent>> ListenerBatches;
+	TArray<TWeakObjectPtr<AMonsterAIController>, TInlineAllocator<16>> NearbyListeners;
+	for (const FMonsterNoiseEvent& Event : Batch)
+	{
+		NearbyListeners.Reset();
+		ListenerHash.Query(Event.Origin, Event.HearableRadius + ListenerMoveMargin, NearbyListeners);
+		INC_DWORD_STAT_BY(STAT_MonsterNoiseListenersVisited, NearbyListeners.Num());
+
+		for (const TWeakObjectPtr<AMonsterAIController>& Listener : NearbyListeners)
+		{
+			ListenerBatches.FindOrAdd(Listener).Add(Event);
+		}
+	}
+
+	for (const TPair<TWeakObjectPtr<AMonsterAIController>, TArray<FMonsterNoiseEvent>>& ListenerBatch : ListenerBatches)
+	{
+		if (!ListenerBatch.Key.IsValid()) { continue; }
+
+		ListenerBatch.Key->HandleNoiseBatch(ListenerBatch.Value);
+		NumDelivered += ListenerBatch.Value.Num();
+		INC_DWORD_STAT_BY(STAT_MonsterNoiseDelivered, ListenerBatch.Value.Num());
+	}
+
+	//monsters without a controller of their own are run by the horde, which hears the whole batch
+	if (UMonsterHordeSystem* Horde = GetWorld()->GetSubsystem<UMonsterHordeSystem>())
+	{
+		Horde->HandleNoiseBatch(Batch);
+	}
+}
+
+ETickableTickType UMonsterNoiseBus::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UMonsterNoiseBus::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonsterNoiseBus, STATGROUP_Tickables);
+}
+
+#pragma region Benchmark
+#if !UE_BUILD_SHIPPING
+namespace
+{
+	/**
+	 * Times finding the listeners near a sound with the spatial hash against visiting every listener, for 1 to 200 listeners.
+	 * Results are written to the log
+	 */
+	void BenchmarkListenerHash()
+	{
+		constexpr int32 NumSounds = 10000;
+		constexpr float HearableRadius = 1000.0f;
+		const int32 ListenerCounts[] = { 1, 10, 50, 100, 200 };
+
+		//keeps the compiler from throwing the results away
+		volatile int32 Sink = 0;
+
+		for (const int32 NumListeners : ListenerCounts)
+		{
+			//fixed seed so runs are comparable across builds
+			FRandomStream Random(NumListeners);
+			auto RandomLocation = [&Random]() { return FVector(Random.FRandRange(-20000.0f, 20000.0f), Random.FRandRange(-20000.0f, 20000.0f), 0.0f); };
+
+			TMonsterSpatialHash<int32> Hash(UMonsterNoiseBus::ListenerCellSize);
+			TArray<FVector> Listeners;
+			for (int32 i = 0; i < NumListeners; ++i)
+			{
+				Listeners.Add(RandomLocation());
+				Hash.Update(i, Listeners.Last());
+			}
+			TArray<FVector> Sounds;
+			for (int32 i = 0; i < NumSounds; ++i)
+			{
+				Sounds.Add(RandomLocation());
+			}
+
+			TArray<int32, TInlineAllocator<16>> Nearby;
+			double Start = FPlatformTime::Seconds();
+			for (const FVector& Sound : Sounds)
+			{
+				Nearby.Reset();
+				Hash.Query(Sound, HearableRadius + UMonsterNoiseBus::ListenerMoveMargin, Nearby);
+				for (const int32 Listener : Nearby)
+				{
+					Sink += FVector::DistSquared2D(Sound, Listeners[Listener]) < FMath::Square(HearableRadius);
+				}
+			}
+			const double HashTime = FPlatformTime::Seconds() - Start;
+
+			Start = FPlatformTime::Seconds();
+			for (const FVector& Sound : Sounds)
+			{
+				for (const FVector& Listener : Listeners)
+				{
+					Sink += FVector::DistSquared2D(Sound, Listener) < FMath::Square(HearableRadius);
+				}
+			}
+			const double AllTime = FPlatformTime::Seconds() - Start;
+
+			UE_LOG(LogMonsterAI, Display, TEXT("NoiseBus %3d listeners: hash %8.1f ns/sound, every listener %8.1f ns/sound"),
+				NumListeners, HashTime * 1e9 / NumSounds, AllTime * 1e9 / NumSounds);
+		}
+	}
+
+	FAutoConsoleCommand BenchmarkListenerHashCommand(
+		TEXT("MonsterAI.BenchmarkNoiseListeners"),
+		TEXT("Times finding the monsters near a sound with the listener spatial hash against visiting every listener, for 1 to 200 listeners"),
+		FConsoleCommandDelegate::CreateStatic(&BenchmarkListenerHash));
+}
+#endif
+#pragma endregion
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "MonsterAcousticGraph.h"
+#include "MonsterSpatialHash.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterNoiseBus.generated.h"
+
+/**
+ * A sound the monster may be able to hear. Mirrors the parameters of AMonsterAIController::ReportSound
+ */
+struct FMonsterNoiseEvent
+{
+	/** Origin point of the sound */
+	FVector Origin = FVector::ZeroVector;
+	/** Radius around the origin point within which the monster should be able to hear it */
+	float HearableRadius = 0.0f;
+	/** True if the sound is continuously playing */
+	bool bIsOngoing = false;
+	/** True if the sound is an "audio log" */
+	bool bIsAudioLog = false;
+	/** Time in seconds to directly pursue the player after hearing this sound */
+	float HowLongToGoToPlayer = -1.0f;
+	/** If true, the monster will pursue the player even if they are in a safe zone after hearing the sound */
+	bool bOverrideSafeZone = false;
+	/** Actor that made the sound. Reports from the same source are merged */
+	TWeakObjectPtr<AActor> Source;
+	/** Acoustic room containing Origin. Filled in by the noise bus before delivery */
+	int32 OriginRoom = INDEX_NONE;
+};
+
+/**
+ * Collects noise reports during the frame and hands them to the listening monsters as one batch at the end of it.
+ * Overlapping reports from the same source (e.g. MoveForward and MoveRight both stepping in the same frame) are merged first,
+ * so each monster runs its hearing checks once per sound instead of once per report.
+ * Listeners are kept in a spatial hash, and each sound only goes to the monsters near enough to possibly hear it.
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterNoiseBus : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Reports from the same source whose origins are within this distance of each other are merged into one
+	 */
+	static constexpr float MergeDistance = 100.0f;
+
+	/**
+	 * Size of the cells listeners are hashed into
+	 */
+	static constexpr float ListenerCellSize = 1000.0f;
+
+	/**
+	 * Listener locations in the hash are refreshed at most this often, in seconds
+	 */
+	static constexpr float ListenerRefreshInterval = 0.25f;
+
+	/**
+	 * How far a listener can move between refreshes. Sounds are offered to listeners this much further away than they can be heard
+	 */
+	static constexpr float ListenerMoveMargin = 200.0f;
+
+	UMonsterNoiseBus();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/**
+	 * Queue a sound to be delivered to the listeners at the end of the frame
+	 * @param Event The sound
+	 */
+	void ReportNoise(const FMonsterNoiseEvent& Event);
+
+	/**
+	 * Start delivering noise batches to a monster
+	 * @param Listener The monster controller
+	 */
+	void AddListener(class AMonsterAIController* Listener);
+
+	/**
+	 * Stop delivering noise batches to a monster
+	 * @param Listener The monster controller
+	 */
+	void RemoveListener(class AMonsterAIController* Listener);
+
+	/**
+	 * @return The level's room/portal graph for working out how far sounds travel. Built the first time a listener is added
+	 */
+	const FMonsterAcousticGraph& GetAcousticGraph() const { return AcousticGraph; }
+
+	/**
+	 * @return Number of reports submitted since the level started
+	 */
+	int64 GetNumSubmitted() const { return NumSubmitted; }
+
+	/**
+	 * @return Number of sounds handed to listeners since the level started, after merging. Counted once per listener
+	 */
+	int64 GetNumDelivered() const { return NumDelivered; }
+
+#pragma region FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+#pragma endregion
+
+private:
+	/**
+	 * Sounds reported this frame, already merged
+	 */
+	TArray<FMonsterNoiseEvent> PendingEvents;
+
+	/**
+	 * Refreshes where every listener is in the hash, if it hasn't been done recently
+	 */
+	void RefreshListenerLocations();
+
+	/**
+	 * The monsters listening for sounds
+	 */
+	TArray<TWeakObjectPtr<class AMonsterAIController>> Listeners;
+
+	/**
+	 * The listeners by location
+	 */
+	TMonsterSpatialHash<TWeakObjectPtr<class AMonsterAIController>> ListenerHash;
+
+	/**
+	 * World time the listener locations were last refreshed
+	 */
+	float LastListenerRefreshTime = -1.0f;
+
+	/**
+	 * Rooms and portals sound travels through
+	 */
+	FMonsterAcousticGraph AcousticGraph;
+	bool bAcousticGraphBuilt = false;
+
+	int64 NumSubmitted = 0;
+	int64 NumDelivered = 0;
+};
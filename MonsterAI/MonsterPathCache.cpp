@@ -0,0 +1,213 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterPathCache.h"
+
+#include "MonsterAIStats.h"
+#include "NavigationSystem.h"
+#include "NavMesh/PImplRecastNavMesh.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarMonsterPathCache(
+		TEXT("MonsterAI.PathCache"),
+		1,
+		TEXT("1: monsters share found paths between the same navmesh polygons, 0: every path is found from scratch"));
+
+	TAutoConsoleVariable<int32> CVarMonsterPathCacheKB(
+		TEXT("MonsterAI.PathCacheKB"),
+		256,
+		TEXT("Most memory in KB the shared monster path cache may use before dropping the least recently used paths"));
+}
+
+bool UMonsterPathCache::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have monsters to find paths for
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMonsterPathCache::Deinitialize()
+{
+	if (BoundNavSys.IsValid())
+	{
+		BoundNavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UMonsterPathCache::OnNavigationGenerationFinished);
+	}
+	Empty();
+
+	Super::Deinitialize();
+}
+
+ARecastNavMesh* UMonsterPathCache::GetNavMesh()
+{
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!NavSys) { return nullptr; }
+
+	//drop paths through rebuilt tiles from now on
+	if (!BoundNavSys.IsValid())
+	{
+		NavSys->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &UMonsterPathCache::OnNavigationGenerationFinished);
+		BoundNavSys = NavSys;
+	}
+
+	return Cast<ARecastNavMesh>(NavSys->MainNavData);
+}
+
+bool UMonsterPathCache::GetKey(const ARecastNavMesh& NavMesh, const FVector& Start, const FVector& End, TPair<NavNodeRef, NavNodeRef>& OutKey)
+{
+	const FVector Extent = NavMesh.GetDefaultQueryExtent();
+	OutKey.Key = NavMesh.FindNearestPoly(Start, Extent);
+	OutKey.Value = NavMesh.FindNearestPoly(End, Extent);
+	return OutKey.Key != INVALID_NAVNODEREF && OutKey.Value != INVALID_NAVNODEREF;
+}
+
+bool UMonsterPathCache::IsEntryValid(const ARecastNavMesh& NavMesh, const FEntry& Entry)
+{
+	FVector Center;
+	for (const NavNodeRef Poly : Entry.Corridor)
+	{
+		if (!NavMesh.GetPolyCenter(Poly, Center)) { return false; }
+	}
+	return true;
+}
+
+FNavPathSharedPtr UMonsterPathCache::FindPath(const UObject* Querier, const FVector& Start, const FVector& End)
+{
+	if (FNavPathSharedPtr Cached = FindCachedPath(Querier, Start, End)) { return Cached; }
+
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!NavSys || !NavSys->MainNavData) { return nullptr; }
+
+	MonsterAIStats::CountNavQuery();
+	const FPathFindingResult Result = NavSys->FindPathSync(FPathFindingQuery(Querier, *NavSys->MainNavData, Start, End));
+	if (!Result.IsSuccessful() || !Result.Path.IsValid()) { return nullptr; }
+
+	AddPath(Start, End, Result.Path);
+	return Result.Path;
+}
+
+FNavPathSharedPtr UMonsterPathCache::FindCachedPath(const UObject* Querier, const FVector& Start, const FVector& End)
+{
+	if (CVarMonsterPathCache.GetValueOnGameThread() == 0) { return nullptr; }
+
+	ARecastNavMesh* NavMesh = GetNavMesh();
+	const FPImplRecastNavMesh* NavMeshImpl = NavMesh ? NavMesh->GetRecastNavMeshImpl() : nullptr;
+	TPair<NavNodeRef, NavNodeRef> Key;
+	if (!NavMeshImpl || !GetKey(*NavMesh, Start, End, Key)) { return nullptr; }
+
+	++UseCounter;
+	FEntry* Entry = Entries.Find(Key);
+	if (Entry && !IsEntryValid(*NavMesh, *Entry))
+	{
+		RemoveEntry(Key);
+		Entry = nullptr;
+	}
+	if (!Entry)
+	{
+		++NumMisses;
+		INC_DWORD_STAT(STAT_MonsterPathCacheMisses);
+		return nullptr;
+	}
+
+	//the corridor is right for any start and end in the same polygons, but its corners have to be found again for these ones
+	FNavMeshPath* NewPath = new FNavMeshPath();
+	FNavPathSharedPtr Path = MakeShareable(NewPath);
+	if (!NavMeshImpl->FindStraightPath(Start, End, Entry->Corridor, NewPath->GetPathPoints(), &NewPath->CustomLinkIds))
+	{
+		++NumMisses;
+		INC_DWORD_STAT(STAT_MonsterPathCacheMisses);
+		return nullptr;
+	}
+	++NumHits;
+	INC_DWORD_STAT(STAT_MonsterPathCacheHits);
+	Entry->LastUsed = UseCounter;
+
+	NewPath->PathCorridor = Entry->Corridor;
+	NewPath->SetNavigationDataUsed(NavMesh);
+	NewPath->SetQuerier(Querier);
+	NewPath->MarkReady();
+	return Path;
+}
+
+void UMonsterPathCache::AddPath(const FVector& Start, const FVector& End, const FNavPathSharedPtr& Path)
+{
+	if (CVarMonsterPathCache.GetValueOnGameThread() == 0) { return; }
+	if (!Path.IsValid() || !Path->IsValid() || Path->IsPartial() || Path->GetPathPoints().Num() < 2) { return; }
+
+	const FNavMeshPath* NavMeshPath = Path->CastPath<FNavMeshPath>();
+	ARecastNavMesh* NavMesh = GetNavMesh();
+	TPair<NavNodeRef, NavNodeRef> Key;
+	if (!NavMeshPath || NavMeshPath->PathCorridor.Num() < 1 || !NavMesh || !GetKey(*NavMesh, Start, End, Key)) { return; }
+
+	RemoveEntry(Key);
+
+	FEntry& Entry = Entries.Add(Key);
+	Entry.Corridor = NavMeshPath->PathCorridor;
+	Entry.LastUsed = UseCounter;
+	Entry.Size = sizeof(TPair<NavNodeRef, NavNodeRef>) + sizeof(FEntry) + Entry.Corridor.GetAllocatedSize();
+	AllocatedSize += Entry.Size;
+	INC_MEMORY_STAT_BY(STAT_MonsterPathCacheMemory, Entry.Size);
+	SET_DWORD_STAT(STAT_MonsterPathCacheEntries, Entries.Num());
+
+	Trim();
+}
+
+void UMonsterPathCache::RemoveEntry(const TPair<NavNodeRef, NavNodeRef>& Key)
+{
+	const FEntry* Entry = Entries.Find(Key);
+	if (!Entry) { return; }
+
+	AllocatedSize -= Entry->Size;
+	DEC_MEMORY_STAT_BY(STAT_MonsterPathCacheMemory, Entry->Size);
+	Entries.Remove(Key);
+	SET_DWORD_STAT(STAT_MonsterPathCacheEntries, Entries.Num());
+}
+
+void UMonsterPathCache::Trim()
+{
+	const int64 MaxSize = FMath::Max(CVarMonsterPathCacheKB.GetValueOnGameThread(), 0) * 1024LL;
+	if (AllocatedSize <= MaxSize) { return; }
+
+	//go down to three quarters of the cap, so the sort isn't repeated on every path added
+	TArray<TPair<uint64, TPair<NavNodeRef, NavNodeRef>>> ByAge;
+	ByAge.Reserve(Entries.Num());
+	for (const TPair<TPair<NavNodeRef, NavNodeRef>, FEntry>& Entry : Entries)
+	{
+		ByAge.Emplace(Entry.Value.LastUsed, Entry.Key);
+	}
+	ByAge.Sort([](const TPair<uint64, TPair<NavNodeRef, NavNodeRef>>& A, const TPair<uint64, TPair<NavNodeRef, NavNodeRef>>& B) { return A.Key < B.Key; });
+
+	for (int32 i = 0; i < ByAge.Num() && AllocatedSize > MaxSize * 3 / 4; ++i)
+	{
+		RemoveEntry(ByAge[i].Value);
+		INC_DWORD_STAT(STAT_MonsterPathCacheEvictions);
+	}
+}
+
+void UMonsterPathCache::Empty()
+{
+	DEC_MEMORY_STAT_BY(STAT_MonsterPathCacheMemory, AllocatedSize);
+	AllocatedSize = 0;
+	Entries.Empty();
+	SET_DWORD_STAT(STAT_MonsterPathCacheEntries, 0);
+}
+
+void UMonsterPathCache::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(NavData);
+	if (!NavMesh) { return; }
+
+	//lookups check this too, but dropping the stale paths now frees their memory
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (!IsEntryValid(*NavMesh, It.Value()))
+		{
+			AllocatedSize -= It.Value().Size;
+			DEC_MEMORY_STAT_BY(STAT_MonsterPathCacheMemory, It.Value().Size);
+			It.RemoveCurrent();
+		}
+	}
+	SET_DWORD_STAT(STAT_MonsterPathCacheEntries, Entries.Num());
+}
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "NavigationData.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterPathCache.generated.h"
+
+/**
+ * Paths found for any monster, shared by all of them. Monsters keep pathfinding between the same few places
+ * (runaway points, search centers and the routes between them), so a path's polygon corridor is stored under the navmesh
+ * polygons its start and end are on. A later query between the same two polygons reuses the corridor instead of running A*
+ * again, and only the string pulling is redone for its own start and end.
+ * A stored path is dropped once any polygon it passes through has been rebuilt, and the least recently used paths are
+ * dropped to stay under MonsterAI.PathCacheKB. Turned off with MonsterAI.PathCache 0
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterPathCache : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Finds a path, from the cache if a path between the same polygons is stored, otherwise with a synchronous pathfind
+	 * whose result is stored for next time
+	 * @param Querier The object asking, for the navigation filter and debugging
+	 * @param Start Where the path starts
+	 * @param End Where the path ends
+	 * @return The path, which may be partial. Null if no path was found
+	 */
+	FNavPathSharedPtr FindPath(const UObject* Querier, const FVector& Start, const FVector& End);
+
+	/**
+	 * Finds a path in the cache only
+	 * @param Querier The object asking
+	 * @param Start Where the path starts
+	 * @param End Where the path ends
+	 * @return A path through the stored corridor, starting at Start and ending at End. Null if none is stored
+	 */
+	FNavPathSharedPtr FindCachedPath(const UObject* Querier, const FVector& Start, const FVector& End);
+
+	/**
+	 * Stores a path found some other way, such as an async pathfind. Partial paths are not stored
+	 * @param Start Where the path starts
+	 * @param End Where the path ends
+	 * @param Path The path
+	 */
+	void AddPath(const FVector& Start, const FVector& End, const FNavPathSharedPtr& Path);
+
+	/**
+	 * Drops every stored path
+	 */
+	void Empty();
+
+	/**
+	 * @return Fraction of lookups since the level started that found a stored path
+	 */
+	float GetHitRate() const { return NumHits + NumMisses > 0 ? static_cast<float>(NumHits) / (NumHits + NumMisses) : 0.0f; }
+
+	/**
+	 * @return Bytes used by the stored paths
+	 */
+	int64 GetAllocatedSize() const { return AllocatedSize; }
+
+	/**
+	 * @return Number of stored paths
+	 */
+	int32 Num() const { return Entries.Num(); }
+
+private:
+	struct FEntry
+	{
+		/** Navmesh polygons the path passes through. Its corners depend on where the path starts and ends, so they aren't stored */
+		TArray<NavNodeRef> Corridor;
+		/** Lookup count when the path was last used, the lowest are dropped first */
+		uint64 LastUsed = 0;
+		/** Bytes the entry takes up */
+		int64 Size = 0;
+	};
+
+	/**
+	 * @param NavMesh The navmesh
+	 * @param Start Where the path starts
+	 * @param End Where the path ends
+	 * @param OutKey The start and end polygons
+	 * @return True if both ends are on the navmesh
+	 */
+	static bool GetKey(const class ARecastNavMesh& NavMesh, const FVector& Start, const FVector& End, TPair<NavNodeRef, NavNodeRef>& OutKey);
+
+	/**
+	 * @param NavMesh The navmesh
+	 * @param Entry A stored path
+	 * @return True if every polygon the path passes through still exists. Rebuilt tiles give their polygons new references
+	 */
+	static bool IsEntryValid(const class ARecastNavMesh& NavMesh, const FEntry& Entry);
+
+	/**
+	 * Drops the least recently used paths until the cache fits in MonsterAI.PathCacheKB, with some room to spare
+	 */
+	void Trim();
+
+	/**
+	 * Removes a stored path and updates the memory stats
+	 * @param Key The path's key
+	 */
+	void RemoveEntry(const TPair<NavNodeRef, NavNodeRef>& Key);
+
+	/**
+	 * @return The level's navmesh, binding to its rebuilds the first time
+	 */
+	class ARecastNavMesh* GetNavMesh();
+
+	/**
+	 * Drops the paths through polygons that were rebuilt
+	 * @param NavData The navigation data that was built
+	 */
+	UFUNCTION()
+	void OnNavigationGenerationFinished(class ANavigationData* NavData);
+
+	/**
+	 * Stored paths by start and end polygon
+	 */
+	TMap<TPair<NavNodeRef, NavNodeRef>, FEntry> Entries;
+
+	/**
+	 * Counts lookups, as the clock for LastUsed
+	 */
+	uint64 UseCounter = 0;
+
+	int64 NumHits = 0;
+	int64 NumMisses = 0;
+	int64 AllocatedSize = 0;
+
+	TWeakObjectPtr<class UNavigationSystemV1> BoundNavSys;
+};
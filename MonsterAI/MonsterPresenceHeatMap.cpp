@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterPresenceHeatMap.h"
+
+#include "MonsterAIStats.h"
+#include "Engine/World.h"
+
+bool UMonsterPresenceHeatMap::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have monsters listening for the player
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+FIntPoint UMonsterPresenceHeatMap::GetCell(const FVector& Location)
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+float UMonsterPresenceHeatMap::GetDecayedHeat(const FCell& Cell, const float Now)
+{
+	//halves every HalfLife seconds
+	return Cell.Heat * FMath::Exp2(-(Now - Cell.LastUpdateTime) / HalfLife);
+}
+
+void UMonsterPresenceHeatMap::AddHeat(const FVector& Location, const float Heat)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	FCell& Cell = Cells.FindOrAdd(GetCell(Location));
+	Cell.Heat = GetDecayedHeat(Cell, Now) + Heat;
+	Cell.LastUpdateTime = Now;
+	SET_DWORD_STAT(STAT_MonsterHeatMapCells, Cells.Num());
+}
+
+void UMonsterPresenceHeatMap::AddNoise(const FVector& Origin, const float HearableRadius)
+{
+	AddHeat(Origin, NoiseHeat * HearableRadius / 1000.0f);
+}
+
+float UMonsterPresenceHeatMap::GetHeat(const FVector& Location) const
+{
+	const FCell* Cell = Cells.Find(GetCell(Location));
+	return Cell ? GetDecayedHeat(*Cell, GetWorld()->GetTimeSeconds()) : 0.0f;
+}
+
+bool UMonsterPresenceHeatMap::FindHottestNearby(const FVector& Location, const int32 CellRadius, FVector& OutLocation) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterHeatMapQuery);
+
+	if (Cells.Num() < 1) { return false; }
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const FIntPoint Center = GetCell(Location);
+	float HottestHeat = MinHeat;
+	FIntPoint Hottest;
+	bool bFound = false;
+	FIntPoint Candidate;
+	for (Candidate.X = Center.X - CellRadius; Candidate.X <= Center.X + CellRadius; ++Candidate.X)
+	{
+		for (Candidate.Y = Center.Y - CellRadius; Candidate.Y <= Center.Y + CellRadius; ++Candidate.Y)
+		{
+			const FCell* Cell = Cells.Find(Candidate);
+			if (!Cell) { continue; }
+
+			const float Heat = GetDecayedHeat(*Cell, Now);
+			if (Heat > HottestHeat)
+			{
+				HottestHeat = Heat;
+				Hottest = Candidate;
+				bFound = true;
+			}
+		}
+	}
+
+	if (!bFound) { return false; }
+
+	OutLocation = FVector((Hottest.X + 0.5f) * CellSize, (Hottest.Y + 0.5f) * CellSize, Location.Z);
+	return true;
+}
+
+void UMonsterPresenceHeatMap::PruneColdCells()
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (auto It = Cells.CreateIterator(); It; ++It)
+	{
+		if (GetDecayedHeat(It.Value(), Now) < MinHeat)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	SET_DWORD_STAT(STAT_MonsterHeatMapCells, Cells.Num());
+}
+
+void UMonsterPresenceHeatMap::Tick(float DeltaTime)
+{
+	//a cell takes a few half lives to go cold, no need to look for them more often than that
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (Now - LastPruneTime > HalfLife)
+	{
+		LastPruneTime = Now;
+		PruneColdCells();
+	}
+}
+
+ETickableTickType UMonsterPresenceHeatMap::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UMonsterPresenceHeatMap::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonsterPresenceHeatMap, STATGROUP_Tickables);
+}
@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterPresenceHeatMap.generated.h"
+
+/**
+ * Coarse 2D grid over the level recording where the monsters have recently heard or seen the player. Only those cues heat it,
+ * never the player's actual location, so the monster is drawn to what it could have noticed rather than to where the player is.
+ * Heat decays exponentially, worked out when a cell is read or heated instead of every cell being updated each frame
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterPresenceHeatMap : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Width and depth of a cell
+	 */
+	static constexpr float CellSize = 500.0f;
+
+	/**
+	 * Time in seconds for a cell's heat to halve
+	 */
+	static constexpr float HalfLife = 20.0f;
+
+	/**
+	 * Heat added to a noise's cell, for a noise that can be heard 1000 units away
+	 */
+	static constexpr float NoiseHeat = 1.0f;
+
+	/**
+	 * Heat added to the player's cell when a monster sees them
+	 */
+	static constexpr float SightHeat = 1.0f;
+
+	/**
+	 * Cells cooler than this count as cold and are dropped
+	 */
+	static constexpr float MinHeat = 0.05f;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/**
+	 * Adds heat to the cell containing a location. Used for noises and for the monster seeing the player
+	 * @param Location The location
+	 * @param Heat Heat to add
+	 */
+	void AddHeat(const FVector& Location, float Heat);
+
+	/**
+	 * Records a noise, heated by how far it can be heard
+	 * @param Origin Where the noise came from
+	 * @param HearableRadius Radius the noise can be heard in
+	 */
+	void AddNoise(const FVector& Origin, float HearableRadius);
+
+	/**
+	 * Finds the hottest cell within a fixed number of cells of a location. Reads the same number of cells whatever the size of the level
+	 * @param Location Center of the search
+	 * @param CellRadius How many cells out from Location's cell to look
+	 * @param OutLocation Center of the hottest cell, at Location's height. Left unchanged if there is none
+	 * @return True if a cell warmer than MinHeat was found
+	 */
+	bool FindHottestNearby(const FVector& Location, int32 CellRadius, FVector& OutLocation) const;
+
+	/**
+	 * @param Location The location
+	 * @return Current heat of the cell containing Location
+	 */
+	float GetHeat(const FVector& Location) const;
+
+	/**
+	 * @return Number of cells that are or were recently warm
+	 */
+	int32 Num() const { return Cells.Num(); }
+
+#pragma region FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+#pragma endregion
+
+private:
+	struct FCell
+	{
+		/** Heat as of LastUpdateTime */
+		float Heat = 0.0f;
+		/** World time Heat was last brought up to date */
+		float LastUpdateTime = 0.0f;
+	};
+
+	/**
+	 * @param Location The location
+	 * @return The cell containing Location
+	 */
+	static FIntPoint GetCell(const FVector& Location);
+
+	/**
+	 * @param Cell The cell
+	 * @param Now The current world time
+	 * @return The cell's heat decayed to Now
+	 */
+	static float GetDecayedHeat(const FCell& Cell, float Now);
+
+	/**
+	 * Drops cells that have gone cold
+	 */
+	void PruneColdCells();
+
+	/**
+	 * The warm cells. Cells that were never heated aren't stored
+	 */
+	TMap<FIntPoint, FCell> Cells;
+
+	/**
+	 * World time cold cells were last dropped
+	 */
+	float LastPruneTime = 0.0f;
+};
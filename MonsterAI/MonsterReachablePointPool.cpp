@@ -0,0 +1,377 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterReachablePointPool.h"
+
+#include "MonsterAIStats.h"
+#include "NavigationSystem.h"
+#include "Detour/DetourNavMesh.h"
+#include "Engine/World.h"
+#include "NavMesh/RecastHelpers.h"
+#include "NavMesh/RecastNavMesh.h"
+
+namespace
+{
+	/** Seed for the sample positions */
+	constexpr int32 PointPoolSeed = 0x4D4F4E53;
+
+	/** How far from the navmesh a sample can be and still be pulled onto it */
+	const FVector SampleProjectionExtent(UMonsterReachablePointPool::PointSpacing * 0.5f, UMonsterReachablePointPool::PointSpacing * 0.5f, 200.0f);
+
+	/** How far a pooled point can move when a tile is rebuilt and still count as the same point */
+	const FVector RevalidateProjectionExtent(50.0f, 50.0f, 100.0f);
+
+	/** How far from the navmesh a location can be and still count as standing on the polygon under it */
+	const FVector IslandProjectionExtent(50.0f, 50.0f, 250.0f);
+}
+
+bool UMonsterReachablePointPool::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have monsters to wander
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMonsterReachablePointPool::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(&InWorld);
+	if (!NavSys) { return; }
+
+	//keep the pool in step with the navmesh from now on. A navmesh still building when play begins fills the pool in when it finishes
+	NavSys->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &UMonsterReachablePointPool::OnNavigationGenerationFinished);
+	BoundNavSys = NavSys;
+
+	SampleStream.Initialize(PointPoolSeed);
+	Update();
+}
+
+void UMonsterReachablePointPool::Deinitialize()
+{
+	if (BoundNavSys.IsValid())
+	{
+		BoundNavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UMonsterReachablePointPool::OnNavigationGenerationFinished);
+	}
+	DEC_DWORD_STAT_BY(STAT_MonsterPointPoolSize, Points.Num());
+
+	Super::Deinitialize();
+}
+
+bool UMonsterReachablePointPool::GetRandomPoint(const FVector& From, const FVector& Center, const float Radius, FRandomStream& Random, FVector& OutPoint)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterPointPoolQuery);
+
+	const int32 Island = FindIsland(From);
+	if (Island == INDEX_NONE) { return false; }
+
+	TArray<int32, TInlineAllocator<64>> Nearby;
+	Grid.Query(Center, Radius, Nearby);
+
+	//keep points in the circle, on the monster's island, and not where it is already standing
+	Nearby.RemoveAllSwap([this, &Center, &From, Radius, Island](const int32 Point)
+	{
+		return PointIslands[Point] != Island
+			|| FVector::DistSquared2D(Points[Point], Center) > FMath::Square(Radius)
+			|| FVector::DistSquared(Points[Point], From) < FMath::Square(150.0f);
+	}, false);
+	if (Nearby.Num() < 1) { return false; }
+
+	//the grid's order doesn't depend on the seed, sort so the same seed always picks the same point
+	Nearby.Sort();
+	OutPoint = Points[Nearby[Random.RandRange(0, Nearby.Num() - 1)]];
+	return true;
+}
+
+int32 UMonsterReachablePointPool::FindIsland(const FVector& Location) const
+{
+	const ARecastNavMesh* NavMesh = GetNavMesh();
+	const dtNavMesh* DetourMesh = NavMesh ? NavMesh->GetRecastMesh() : nullptr;
+	if (!DetourMesh || DetourMesh != LabelledMesh) { return INDEX_NONE; }
+
+	//the island is stored on the polygon the location stands on, no path test needed
+	MonsterAIStats::CountNavQuery();
+	const int32* Island = FindPolyIsland(*DetourMesh, NavMesh->FindNearestPoly(Location, IslandProjectionExtent));
+	return Island ? *Island : INDEX_NONE;
+}
+
+void UMonsterReachablePointPool::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	Update();
+}
+
+void UMonsterReachablePointPool::Update()
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterPointPoolUpdate);
+	const double UpdateStart = FPlatformTime::Seconds();
+
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	const ARecastNavMesh* NavMesh = GetNavMesh();
+	const dtNavMesh* DetourMesh = NavMesh ? NavMesh->GetRecastMesh() : nullptr;
+	if (!NavSys || !DetourMesh) { return; }
+
+	//a navmesh built from scratch shares nothing with the old one, not even the meaning of the polygon refs
+	const bool bNewMesh = DetourMesh != LabelledMesh;
+	if (bNewMesh)
+	{
+		TileIslands.Reset();
+		TileRefs.Reset();
+		NextIsland = 0;
+		LabelledMesh = DetourMesh;
+	}
+
+	//Detour gives a tile a new ref whenever it is rebuilt, so comparing refs finds the rebuilt tiles
+	TArray<int32> RebuiltTiles;
+	TBitArray<> Rebuilt(false, DetourMesh->getMaxTiles());
+	TileRefs.SetNumZeroed(DetourMesh->getMaxTiles());
+	for (int32 TileIndex = 0; TileIndex < DetourMesh->getMaxTiles(); ++TileIndex)
+	{
+		const dtMeshTile* Tile = DetourMesh->getTile(TileIndex);
+		const uint64 Ref = Tile && Tile->header ? DetourMesh->getTileRef(Tile) : 0;
+		if (Ref != TileRefs[TileIndex])
+		{
+			TileRefs[TileIndex] = Ref;
+			Rebuilt[TileIndex] = true;
+			RebuiltTiles.Add(TileIndex);
+		}
+	}
+	if (!bNewMesh && RebuiltTiles.Num() < 1) { return; }
+
+	//points on untouched tiles stay as they are, the ones on rebuilt tiles are snapped to where the navmesh is now
+	const int32 OldNum = Points.Num();
+	int32 Kept = 0;
+	for (int32 i = 0; i < OldNum; ++i)
+	{
+		FVector Point = Points[i];
+		NavNodeRef Poly = PointPolys[i];
+		const int32 TileIndex = bNewMesh ? INDEX_NONE : (int32)DetourMesh->decodePolyIdTile(Poly);
+		if (!Rebuilt.IsValidIndex(TileIndex) || Rebuilt[TileIndex])
+		{
+			FNavLocation Projected;
+			if (!NavSys->ProjectPointToNavigation(Point, Projected, RevalidateProjectionExtent, NavSys->MainNavData)) { continue; }
+			Point = Projected.Location;
+			Poly = Projected.NodeRef;
+		}
+		Points[Kept] = Point;
+		PointPolys[Kept] = Poly;
+		++Kept;
+	}
+	Points.SetNum(Kept, false);
+	PointPolys.SetNum(Kept, false);
+
+	RebuildGrid();
+	AddPoints(*DetourMesh, RebuiltTiles);
+	const int32 Labelled = LabelIslands(*DetourMesh, RebuiltTiles);
+
+	PointIslands.SetNumUninitialized(Points.Num());
+	for (int32 i = 0; i < Points.Num(); ++i)
+	{
+		const int32* Island = FindPolyIsland(*DetourMesh, PointPolys[i]);
+		PointIslands[i] = Island ? *Island : INDEX_NONE;
+	}
+
+	DEC_DWORD_STAT_BY(STAT_MonsterPointPoolSize, OldNum);
+	INC_DWORD_STAT_BY(STAT_MonsterPointPoolSize, Points.Num());
+	UE_LOG(LogMonsterAI, Log, TEXT("Updated reachable point pool in %.1f ms: %d points (%d removed, %d added), %d tiles rebuilt, %d polygons labelled"),
+		(FPlatformTime::Seconds() - UpdateStart) * 1000.0, Points.Num(), OldNum - Kept, Points.Num() - Kept, RebuiltTiles.Num(), Labelled);
+}
+
+void UMonsterReachablePointPool::AddPoints(const dtNavMesh& DetourMesh, const TArray<int32>& Tiles)
+{
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+
+	//dart throwing over each tile: samples too close to an existing point are thrown away, until the tile stops taking new ones
+	//samples that miss the navmesh entirely don't count as rejected, but the total is capped for tiles with very little navmesh in their bounds
+	TArray<int32, TInlineAllocator<16>> Nearby;
+	for (const int32 TileIndex : Tiles)
+	{
+		const dtMeshTile* Tile = DetourMesh.getTile(TileIndex);
+		if (!Tile || !Tile->header || Tile->header->polyCount < 1) { continue; }
+		const FBox TileBounds = Recast2UnrealBox(Tile->header->bmin, Tile->header->bmax);
+
+		int32 Rejected = 0;
+		for (int32 Sample = 0; Sample < MaxRejectedSamples * 8 && Points.Num() < MaxPoints && Rejected < MaxRejectedSamples; ++Sample)
+		{
+			const FVector Location(
+				SampleStream.FRandRange(TileBounds.Min.X, TileBounds.Max.X),
+				SampleStream.FRandRange(TileBounds.Min.Y, TileBounds.Max.Y),
+				SampleStream.FRandRange(TileBounds.Min.Z, TileBounds.Max.Z));
+
+			FNavLocation Projected;
+			if (!NavSys->ProjectPointToNavigation(Location, Projected, SampleProjectionExtent, NavSys->MainNavData)) { continue; }
+
+			Nearby.Reset();
+			Grid.Query(Projected.Location, PointSpacing, Nearby);
+			const bool bTooClose = Nearby.ContainsByPredicate([this, &Projected](const int32 Point)
+			{
+				return FVector::DistSquared(Points[Point], Projected.Location) < FMath::Square(PointSpacing);
+			});
+			if (bTooClose)
+			{
+				++Rejected;
+				continue;
+			}
+
+			Rejected = 0;
+			PointPolys.Add(Projected.NodeRef);
+			Grid.Update(Points.Add(Projected.Location), Projected.Location);
+		}
+	}
+}
+
+int32 UMonsterReachablePointPool::LabelIslands(const dtNavMesh& DetourMesh, const TArray<int32>& Tiles)
+{
+	//islands that reached into the rebuilt tiles may have been split or joined, every other island is as it was
+	TSet<int32> Stale;
+	for (const int32 TileIndex : Tiles)
+	{
+		if (TileIslands.IsValidIndex(TileIndex)) { Stale.Append(TileIslands[TileIndex]); }
+	}
+	Stale.Remove(INDEX_NONE);
+
+	//the rebuilt tiles start unlabelled, and the stale islands are labelled again from each of their polygons left on untouched tiles
+	TileIslands.SetNum(DetourMesh.getMaxTiles());
+	TArray<NavNodeRef> Seeds;
+	for (const int32 TileIndex : Tiles)
+	{
+		const dtMeshTile* Tile = DetourMesh.getTile(TileIndex);
+		const int32 PolyCount = Tile && Tile->header ? Tile->header->polyCount : 0;
+		TileIslands[TileIndex].Init(INDEX_NONE, PolyCount);
+		for (int32 Poly = 0; Poly < PolyCount; ++Poly)
+		{
+			Seeds.Add(DetourMesh.getPolyRefBase(Tile) | (NavNodeRef)Poly);
+		}
+	}
+	for (int32 TileIndex = 0; TileIndex < TileIslands.Num() && Stale.Num() > 0; ++TileIndex)
+	{
+		const TArray<int32>& Islands = TileIslands[TileIndex];
+		for (int32 Poly = 0; Poly < Islands.Num(); ++Poly)
+		{
+			if (Stale.Contains(Islands[Poly]))
+			{
+				Seeds.Add(DetourMesh.getPolyRefBase(DetourMesh.getTile(TileIndex)) | (NavNodeRef)Poly);
+			}
+		}
+	}
+
+	//flood fill along the polygons' links, off-mesh links included and taken as two way.
+	//a flood that runs into an untouched island joins it, and two untouched islands joined through a rebuilt tile become one
+	int32 Labelled = 0;
+	TArray<NavNodeRef> Open;
+	TArray<NavNodeRef> Flooded;
+	for (const NavNodeRef Seed : Seeds)
+	{
+		int32* SeedIsland = FindPolyIsland(DetourMesh, Seed);
+		if (!SeedIsland || (*SeedIsland != INDEX_NONE && !Stale.Contains(*SeedIsland))) { continue; }
+
+		const int32 Island = NextIsland++;
+		int32 Joined = INDEX_NONE;
+		*SeedIsland = Island;
+		Open.Add(Seed);
+		Flooded.Reset();
+		Flooded.Add(Seed);
+
+		while (Open.Num() > 0)
+		{
+			const dtMeshTile* Tile = nullptr;
+			const dtPoly* Poly = nullptr;
+			DetourMesh.getTileAndPolyByRefUnsafe(Open.Pop(false), &Tile, &Poly);
+
+			for (unsigned int Link = Poly->firstLink; Link != DT_NULL_LINK; Link = DetourMesh.getLink(Tile, Link).next)
+			{
+				const NavNodeRef Neighbour = DetourMesh.getLink(Tile, Link).ref;
+				int32* NeighbourIsland = FindPolyIsland(DetourMesh, Neighbour);
+				if (!NeighbourIsland || *NeighbourIsland == Island) { continue; }
+
+				if (*NeighbourIsland == INDEX_NONE || Stale.Contains(*NeighbourIsland))
+				{
+					*NeighbourIsland = Island;
+					Open.Add(Neighbour);
+					Flooded.Add(Neighbour);
+				}
+				else if (Joined == INDEX_NONE)
+				{
+					Joined = *NeighbourIsland;
+				}
+				else if (*NeighbourIsland != Joined)
+				{
+					RelabelIsland(DetourMesh, Neighbour, Joined);
+				}
+			}
+		}
+
+		//the flooded polygons take the untouched island's index, so none of its own polygons have to change
+		if (Joined != INDEX_NONE)
+		{
+			for (const NavNodeRef Poly : Flooded)
+			{
+				*FindPolyIsland(DetourMesh, Poly) = Joined;
+			}
+		}
+		Labelled += Flooded.Num();
+	}
+	return Labelled;
+}
+
+void UMonsterReachablePointPool::RelabelIsland(const dtNavMesh& DetourMesh, const NavNodeRef Seed, const int32 To)
+{
+	int32* SeedIsland = FindPolyIsland(DetourMesh, Seed);
+	if (!SeedIsland || *SeedIsland == To) { return; }
+
+	const int32 From = *SeedIsland;
+	*SeedIsland = To;
+	TArray<NavNodeRef> Open;
+	Open.Add(Seed);
+
+	while (Open.Num() > 0)
+	{
+		const dtMeshTile* Tile = nullptr;
+		const dtPoly* Poly = nullptr;
+		DetourMesh.getTileAndPolyByRefUnsafe(Open.Pop(false), &Tile, &Poly);
+
+		for (unsigned int Link = Poly->firstLink; Link != DT_NULL_LINK; Link = DetourMesh.getLink(Tile, Link).next)
+		{
+			const NavNodeRef Neighbour = DetourMesh.getLink(Tile, Link).ref;
+			int32* NeighbourIsland = FindPolyIsland(DetourMesh, Neighbour);
+			if (NeighbourIsland && *NeighbourIsland == From)
+			{
+				*NeighbourIsland = To;
+				Open.Add(Neighbour);
+			}
+		}
+	}
+}
+
+int32* UMonsterReachablePointPool::FindPolyIsland(const dtNavMesh& DetourMesh, const NavNodeRef Poly)
+{
+	return const_cast<int32*>(AsConst(*this).FindPolyIsland(DetourMesh, Poly));
+}
+
+const int32* UMonsterReachablePointPool::FindPolyIsland(const dtNavMesh& DetourMesh, const NavNodeRef Poly) const
+{
+	if (!Poly) { return nullptr; }
+
+	unsigned int Salt = 0;
+	unsigned int TileIndex = 0;
+	unsigned int PolyIndex = 0;
+	DetourMesh.decodePolyId(Poly, Salt, TileIndex, PolyIndex);
+
+	//a polygon from a tile rebuilt since it was labelled isn't known yet
+	if (!TileRefs.IsValidIndex(TileIndex) || TileRefs[TileIndex] != DetourMesh.encodePolyId(Salt, TileIndex, 0)) { return nullptr; }
+	if (!TileIslands.IsValidIndex(TileIndex) || !TileIslands[TileIndex].IsValidIndex(PolyIndex)) { return nullptr; }
+	return &TileIslands[TileIndex][PolyIndex];
+}
+
+const ARecastNavMesh* UMonsterReachablePointPool::GetNavMesh() const
+{
+	const UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	return NavSys ? Cast<const ARecastNavMesh>(NavSys->MainNavData) : nullptr;
+}
+
+void UMonsterReachablePointPool::RebuildGrid()
+{
+	Grid.Reset();
+	for (int32 i = 0; i < Points.Num(); ++i)
+	{
+		Grid.Update(i, Points[i]);
+	}
+}
@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "MonsterSpatialHash.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterReachablePointPool.generated.h"
+
+class dtNavMesh;
+
+/**
+ * Evenly spread points on the level's navmesh, grouped by the connected nav island they are on.
+ * Wander and search draw their next target from here instead of sampling a random point and pathfinding to it to prove it can be reached:
+ * any point on the monster's own island can be walked to. Islands are labelled per navmesh polygon by walking the polygons' links,
+ * so finding a location's island is one nearest polygon lookup and never a path test.
+ * Built when play begins, and brought up to date whenever the navmesh finishes rebuilding: only the points on rebuilt tiles are
+ * projected again, and only the islands that touch those tiles are labelled again
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterReachablePointPool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * No two points in the pool are closer than this
+	 */
+	static constexpr float PointSpacing = 300.0f;
+
+	/**
+	 * Upper bound on the number of points, for very large levels
+	 */
+	static constexpr int32 MaxPoints = 8192;
+
+	/**
+	 * Sampling a tile stops once this many random points on it in a row were too close to an existing one
+	 */
+	static constexpr int32 MaxRejectedSamples = 32;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/**
+	 * Builds the pool and keeps it in step with the navmesh from then on
+	 * @param InWorld The world
+	 */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	virtual void Deinitialize() override;
+
+	/**
+	 * Picks a random pooled point within Radius of Center on the same nav island as From
+	 * @param From Where the monster is standing
+	 * @param Center Center of the area to pick from
+	 * @param Radius Radius of the area to pick from
+	 * @param Random Source of randomness, so deterministic runs pick the same points
+	 * @param OutPoint The point picked, left unchanged if there is none
+	 * @return True if a point was picked
+	 */
+	bool GetRandomPoint(const FVector& From, const FVector& Center, float Radius, FRandomStream& Random, FVector& OutPoint);
+
+	/**
+	 * Returns the nav island a location can walk to
+	 * @param Location The location
+	 * @return Index of the island, or INDEX_NONE if it isn't on the navmesh
+	 */
+	int32 FindIsland(const FVector& Location) const;
+
+	/**
+	 * @return Number of points in the pool
+	 */
+	int32 Num() const { return Points.Num(); }
+
+private:
+	/**
+	 * Finds the tiles rebuilt since the last update, moves or drops the points on them, fills the gaps with new ones
+	 * and labels the islands again where they touch those tiles
+	 */
+	void Update();
+
+	/**
+	 * Adds random points on the given tiles that are at least PointSpacing from every existing point, until the tiles are covered
+	 * @param DetourMesh The navmesh
+	 * @param Tiles Indices of the tiles to cover
+	 */
+	void AddPoints(const dtNavMesh& DetourMesh, const TArray<int32>& Tiles);
+
+	/**
+	 * Labels the polygons of the given tiles, and of every island that touched them before they were rebuilt, with their island
+	 * @param DetourMesh The navmesh
+	 * @param Tiles Indices of the rebuilt tiles
+	 * @return Number of polygons labelled
+	 */
+	int32 LabelIslands(const dtNavMesh& DetourMesh, const TArray<int32>& Tiles);
+
+	/**
+	 * Gives every polygon of an island connected to Seed another island
+	 * @param DetourMesh The navmesh
+	 * @param Seed A polygon on the island
+	 * @param To The island to move the polygons to
+	 */
+	void RelabelIsland(const dtNavMesh& DetourMesh, NavNodeRef Seed, int32 To);
+
+	/**
+	 * Returns where the island of a polygon is stored
+	 * @param DetourMesh The navmesh
+	 * @param Poly The polygon
+	 * @return The polygon's entry in TileIslands, or nullptr if it isn't a polygon the pool knows
+	 */
+	int32* FindPolyIsland(const dtNavMesh& DetourMesh, NavNodeRef Poly);
+	const int32* FindPolyIsland(const dtNavMesh& DetourMesh, NavNodeRef Poly) const;
+
+	/**
+	 * @return The level's recast navmesh, or nullptr if it doesn't have one
+	 */
+	const class ARecastNavMesh* GetNavMesh() const;
+
+	/**
+	 * Rebuilds the grid from Points
+	 */
+	void RebuildGrid();
+
+	/**
+	 * Called when the navmesh finishes building
+	 * @param NavData The navigation data that was built
+	 */
+	UFUNCTION()
+	void OnNavigationGenerationFinished(class ANavigationData* NavData);
+
+	/**
+	 * The pooled points
+	 */
+	TArray<FVector> Points;
+
+	/**
+	 * Navmesh polygon each point in Points is on
+	 */
+	TArray<NavNodeRef> PointPolys;
+
+	/**
+	 * Nav island of each point in Points
+	 */
+	TArray<int32> PointIslands;
+
+	/**
+	 * Nav island of every navmesh polygon, by tile index and then polygon index within the tile
+	 */
+	TArray<TArray<int32>> TileIslands;
+
+	/**
+	 * Ref of each tile when it was last labelled. Detour gives a rebuilt tile a new ref, so a changed one marks the tile as rebuilt
+	 */
+	TArray<uint64> TileRefs;
+
+	/**
+	 * The navmesh TileIslands and TileRefs were built for. If the whole navmesh is replaced every tile counts as rebuilt
+	 */
+	const dtNavMesh* LabelledMesh = nullptr;
+
+	/**
+	 * Island index to give the next island found. Indices aren't reused, so an untouched island keeps its index across updates
+	 */
+	int32 NextIsland = 0;
+
+	/**
+	 * Indices into Points by location
+	 */
+	TMonsterSpatialHash<int32> Grid;
+
+	/**
+	 * Source of the sample positions. Always starts from the same seed so every run builds the same pool
+	 */
+	FRandomStream SampleStream;
+
+	/**
+	 * The navigation system whose build finished event the pool is bound to
+	 */
+	TWeakObjectPtr<class UNavigationSystemV1> BoundNavSys;
+};
@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterRunAwayIndex.h"
+
+#include "MonsterAIStats.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	/** Leaves hold at most this many locations */
+	constexpr int32 MaxLeafSize = 8;
+}
+
+void FMonsterRunAwayIndex::Build(const TArray<FVector>& InPoints)
+{
+	Points = InPoints;
+	Nodes.Reset();
+	Order.Reset(Points.Num());
+	for (int32 i = 0; i < Points.Num(); ++i)
+	{
+		Order.Add(i);
+	}
+
+	if (Points.Num() > 0)
+	{
+		BuildNode(0, Points.Num());
+	}
+}
+
+int32 FMonsterRunAwayIndex::BuildNode(const int32 Begin, const int32 End)
+{
+	const int32 NodeIndex = Nodes.AddDefaulted();
+	FBox Bounds(ForceInit);
+	for (int32 i = Begin; i < End; ++i)
+	{
+		Bounds += Points[Order[i]];
+	}
+	Nodes[NodeIndex].Bounds = Bounds;
+	Nodes[NodeIndex].Begin = Begin;
+	Nodes[NodeIndex].End = End;
+
+	if (End - Begin <= MaxLeafSize) { return NodeIndex; }
+
+	//split at the median of the longest axis
+	const FVector Extent = Bounds.GetExtent();
+	const int32 Axis = Extent.X >= Extent.Y && Extent.X >= Extent.Z ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+	Sort(Order.GetData() + Begin, End - Begin, [this, Axis](const int32 A, const int32 B) { return Points[A][Axis] < Points[B][Axis]; });
+	const int32 Mid = Begin + (End - Begin) / 2;
+
+	//children are added after this node, so grab the indices before writing through Nodes again
+	const int32 Left = BuildNode(Begin, Mid);
+	const int32 Right = BuildNode(Mid, End);
+	Nodes[NodeIndex].Left = Left;
+	Nodes[NodeIndex].Right = Right;
+	return NodeIndex;
+}
+
+float FMonsterRunAwayIndex::MaxDistSquared(const FBox& Box, const FVector& Location)
+{
+	const FVector ToMin = (Location - Box.Min).GetAbs();
+	const FVector ToMax = (Location - Box.Max).GetAbs();
+	return FVector::Max(ToMin, ToMax).SizeSquared();
+}
+
+int32 FMonsterRunAwayIndex::FindClosest(const FVector& Location, const float MinDistance /*= 0.0f*/) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterRunAwayQuery);
+
+	if (Nodes.Num() < 1) { return INDEX_NONE; }
+
+	const float MinDistSquared = FMath::Square(MinDistance);
+	int32 Best = INDEX_NONE;
+	float BestDistSquared = MAX_flt;
+
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Add(0);
+	while (Stack.Num() > 0)
+	{
+		const FNode& Node = Nodes[Stack.Pop(false)];
+
+		//skip nodes that can't hold anything closer than the best so far, or that are entirely too close
+		if (Node.Bounds.ComputeSquaredDistanceToPoint(Location) > BestDistSquared || MaxDistSquared(Node.Bounds, Location) <= MinDistSquared)
+		{
+			continue;
+		}
+
+		if (Node.Left == INDEX_NONE)
+		{
+			for (int32 i = Node.Begin; i < Node.End; ++i)
+			{
+				//ties go to the earlier location, same as the linear scan this replaces
+				const int32 PointIndex = Order[i];
+				const float DistSquared = FVector::DistSquared(Location, Points[PointIndex]);
+				if (DistSquared > MinDistSquared && (DistSquared < BestDistSquared || (DistSquared == BestDistSquared && PointIndex < Best)))
+				{
+					Best = PointIndex;
+					BestDistSquared = DistSquared;
+				}
+			}
+			continue;
+		}
+
+		//visit the nearer child first so the other one is more likely to be skipped
+		const bool bLeftIsNearer = Nodes[Node.Left].Bounds.ComputeSquaredDistanceToPoint(Location) <= Nodes[Node.Right].Bounds.ComputeSquaredDistanceToPoint(Location);
+		Stack.Add(bLeftIsNearer ? Node.Right : Node.Left);
+		Stack.Add(bLeftIsNearer ? Node.Left : Node.Right);
+	}
+
+	return Best;
+}
+
+int32 FMonsterRunAwayIndex::FindFarthest(const FVector& Location) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterRunAwayQuery);
+
+	if (Nodes.Num() < 1) { return INDEX_NONE; }
+
+	int32 Best = INDEX_NONE;
+	float BestDistSquared = -1.0f;
+
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Add(0);
+	while (Stack.Num() > 0)
+	{
+		const FNode& Node = Nodes[Stack.Pop(false)];
+
+		//skip nodes that can't hold anything farther than the best so far
+		if (MaxDistSquared(Node.Bounds, Location) < BestDistSquared)
+		{
+			continue;
+		}
+
+		if (Node.Left == INDEX_NONE)
+		{
+			for (int32 i = Node.Begin; i < Node.End; ++i)
+			{
+				//ties go to the earlier location, same as the linear scan this replaces
+				const int32 PointIndex = Order[i];
+				const float DistSquared = FVector::DistSquared(Location, Points[PointIndex]);
+				if (DistSquared > BestDistSquared || (DistSquared == BestDistSquared && PointIndex < Best))
+				{
+					Best = PointIndex;
+					BestDistSquared = DistSquared;
+				}
+			}
+			continue;
+		}
+
+		//visit the farther child first so the other one is more likely to be skipped
+		const bool bLeftIsFarther = MaxDistSquared(Nodes[Node.Left].Bounds, Location) >= MaxDistSquared(Nodes[Node.Right].Bounds, Location);
+		Stack.Add(bLeftIsFarther ? Node.Right : Node.Left);
+		Stack.Add(bLeftIsFarther ? Node.Left : Node.Right);
+	}
+
+	return Best;
+}
+
+#pragma region Benchmark
+#if !UE_BUILD_SHIPPING
+namespace
+{
+	/**
+	 * Times closest/farthest queries on the index against the linear scan it replaced, for 10 to 10,000 locations.
+	 * Results are written to the log
+	 */
+	void BenchmarkRunAwayIndex()
+	{
+		constexpr int32 NumQueries = 1000;
+		const int32 PointCounts[] = { 10, 100, 1000, 10000 };
+
+		//keeps the compiler from throwing the query results away
+		volatile int32 Sink = 0;
+
+		for (const int32 NumPoints : PointCounts)
+		{
+			//fixed seed so runs are comparable across builds
+			FRandomStream Random(NumPoints);
+			const FBox LevelBounds(FVector(-50000.0f, -50000.0f, -2000.0f), FVector(50000.0f, 50000.0f, 2000.0f));
+			auto RandomLocation = [&Random, &LevelBounds]()
+			{
+				return FVector(Random.FRandRange(LevelBounds.Min.X, LevelBounds.Max.X), Random.FRandRange(LevelBounds.Min.Y, LevelBounds.Max.Y), Random.FRandRange(LevelBounds.Min.Z, LevelBounds.Max.Z));
+			};
+
+			TArray<FVector> Locations;
+			for (int32 i = 0; i < NumPoints; ++i)
+			{
+				Locations.Add(RandomLocation());
+			}
+			TArray<FVector> Queries;
+			for (int32 i = 0; i < NumQueries; ++i)
+			{
+				Queries.Add(RandomLocation());
+			}
+
+			const double BuildStart = FPlatformTime::Seconds();
+			FMonsterRunAwayIndex Index;
+			Index.Build(Locations);
+			const double BuildTime = FPlatformTime::Seconds() - BuildStart;
+
+			double Start = FPlatformTime::Seconds();
+			for (const FVector& Query : Queries)
+			{
+				Sink += Index.FindClosest(Query, 50.0f) + Index.FindFarthest(Query);
+			}
+			const double IndexTime = FPlatformTime::Seconds() - Start;
+
+			Start = FPlatformTime::Seconds();
+			for (const FVector& Query : Queries)
+			{
+				int32 Closest = INDEX_NONE;
+				int32 Farthest = INDEX_NONE;
+				float ClosestDistance = INT_MAX;
+				float FarthestDistance = 0;
+				for (int32 i = 0; i < Locations.Num(); ++i)
+				{
+					const float Distance = FVector::Distance(Query, Locations[i]);
+					if (Distance < ClosestDistance && Distance > 50) { Closest = i; ClosestDistance = Distance; }
+					if (Distance > FarthestDistance) { Farthest = i; FarthestDistance = Distance; }
+				}
+				Sink += Closest + Farthest;
+			}
+			const double LinearTime = FPlatformTime::Seconds() - Start;
+
+			UE_LOG(LogMonsterAI, Display, TEXT("RunAwayIndex %6d locations: build %8.3f ms, index %8.1f ns/query, linear %8.1f ns/query"),
+				NumPoints, BuildTime * 1000.0, IndexTime * 1e9 / (NumQueries * 2), LinearTime * 1e9 / (NumQueries * 2));
+		}
+	}
+
+	FAutoConsoleCommand BenchmarkRunAwayIndexCommand(
+		TEXT("MonsterAI.BenchmarkRunAwayIndex"),
+		TEXT("Times runaway location queries on the spatial index against a linear scan for 10 to 10,000 locations"),
+		FConsoleCommandDelegate::CreateStatic(&BenchmarkRunAwayIndex));
+}
+#endif
+#pragma endregion
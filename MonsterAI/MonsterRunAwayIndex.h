@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Static k-d tree over the monster's runaway locations.
+ * Built once when the level's runaway locations are gathered, then answers closest/farthest queries
+ * without scanning every location or taking square roots.
+ */
+struct SPOOKYGAME_API FMonsterRunAwayIndex
+{
+public:
+	/**
+	 * Rebuilds the tree over a new set of locations
+	 * @param InPoints The runaway locations. Query results are indices into this array
+	 */
+	void Build(const TArray<FVector>& InPoints);
+
+	/**
+	 * @return The locations the index was built from, in their original order
+	 */
+	const TArray<FVector>& GetPoints() const { return Points; }
+
+	/**
+	 * @return Number of indexed locations
+	 */
+	int32 Num() const { return Points.Num(); }
+
+	/**
+	 * Finds the location closest to a point, ignoring locations within MinDistance of it
+	 * @param Location The point to measure from
+	 * @param MinDistance Locations this close or closer are ignored
+	 * @return Index of the closest location, INDEX_NONE if every location is within MinDistance
+	 */
+	int32 FindClosest(const FVector& Location, float MinDistance = 0.0f) const;
+
+	/**
+	 * Finds the location farthest from a point
+	 * @param Location The point to measure from
+	 * @return Index of the farthest location, INDEX_NONE if the index is empty
+	 */
+	int32 FindFarthest(const FVector& Location) const;
+
+private:
+	struct FNode
+	{
+		/** Bounds of every location under this node */
+		FBox Bounds;
+		/** Range of this node's locations in Order */
+		int32 Begin;
+		int32 End;
+		/** Child node indices, INDEX_NONE for leaves */
+		int32 Left = INDEX_NONE;
+		int32 Right = INDEX_NONE;
+	};
+
+	/**
+	 * Recursively builds the node for Order[Begin, End)
+	 * @return Index of the new node
+	 */
+	int32 BuildNode(int32 Begin, int32 End);
+
+	/**
+	 * @return Squared distance from Location to the farthest corner of Box
+	 */
+	static float MaxDistSquared(const FBox& Box, const FVector& Location);
+
+	/** Locations in their original order */
+	TArray<FVector> Points;
+
+	/** Indices into Points, partitioned by the tree */
+	TArray<int32> Order;
+
+	/** Tree nodes, root at index 0 */
+	TArray<FNode> Nodes;
+};
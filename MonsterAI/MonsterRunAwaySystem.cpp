@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterRunAwaySystem.h"
+
+#include "WorldActorRegistry.h"
+#include "NavigationSystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+
+namespace
+{
+	TAutoConsoleVariable<float> CVarMonsterNavDistanceCellSize(
+		TEXT("MonsterAI.NavDistanceCellSize"),
+		400.0f,
+		TEXT("Width and depth of the navmesh regions the runaway walking distance table is baked for. Read whenever the table is built"));
+
+	TAutoConsoleVariable<float> CVarMonsterNavDistanceCellHeight(
+		TEXT("MonsterAI.NavDistanceCellHeight"),
+		300.0f,
+		TEXT("Height of the navmesh regions the runaway walking distance table is baked for. Read whenever the table is built"));
+
+	TAutoConsoleVariable<float> CVarMonsterNavDistanceBakeBudgetMs(
+		TEXT("MonsterAI.NavDistanceBakeBudgetMs"),
+		2.0f,
+		TEXT("Milliseconds per frame spent baking the runaway walking distance table. At least one runaway location is baked per frame"));
+}
+
+bool UMonsterRunAwaySystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have monsters to run away
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMonsterRunAwaySystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	Locations = Registry ? Registry->GetRunAwayLocations() : TArray<FVector>();
+	Index.Build(Locations);
+
+	//the table goes out of date whenever the navmesh is rebuilt, including one that was still building when play began
+	if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(&InWorld))
+	{
+		NavSys->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &UMonsterRunAwaySystem::OnNavigationGenerationFinished);
+		BoundNavSys = NavSys;
+	}
+	BuildNavDistances();
+}
+
+void UMonsterRunAwaySystem::Deinitialize()
+{
+	if (BoundNavSys.IsValid())
+	{
+		BoundNavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UMonsterRunAwaySystem::OnNavigationGenerationFinished);
+	}
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(BakeTimerHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+void UMonsterRunAwaySystem::BuildNavDistances()
+{
+	GetWorld()->GetTimerManager().ClearTimer(BakeTimerHandle);
+	NavDistances.Build(GetWorld(), Locations, CVarMonsterNavDistanceCellSize.GetValueOnGameThread(), CVarMonsterNavDistanceCellHeight.GetValueOnGameThread());
+	if (NavDistances.IsBaking())
+	{
+		BakeTimerHandle = GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UMonsterRunAwaySystem::ContinueBake);
+	}
+}
+
+void UMonsterRunAwaySystem::ContinueBake()
+{
+	if (!NavDistances.BakeStep(CVarMonsterNavDistanceBakeBudgetMs.GetValueOnGameThread() / 1000.0))
+	{
+		BakeTimerHandle = GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UMonsterRunAwaySystem::ContinueBake);
+	}
+}
+
+void UMonsterRunAwaySystem::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	BuildNavDistances();
+}
+
+//until the walking distance table is ready it answers nothing and these rank by straight-line distance
+int32 UMonsterRunAwaySystem::FindClosest(const FVector& Location, const float MinDistance, const bool bUseWalkingDistance) const
+{
+	const int32 Closest = bUseWalkingDistance ? NavDistances.FindClosest(Location, MinDistance) : INDEX_NONE;
+	return Closest != INDEX_NONE ? Closest : Index.FindClosest(Location, MinDistance);
+}
+
+int32 UMonsterRunAwaySystem::FindFarthest(const FVector& Location, const bool bUseWalkingDistance) const
+{
+	const int32 Farthest = bUseWalkingDistance ? NavDistances.FindFarthest(Location) : INDEX_NONE;
+	return Farthest != INDEX_NONE ? Farthest : Index.FindFarthest(Location);
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MonsterNavDistanceTable.h"
+#include "MonsterRunAwayIndex.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterRunAwaySystem.generated.h"
+
+/**
+ * The level's runaway locations with the spatial index and baked walking distance table over them, shared by every monster.
+ * Everything is built when play begins, so possessing a monster (including promoting one out of the horde mid game)
+ * costs nothing. The walking distance table is loaded from disk when the runaway locations, grid and navmesh are unchanged,
+ * and otherwise baked a few milliseconds a frame (MonsterAI.NavDistanceBakeBudgetMs). It is rebuilt whenever the navmesh is,
+ * and until it is ready the queries rank by straight-line distance. Its grid is set with MonsterAI.NavDistanceCellSize
+ * and MonsterAI.NavDistanceCellHeight
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterRunAwaySystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/**
+	 * Gathers the runaway locations and builds the index and walking distance table over them
+	 * @param InWorld The world
+	 */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	virtual void Deinitialize() override;
+
+	/**
+	 * @return The runaway locations. Query results are indices into this array
+	 */
+	const TArray<FVector>& GetLocations() const { return Locations; }
+
+	/**
+	 * Finds the runaway location closest to a point, ignoring any within MinDistance of it
+	 * @param Location The point to measure from
+	 * @param MinDistance Locations this close or closer are ignored
+	 * @param bUseWalkingDistance If true, ranks by baked walking distance where it is known, otherwise only by straight-line distance
+	 * @return Index of the location, INDEX_NONE if there is none
+	 */
+	int32 FindClosest(const FVector& Location, float MinDistance, bool bUseWalkingDistance) const;
+
+	/**
+	 * Finds the runaway location farthest from a point
+	 * @param Location The point to measure from
+	 * @param bUseWalkingDistance If true, ranks by baked walking distance where it is known, otherwise only by straight-line distance
+	 * @return Index of the location, INDEX_NONE if there is none
+	 */
+	int32 FindFarthest(const FVector& Location, bool bUseWalkingDistance) const;
+
+private:
+	/**
+	 * Loads or starts baking the walking distance table for the current navmesh
+	 */
+	void BuildNavDistances();
+
+	/**
+	 * Bakes the walking distance table for one frame's budget and comes back next frame until it is done
+	 */
+	void ContinueBake();
+
+	/**
+	 * Called when the navmesh finishes building, the walking distance table is out of date from then on
+	 * @param NavData The navigation data that was built
+	 */
+	UFUNCTION()
+	void OnNavigationGenerationFinished(class ANavigationData* NavData);
+
+	/**
+	 * List of locations that the monsters can "run away" to
+	 * These are designer placed objects that are in convenient locations
+	 */
+	TArray<FVector> Locations;
+
+	/**
+	 * Spatial index over Locations
+	 */
+	FMonsterRunAwayIndex Index;
+
+	/**
+	 * Baked walking distances from navmesh regions to each of Locations
+	 */
+	FMonsterNavDistanceTable NavDistances;
+
+	/**
+	 * Timer for the next step of the walking distance table's bake
+	 */
+	FTimerHandle BakeTimerHandle;
+
+	/**
+	 * Navigation system OnNavigationGenerationFinished is bound to
+	 */
+	TWeakObjectPtr<class UNavigationSystemV1> BoundNavSys;
+};
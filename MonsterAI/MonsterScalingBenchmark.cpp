@@ -0,0 +1,419 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterScalingBenchmark.h"
+
+#include "Monster.h"
+#include "MonsterAIController.h"
+#include "MonsterAIStats.h"
+#include "NavigationSystem.h"
+#include "WorldActorRegistry.h"
+#include "EngineUtils.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Stats/StatsData.h"
+#include "Tests/AutomationCommon.h"
+
+namespace
+{
+	/**
+	 * Parses a comma separated list of monster counts
+	 * @param List The list
+	 * @return The counts, or 1, 10, 50 and 200 if the list is empty
+	 */
+	TArray<int32> ParseMonsterCounts(const FString& List)
+	{
+		TArray<FString> Entries;
+		List.ParseIntoArray(Entries, TEXT(","));
+
+		TArray<int32> Counts;
+		for (const FString& Entry : Entries)
+		{
+			Counts.Add(FMath::Max(FCString::Atoi(*Entry), 0));
+		}
+		if (Counts.Num() < 1)
+		{
+			Counts = { 1, 10, 50, 200 };
+		}
+		return Counts;
+	}
+}
+
+bool UMonsterScalingBenchmark::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_BUILD_SHIPPING
+	return false;
+#else
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+#endif
+}
+
+void UMonsterScalingBenchmark::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FString CountList;
+	if (!FParse::Param(FCommandLine::Get(), TEXT("MonsterAIBenchmark")) && !FParse::Value(FCommandLine::Get(), TEXT("MonsterAIBenchmark="), CountList)) { return; }
+
+	float CommandLineDuration = Duration;
+	FParse::Value(FCommandLine::Get(), TEXT("MonsterAIBenchmarkDuration="), CommandLineDuration);
+
+	FString ClassPath;
+	TSubclassOf<AMonster> CommandLineClass;
+	if (FParse::Value(FCommandLine::Get(), TEXT("MonsterAIBenchmarkClass="), ClassPath))
+	{
+		CommandLineClass = LoadClass<AMonster>(nullptr, *ClassPath);
+	}
+
+	Start(ParseMonsterCounts(CountList), CommandLineDuration, CommandLineClass, true);
+}
+
+void UMonsterScalingBenchmark::Start(const TArray<int32>& InMonsterCounts, const float InDuration, TSubclassOf<AMonster> InMonsterClass, const bool bInExitWhenDone)
+{
+	if (IsRunning()) { return; }
+
+	//without a class to spawn, copy the monster the map already has
+	MonsterClass = InMonsterClass;
+	if (!MonsterClass)
+	{
+		TActorIterator<AMonster> It(GetWorld());
+		MonsterClass = It ? It->GetClass() : nullptr;
+	}
+	if (!MonsterClass)
+	{
+		UE_LOG(LogMonsterAI, Error, TEXT("Scaling benchmark: no monster class given and no monster in the map to copy"));
+		return;
+	}
+
+	//the baseline measures the map's own monsters, which run in every other run too
+	MonsterCounts = InMonsterCounts;
+	MonsterCounts.Insert(0, 0);
+	Duration = FMath::Max(InDuration, 1.0f);
+	bExitWhenDone = bInExitWhenDone;
+	Results.Reset();
+	SpawnStream.Initialize(0);
+	RunIndex = 0;
+
+#if STATS
+	//the cycle stats are read back from the stats frames the game thread receives, which only hold groups shown with "stat"
+	const FGameThreadStatsData* StatsData = FLatestGameThreadStatsData::Get().Latest;
+	bEnabledStats = !StatsData || !StatsData->GroupNames.Contains(FName(FStatGroup_STATGROUP_MonsterAI::GetGroupName()));
+	if (bEnabledStats)
+	{
+		GEngine->Exec(GetWorld(), TEXT("stat MonsterAI"));
+	}
+#else
+	UE_LOG(LogMonsterAI, Warning, TEXT("Scaling benchmark: stats are compiled out of this build, only frame times are measured"));
+#endif
+
+	UE_LOG(LogMonsterAI, Display, TEXT("Scaling benchmark: %d runs of %.0fs with %s"), MonsterCounts.Num(), Duration, *MonsterClass->GetName());
+	BeginRun();
+}
+
+void UMonsterScalingBenchmark::BeginRun()
+{
+	Current = FRunResult();
+	Current.NumMonsters = MonsterCounts[RunIndex];
+	SpawnMonsters(Current.NumMonsters);
+
+	bMeasuring = false;
+	PhaseStartTime = GetWorld()->GetTimeSeconds();
+}
+
+void UMonsterScalingBenchmark::EndRun()
+{
+	if (Current.NumFrames > 0)
+	{
+		Current.FrameMs /= Current.NumFrames;
+		Current.AIMs /= Current.NumFrames;
+		for (TPair<FString, double>& Stat : Current.StatMs)
+		{
+			Stat.Value /= Current.NumFrames;
+		}
+	}
+	Current.NavQueriesPerSecond = (MonsterAIStats::GetNumNavQueries() - NavQueriesAtStart) / Duration;
+	Results.Add(Current);
+
+	for (const TWeakObjectPtr<AMonster>& Monster : SpawnedMonsters)
+	{
+		if (!Monster.IsValid()) { continue; }
+
+		if (AController* Controller = Monster->GetController())
+		{
+			Controller->Destroy();
+		}
+		Monster->Destroy();
+	}
+	SpawnedMonsters.Reset();
+}
+
+void UMonsterScalingBenchmark::SampleStats()
+{
+#if STATS
+	const FGameThreadStatsData* StatsData = FLatestGameThreadStatsData::Get().Latest;
+	const int32 GroupIndex = StatsData ? StatsData->GroupNames.IndexOfByKey(FName(FStatGroup_STATGROUP_MonsterAI::GetGroupName())) : INDEX_NONE;
+	if (GroupIndex == INDEX_NONE || !StatsData->ActiveStatGroups.IsValidIndex(GroupIndex)) { return; }
+
+	//exclusive times add up to the group's total without counting a stat nested in another twice
+	for (const FComplexStatMessage& Stat : StatsData->ActiveStatGroups[GroupIndex].FlatAggregate)
+	{
+		if (!Stat.NameAndInfo.GetFlag(EStatMetaFlags::IsCycle)) { continue; }
+
+		Current.StatMs.FindOrAdd(Stat.GetShortName().ToString()) += FPlatformTime::ToMilliseconds(Stat.GetValue_Duration(EComplexStatField::IncAve));
+		Current.AIMs += FPlatformTime::ToMilliseconds(Stat.GetValue_Duration(EComplexStatField::ExcAve));
+	}
+#endif
+}
+
+void UMonsterScalingBenchmark::SpawnMonsters(const int32 Count)
+{
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!NavSys || !NavSys->MainNavData) { return; }
+
+	//spread the monsters around the player so they have somewhere to wander and someone to chase
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	const AActor* Player = Registry ? Registry->GetPlayer() : nullptr;
+	const FVector Origin = Player ? Player->GetActorLocation() : FVector::ZeroVector;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		FNavLocation SpawnLocation;
+		bool bFound = false;
+		for (int32 Attempt = 0; Attempt < 16 && !bFound; ++Attempt)
+		{
+			const FVector Candidate = Origin + FVector(SpawnStream.FRandRange(-SpawnRadius, SpawnRadius), SpawnStream.FRandRange(-SpawnRadius, SpawnRadius), 0.0f);
+			bFound = NavSys->ProjectPointToNavigation(Candidate, SpawnLocation, FVector(500.0f, 500.0f, 1000.0f), NavSys->MainNavData);
+		}
+		if (!bFound) { continue; }
+
+		AMonster* Monster = GetWorld()->SpawnActor<AMonster>(MonsterClass, SpawnLocation.Location + FVector(0.0f, 0.0f, 100.0f), FRotator::ZeroRotator, SpawnParams);
+		if (!Monster) { continue; }
+
+		if (!Monster->GetController())
+		{
+			Monster->SpawnDefaultController();
+		}
+		if (AMonsterAIController* AIController = Cast<AMonsterAIController>(Monster->GetController()))
+		{
+			AIController->ActivateMonster();
+		}
+		SpawnedMonsters.Add(Monster);
+	}
+
+	if (SpawnedMonsters.Num() < Count)
+	{
+		UE_LOG(LogMonsterAI, Warning, TEXT("Scaling benchmark: only spawned %d of %d monsters"), SpawnedMonsters.Num(), Count);
+	}
+}
+
+void UMonsterScalingBenchmark::Tick(float DeltaTime)
+{
+	const float Elapsed = GetWorld()->GetTimeSeconds() - PhaseStartTime;
+
+	if (!bMeasuring)
+	{
+		if (Elapsed < WarmupTime) { return; }
+
+		bMeasuring = true;
+		PhaseStartTime = GetWorld()->GetTimeSeconds();
+		LastFrameTime = FPlatformTime::Seconds();
+		NavQueriesAtStart = MonsterAIStats::GetNumNavQueries();
+		return;
+	}
+
+	//game thread time of the frame that just finished, measured from this tick to the next
+	const double Now = FPlatformTime::Seconds();
+	Current.FrameMs += (Now - LastFrameTime) * 1000.0;
+	++Current.NumFrames;
+	LastFrameTime = Now;
+	Current.PeakUsedPhysical = FMath::Max<uint64>(Current.PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+	SampleStats();
+
+	if (Elapsed < Duration) { return; }
+
+	EndRun();
+	if (++RunIndex < MonsterCounts.Num())
+	{
+		BeginRun();
+		return;
+	}
+
+	RunIndex = INDEX_NONE;
+	if (bEnabledStats)
+	{
+		GEngine->Exec(GetWorld(), TEXT("stat MonsterAI"));
+		bEnabledStats = false;
+	}
+	WriteResults();
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UMonsterScalingBenchmark::WriteResults() const
+{
+	const uint64 BaselinePhysical = Results.Num() > 0 ? Results[0].PeakUsedPhysical : 0;
+
+	FString Json = TEXT("{\n");
+	Json += FString::Printf(TEXT("\t\"map\": \"%s\",\n"), *GetWorld()->GetMapName());
+	Json += FString::Printf(TEXT("\t\"build\": \"%s\",\n"), FApp::GetBuildVersion());
+	Json += FString::Printf(TEXT("\t\"date\": \"%s\",\n"), *FDateTime::UtcNow().ToIso8601());
+	Json += FString::Printf(TEXT("\t\"monsterClass\": \"%s\",\n"), *MonsterClass->GetPathName());
+	Json += FString::Printf(TEXT("\t\"durationSeconds\": %.1f,\n"), Duration);
+	Json += FString::Printf(TEXT("\t\"fixedTimeStep\": %s,\n"), FApp::UseFixedTimeStep() ? TEXT("true") : TEXT("false"));
+	Json += TEXT("\t\"runs\": [\n");
+	for (int32 i = 0; i < Results.Num(); ++i)
+	{
+		const FRunResult& Result = Results[i];
+
+		//AI cost is the time the MonsterAI stats measured, frame time is only there for context
+		FString StatsJson;
+		for (const TPair<FString, double>& Stat : Result.StatMs)
+		{
+			StatsJson += FString::Printf(TEXT("%s\"%s\": %.4f"), StatsJson.IsEmpty() ? TEXT("") : TEXT(", "), *Stat.Key, Stat.Value);
+		}
+		Json += FString::Printf(TEXT("\t\t{ \"monsters\": %d, \"frames\": %d, \"frameMs\": %.3f, \"aiMsPerFrame\": %.4f, \"statMsPerFrame\": { %s }, \"navQueriesPerSecond\": %.1f, \"peakUsedPhysicalMB\": %.1f, \"peakUsedPhysicalOverBaselineMB\": %.1f }%s\n"),
+			Result.NumMonsters, Result.NumFrames, Result.FrameMs, Result.AIMs, *StatsJson, Result.NavQueriesPerSecond,
+			Result.PeakUsedPhysical / (1024.0 * 1024.0), (static_cast<int64>(Result.PeakUsedPhysical) - static_cast<int64>(BaselinePhysical)) / (1024.0 * 1024.0),
+			i + 1 < Results.Num() ? TEXT(",") : TEXT(""));
+
+		UE_LOG(LogMonsterAI, Display, TEXT("Scaling benchmark: %4d monsters, %.4fms MonsterAI per frame (%.3fms frame), %.1f nav queries/s, %.1fMB peak"),
+			Result.NumMonsters, Result.AIMs, Result.FrameMs, Result.NavQueriesPerSecond, Result.PeakUsedPhysical / (1024.0 * 1024.0));
+	}
+	Json += TEXT("\t]\n}\n");
+
+	//one file per set of monster counts, so the automation test's one count per test doesn't overwrite the other counts
+	FString Counts;
+	for (int32 i = 1; i < MonsterCounts.Num(); ++i)
+	{
+		Counts += FString::Printf(TEXT("_%d"), MonsterCounts[i]);
+	}
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("MonsterAI") / FString::Printf(TEXT("ScalingBenchmark%s.json"), *Counts);
+	if (FFileHelper::SaveStringToFile(Json, *Path))
+	{
+		UE_LOG(LogMonsterAI, Display, TEXT("Scaling benchmark results written to %s"), *Path);
+	}
+	else
+	{
+		UE_LOG(LogMonsterAI, Error, TEXT("Failed to write scaling benchmark results to %s"), *Path);
+	}
+}
+
+ETickableTickType UMonsterScalingBenchmark::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UMonsterScalingBenchmark::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonsterScalingBenchmark, STATGROUP_Tickables);
+}
+
+#pragma region Benchmark
+#if !UE_BUILD_SHIPPING
+namespace
+{
+	/**
+	 * Starts the scaling benchmark in the current world. Arguments: [duration] [comma separated monster counts]
+	 */
+	void BenchmarkScaling(const TArray<FString>& Args, UWorld* World)
+	{
+		UMonsterScalingBenchmark* Benchmark = World ? World->GetSubsystem<UMonsterScalingBenchmark>() : nullptr;
+		if (!Benchmark) { return; }
+
+		const float Duration = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 30.0f;
+		Benchmark->Start(ParseMonsterCounts(Args.Num() > 1 ? Args[1] : FString()), Duration, nullptr, false);
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs BenchmarkScalingCommand(
+		TEXT("MonsterAI.BenchmarkScaling"),
+		TEXT("Measures the monster AI with increasing numbers of monsters. Arguments: [duration seconds] [counts, e.g. 1,10,50,200]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkScaling));
+}
+#endif
+#pragma endregion
+
+#pragma region Automation Test
+#if WITH_DEV_AUTOMATION_TESTS
+namespace
+{
+	/**
+	 * Waits for the scaling benchmark to finish and reports its results to the test
+	 */
+	DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FWaitForMonsterScalingBenchmark, TWeakObjectPtr<UMonsterScalingBenchmark>, Benchmark, FAutomationTestBase*, Test);
+
+	bool FWaitForMonsterScalingBenchmark::Update()
+	{
+		if (!Benchmark.IsValid())
+		{
+			Test->AddError(TEXT("The world was torn down before the scaling benchmark finished"));
+			return true;
+		}
+		if (Benchmark->IsRunning()) { return false; }
+
+		for (const UMonsterScalingBenchmark::FRunResult& Result : Benchmark->GetResults())
+		{
+			Test->AddInfo(FString::Printf(TEXT("%d monsters: %.4fms MonsterAI per frame over %d frames, %.1f nav queries/s, %.1fMB peak"),
+				Result.NumMonsters, Result.AIMs, Result.NumFrames, Result.NavQueriesPerSecond, Result.PeakUsedPhysical / (1024.0 * 1024.0)));
+			for (const TPair<FString, double>& Stat : Result.StatMs)
+			{
+				Test->AddInfo(FString::Printf(TEXT("    %s: %.4fms"), *Stat.Key, Stat.Value));
+			}
+		}
+		return true;
+	}
+}
+
+/**
+ * The scaling benchmark as an automation test, one test per monster count. Needs a game world with a monster in it to copy
+ */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FMonsterScalingBenchmarkTest, "SpookyGame.MonsterAI.ScalingBenchmark",
+	EAutomationTestFlags::ClientContext | EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+void FMonsterScalingBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const int32 Count : ParseMonsterCounts(FString()))
+	{
+		OutBeautifiedNames.Add(FString::Printf(TEXT("%d Monsters"), Count));
+		OutTestCommands.Add(FString::FromInt(Count));
+	}
+}
+
+bool FMonsterScalingBenchmarkTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = AutomationCommon::GetAnyGameWorld();
+	UMonsterScalingBenchmark* Benchmark = World ? World->GetSubsystem<UMonsterScalingBenchmark>() : nullptr;
+	if (!Benchmark)
+	{
+		AddError(TEXT("No game world to run the scaling benchmark in, run with -game on a map with a monster in it"));
+		return false;
+	}
+
+	float Duration = 30.0f;
+	FParse::Value(FCommandLine::Get(), TEXT("MonsterAIBenchmarkDuration="), Duration);
+
+	Benchmark->Start({ FCString::Atoi(*Parameters) }, Duration, nullptr, false);
+	if (!Benchmark->IsRunning())
+	{
+		AddError(TEXT("The scaling benchmark didn't start, see the log"));
+		return false;
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMonsterScalingBenchmark(Benchmark, this));
+	return true;
+}
+#endif
+#pragma endregion
@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterScalingBenchmark.generated.h"
+
+/**
+ * Measures how the monster AI scales with the number of monsters. For each monster count it spawns that many monsters
+ * of the map's monster class on the navmesh, activates them, lets them run for a fixed amount of world time and records
+ * the time per frame spent in each MonsterAI cycle stat, game thread ms per frame, nav queries per second and peak memory.
+ * Results are written to Saved/MonsterAI/ScalingBenchmark_<counts>.json, e.g. ScalingBenchmark_50.json for one count.
+ *
+ * Run headless on a reference map as an automation test, one test per monster count:
+ *   -game -nullrhi -ExecCmds="Automation RunTests SpookyGame.MonsterAI.ScalingBenchmark; Quit" [-MonsterAIBenchmarkDuration=30] [-MonsterAISeed=1]
+ * or without the automation framework, exiting when done:
+ *   -game -nullrhi -MonsterAIBenchmark[=1,10,50,200] [-MonsterAIBenchmarkDuration=30] [-MonsterAIBenchmarkClass=/Game/Path.Class_C] [-MonsterAISeed=1]
+ * In a running game use the MonsterAI.BenchmarkScaling console command instead. Not available in shipping builds
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterScalingBenchmark : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * World time in seconds the monsters run for after spawning before measuring starts
+	 */
+	static constexpr float WarmupTime = 2.0f;
+
+	/**
+	 * Monsters are spawned on the navmesh within this distance of the player
+	 */
+	static constexpr float SpawnRadius = 5000.0f;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/**
+	 * Starts the benchmark if it was asked for on the command line
+	 * @param InWorld The world
+	 */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/**
+	 * Runs the benchmark. A run with no extra monsters is measured first as the baseline
+	 * @param InMonsterCounts Number of monsters to measure with, in order
+	 * @param InDuration World time in seconds to measure each monster count for
+	 * @param InMonsterClass Class of monster to spawn. Null uses the class of a monster already in the map
+	 * @param bInExitWhenDone If true, the game exits once the results are written
+	 */
+	void Start(const TArray<int32>& InMonsterCounts, float InDuration, TSubclassOf<class AMonster> InMonsterClass, bool bInExitWhenDone);
+
+	/**
+	 * @return True while the benchmark is running
+	 */
+	bool IsRunning() const { return RunIndex != INDEX_NONE; }
+
+	/**
+	 * What was measured for one monster count
+	 */
+	struct FRunResult
+	{
+		/** Number of monsters spawned for the run */
+		int32 NumMonsters = 0;
+		/** Number of frames measured */
+		int32 NumFrames = 0;
+		/** Average game thread time per frame in milliseconds */
+		double FrameMs = 0.0;
+		/** Average time per frame in milliseconds spent in the MonsterAI stat group, each stat's exclusive time added up */
+		double AIMs = 0.0;
+		/** Average inclusive time per frame in milliseconds of each MonsterAI cycle stat, by stat name */
+		TMap<FString, double> StatMs;
+		/** Navigation queries run by the monsters per second of world time */
+		double NavQueriesPerSecond = 0.0;
+		/** Highest physical memory used by the process during the run, in bytes */
+		uint64 PeakUsedPhysical = 0;
+	};
+
+	/**
+	 * @return The results of the last benchmark, the 0 monster baseline first
+	 */
+	const TArray<FRunResult>& GetResults() const { return Results; }
+
+#pragma region FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return IsRunning(); }
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+#pragma endregion
+
+private:
+	/**
+	 * Spawns the monsters for the run at RunIndex and starts its warmup
+	 */
+	void BeginRun();
+
+	/**
+	 * Records the result of the current run and destroys its monsters
+	 */
+	void EndRun();
+
+	/**
+	 * Adds the MonsterAI cycle stats of the latest stats frame to the current run
+	 */
+	void SampleStats();
+
+	/**
+	 * Spawns and activates monsters on the navmesh around the player
+	 * @param Count Number of monsters to spawn
+	 */
+	void SpawnMonsters(int32 Count);
+
+	/**
+	 * Writes every run's result to Saved/MonsterAI/ScalingBenchmark_<counts>.json and the log
+	 */
+	void WriteResults() const;
+
+	/**
+	 * Class of monster spawned
+	 */
+	UPROPERTY(Transient)
+	TSubclassOf<class AMonster> MonsterClass;
+
+	/**
+	 * Monsters spawned for the current run
+	 */
+	TArray<TWeakObjectPtr<class AMonster>> SpawnedMonsters;
+
+	/**
+	 * Monster count of each run, the first is always the 0 monster baseline
+	 */
+	TArray<int32> MonsterCounts;
+
+	/**
+	 * Finished runs
+	 */
+	TArray<FRunResult> Results;
+
+	/**
+	 * Index into MonsterCounts of the current run, INDEX_NONE when not running
+	 */
+	int32 RunIndex = INDEX_NONE;
+
+	/**
+	 * World time in seconds each run is measured for
+	 */
+	float Duration = 30.0f;
+
+	bool bExitWhenDone = false;
+
+	/**
+	 * True if the benchmark turned on the MonsterAI stat group, so it turns it off again when done
+	 */
+	bool bEnabledStats = false;
+
+	/**
+	 * True once the current run's warmup is over
+	 */
+	bool bMeasuring = false;
+
+	/**
+	 * World time the current run's warmup or measurement started
+	 */
+	float PhaseStartTime = 0.0f;
+
+	/**
+	 * Platform time of the last measured frame
+	 */
+	double LastFrameTime = 0.0;
+
+	/**
+	 * Nav query total when measuring started
+	 */
+	int64 NavQueriesAtStart = 0;
+
+	/**
+	 * The current run's measurements so far
+	 */
+	FRunResult Current;
+
+	/**
+	 * Source of the spawn locations. Always starts from the same seed so every run spawns in the same places
+	 */
+	FRandomStream SpawnStream;
+};
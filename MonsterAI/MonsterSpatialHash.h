@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform 2D grid of elements keyed by cell, for finding everything near a point without visiting everything.
+ * Each element lives in exactly one cell, so radius queries never return duplicates.
+ */
+template<typename ElementType>
+class TMonsterSpatialHash
+{
+public:
+	explicit TMonsterSpatialHash(const float InCellSize = 1000.0f)
+		: CellSize(InCellSize)
+	{
+	}
+
+	/**
+	 * Adds an element, or moves it if it is already in the hash
+	 * @param Element The element
+	 * @param Location Where the element is
+	 */
+	void Update(const ElementType& Element, const FVector& Location)
+	{
+		const FIntPoint NewCell = GetCell(Location);
+		if (FIntPoint* OldCell = ElementCells.Find(Element))
+		{
+			if (*OldCell == NewCell) { return; }
+			RemoveFromCell(Element, *OldCell);
+			*OldCell = NewCell;
+		}
+		else
+		{
+			ElementCells.Add(Element, NewCell);
+		}
+		Cells.FindOrAdd(NewCell).Add(Element);
+	}
+
+	/**
+	 * Removes an element
+	 * @param Element The element
+	 */
+	void Remove(const ElementType& Element)
+	{
+		FIntPoint OldCell;
+		if (ElementCells.RemoveAndCopyValue(Element, OldCell))
+		{
+			RemoveFromCell(Element, OldCell);
+		}
+	}
+
+	/**
+	 * Finds every element in a cell overlapping a circle. Callers still need to check the exact distance
+	 * @param Center Center of the circle, Z is ignored
+	 * @param Radius Radius of the circle
+	 * @param OutElements Elements found are added to this
+	 */
+	template<typename AllocatorType>
+	void Query(const FVector& Center, const float Radius, TArray<ElementType, AllocatorType>& OutElements) const
+	{
+		const FIntPoint Min = GetCell(Center - FVector(Radius, Radius, 0.0f));
+		const FIntPoint Max = GetCell(Center + FVector(Radius, Radius, 0.0f));
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			for (int32 X = Min.X; X <= Max.X; ++X)
+			{
+				if (const TArray<ElementType>* Cell = Cells.Find(FIntPoint(X, Y)))
+				{
+					OutElements.Append(*Cell);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Removes every element
+	 */
+	void Reset()
+	{
+		Cells.Reset();
+		ElementCells.Reset();
+	}
+
+	/**
+	 * @return Number of elements in the hash
+	 */
+	int32 Num() const { return ElementCells.Num(); }
+
+private:
+	FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+	}
+
+	void RemoveFromCell(const ElementType& Element, const FIntPoint& Cell)
+	{
+		if (TArray<ElementType>* Elements = Cells.Find(Cell))
+		{
+			Elements->RemoveSingleSwap(Element, false);
+			if (Elements->Num() < 1)
+			{
+				Cells.Remove(Cell);
+			}
+		}
+	}
+
+	float CellSize;
+
+	/** Elements in each occupied cell */
+	TMap<FIntPoint, TArray<ElementType>> Cells;
+
+	/** The cell each element is in */
+	TMap<ElementType, FIntPoint> ElementCells;
+};
@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterStateRules.h"
+
+namespace MonsterStateRules
+{
+	namespace
+	{
+		FTransition Unchanged(const EState State)
+		{
+			FTransition Result;
+			Result.State = State;
+			return Result;
+		}
+
+		/**
+		 * A transition from a state only known at run time. Whether any state may change to To is checked at compile time,
+		 * and whether From may is checked here. Staying in From is always allowed, a change TransitionTable doesn't allow
+		 * leaves the state unchanged
+		 */
+		template <EState To>
+		FTransition Enter(const EState From, const ESound Sound, const EEntry Entry)
+		{
+			static_assert(IsEnterable(To), "No state may change to this one, add it to TransitionTable first");
+			if (From != To && !IsAllowed(From, To)) { return Unchanged(From); }
+
+			FTransition Result;
+			Result.State = To;
+			Result.Sound = Sound;
+			Result.Entry = Entry;
+			return Result;
+		}
+
+		/**
+		 * A transition between states known at compile time, which doesn't compile unless TransitionTable allows it
+		 */
+		template <EState From, EState To>
+		FTransition Enter(const ESound Sound, const EEntry Entry)
+		{
+			static_assert(IsAllowed(From, To), "TransitionTable doesn't allow this transition");
+
+			FTransition Result;
+			Result.State = To;
+			Result.Sound = Sound;
+			Result.Entry = Entry;
+			return Result;
+		}
+
+		FTransition GoToPlayer(const EState State, const float Duration)
+		{
+			FTransition Result = Enter<EState::GoToPlayer>(State, IsAggressive(State) ? ESound::None : ESound::Detected, EEntry::GoToPlayer);
+			Result.GoToPlayerDuration = Duration;
+			return Result;
+		}
+
+		FTransition Search(const EState State)
+		{
+			return Enter<EState::Search>(State, State == EState::Search ? ESound::None : ESound::SearchLoop, EEntry::Search);
+		}
+
+		/**
+		 * A sound close enough to pursue rather than search for, or a sighting
+		 */
+		FTransition OnCloseCue(const FInputs& Inputs)
+		{
+			//follow player if told to
+			if (Inputs.HowLongToGoToPlayer > 0)
+			{
+				return GoToPlayer(Inputs.State, Inputs.HowLongToGoToPlayer);
+			}
+
+			//don't respond to sound if chasing player directly
+			if (Inputs.State == EState::GoToPlayer) { return Unchanged(Inputs.State); }
+
+			//pursue the sound
+			return Enter<EState::Pursue>(Inputs.State, Inputs.State == EState::Pursue ? ESound::None : ESound::Detected, EEntry::Pursue);
+		}
+
+		FTransition OnSound(const FInputs& Inputs)
+		{
+			//don't respond to sounds while inactive, or sounds that don't reach the monster
+			if (Inputs.State == EState::Inactive || Inputs.Distance >= Inputs.HearableRadius) { return Unchanged(Inputs.State); }
+
+			if (Inputs.Distance < Inputs.PursueInsteadOfSearchRadius) { return OnCloseCue(Inputs); }
+
+			//dont go into search mode while in a more agressive mode
+			if (IsAggressive(Inputs.State)) { return Unchanged(Inputs.State); }
+
+			//investigate the general area
+			return Search(Inputs.State);
+		}
+	}
+
+	FTransition Transition(const FInputs& Inputs)
+	{
+		switch (Inputs.Event)
+		{
+		case EEvent::Sound:
+			return OnSound(Inputs);
+
+		case EEvent::PlayerSeen:
+			//seeing the player counts as hearing them up close
+			if (Inputs.State == EState::Inactive) { return Unchanged(Inputs.State); }
+			return OnCloseCue(Inputs);
+
+		case EEvent::FollowPlayer:
+			//an inactive monster is only woken up by Activate, TransitionTable leaves it inactive
+			return GoToPlayer(Inputs.State, Inputs.HowLongToGoToPlayer);
+
+		case EEvent::Activate:
+			//once active, activating again sends the monster to the player
+			if (Inputs.State != EState::Inactive) { return GoToPlayer(Inputs.State, Inputs.HowLongToGoToPlayer); }
+			return Enter<EState::Inactive, EState::Wander>(ESound::Detected, EEntry::None);
+
+		case EEvent::PlayerDeath:
+			//an inactive monster sleeps through it, only Activate wakes it up
+			if (Inputs.State == EState::Inactive) { return Unchanged(Inputs.State); }
+			return Enter<EState::Wander>(Inputs.State, ESound::None, EEntry::Reset);
+
+		case EEvent::StartSearch:
+			return Search(Inputs.State);
+
+		case EEvent::ReachedTarget:
+			//reached the sound, search around it. Wander and search pick a new target instead, which isn't a state change
+			if (Inputs.State == EState::Pursue && Inputs.Distance < ArrivalRadius) { return Enter<EState::Pursue, EState::Search>(ESound::SearchLoop, EEntry::Search); }
+			return Unchanged(Inputs.State);
+
+		case EEvent::SearchTimeUp:
+			//something more interesting happened in the meantime
+			if (Inputs.State != EState::Search) { return Unchanged(Inputs.State); }
+
+			//after an amount of time searching, switch to wandering
+			return Enter<EState::Search, EState::Wander>(ESound::IdleLoop, EEntry::Wander);
+
+		case EEvent::GoToPlayerTimeUp:
+			if (Inputs.State != EState::GoToPlayer) { return Unchanged(Inputs.State); }
+
+			//search where the player was if the monster got there, otherwise pursue the player's last position
+			if (Inputs.Distance < ArrivalRadius) { return Enter<EState::GoToPlayer, EState::Search>(ESound::SearchLoop, EEntry::Search); }
+			return Enter<EState::GoToPlayer, EState::Pursue>(ESound::None, EEntry::None);
+		}
+
+		return Unchanged(Inputs.State);
+	}
+
+	FWanderChoice ChooseWanderTarget(const FWanderInputs& Inputs)
+	{
+		FWanderChoice Choice;
+		Choice.TimeSincePursue = Inputs.TimeSincePursue;
+
+		//keep away from a safe player
+		if (Inputs.bPlayerSafe)
+		{
+			Choice.Target = EWanderTarget::AwayFromPlayer;
+			return Choice;
+		}
+
+		//in case monster gets close without you ever making a sound, this makes him leave eventually anyway
+		if (Inputs.DistanceToPlayer <= LingerRadius && Inputs.TimeSincePursue < 0)
+		{
+			Choice.TimeSincePursue = 1.0f;
+		}
+
+		//this will only ever happen out of the search algo and it'll be like ~30, but this still runs
+		if (Inputs.TimeSincePursue >= LingerTime)
+		{
+			Choice.Target = EWanderTarget::FarthestRunaway;
+			Choice.TimeSincePursue = -1.0f;
+		}
+		return Choice;
+	}
+}
@@ -0,0 +1,307 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * The monster's state transition rules, kept free of the engine so they can be built, tested and profiled on their own.
+ * Only standard headers may be included here. AMonsterAIController gathers the inputs from the blackboard and carries out
+ * the transition (blackboard writes, timers, sounds)
+ */
+namespace MonsterStateRules
+{
+	/**
+	 * The monster's states, in the same order as EGurneyMonsterStates
+	 */
+	enum class EState : uint8_t
+	{
+		Wander,
+		Pursue,
+		GoToPlayer,
+		Search,
+		ListenToLog,
+		Inactive
+	};
+
+	/**
+	 * Something that can change the monster's state
+	 */
+	enum class EEvent : uint8_t
+	{
+		/** The monster was told about a sound */
+		Sound,
+		/** The monster saw the player */
+		PlayerSeen,
+		/** The monster was told to go to the player */
+		FollowPlayer,
+		/** The monster was activated */
+		Activate,
+		/** The player died */
+		PlayerDeath,
+		/** The monster was told to search */
+		StartSearch,
+		/** The state service checked how close the monster is to its target location */
+		ReachedTarget,
+		/** The search timer ran out */
+		SearchTimeUp,
+		/** The go to player timer ran out */
+		GoToPlayerTimeUp
+	};
+
+	/**
+	 * Transition sound to play
+	 */
+	enum class ESound : uint8_t
+	{
+		None,
+		Detected,
+		SearchLoop,
+		IdleLoop
+	};
+
+	/**
+	 * What happens when the new state is entered, beyond writing the state
+	 */
+	enum class EEntry : uint8_t
+	{
+		/** Only the state is written */
+		None,
+		/** Target the event's location */
+		Pursue,
+		/** Search around the event's location and start the search timer */
+		Search,
+		/** Start the go to player timer for GoToPlayerDuration */
+		GoToPlayer,
+		/** Wander from the monster's location with the desired wander radius */
+		Wander,
+		/** Wander from the monster's location and stop every state timer */
+		Reset
+	};
+
+	/**
+	 * Everything the rules look at
+	 */
+	struct FInputs
+	{
+		/** The monster's state */
+		EState State = EState::Wander;
+		/** What happened */
+		EEvent Event = EEvent::Sound;
+		/** For Sound: how far the sound travelled to reach the monster. Otherwise the distance to the target location */
+		float Distance = 0.0f;
+		/** For Sound: radius the sound can be heard in */
+		float HearableRadius = 0.0f;
+		/** For Sound: sounds closer than this are pursued rather than searched for */
+		float PursueInsteadOfSearchRadius = 0.0f;
+		/** For Sound, PlayerSeen and FollowPlayer: time in seconds to go to the player. 0 or less pursues the sound or sighting instead */
+		float HowLongToGoToPlayer = -1.0f;
+	};
+
+	/**
+	 * The outcome of an event. An event that changes nothing leaves State as it was with no sound or entry
+	 */
+	struct FTransition
+	{
+		/** The monster's state afterwards */
+		EState State = EState::Wander;
+		/** Transition sound to play */
+		ESound Sound = ESound::None;
+		/** What to do on entering State */
+		EEntry Entry = EEntry::None;
+		/** For GoToPlayer entries: time in seconds to go to the player */
+		float GoToPlayerDuration = 0.0f;
+	};
+
+	/**
+	 * Number of states
+	 */
+	constexpr int NumStates = static_cast<int>(EState::Inactive) + 1;
+
+	/**
+	 * @param State A state
+	 * @return The state's bit in TransitionTable
+	 */
+	constexpr uint8_t StateBit(const EState State)
+	{
+		return static_cast<uint8_t>(1u << static_cast<uint8_t>(State));
+	}
+
+	/**
+	 * The states each state may change to, by the state changed from. Staying in a state isn't a change and isn't listed, the rules
+	 * re-enter a state to move a pursuit to a closer sound, restart the go to player timer or search around a new sound.
+	 * Any active state gives way to a sound or sighting and returns to wandering when the player dies, and a search turns into going
+	 * to the player when the cue comes with go to player time. Nothing changes to ListenToLog or Inactive, those are only set up front,
+	 * and an inactive monster only wakes up by wandering when it's activated
+	 */
+	constexpr uint8_t TransitionTable[NumStates] =
+	{
+		/* Wander */		StateBit(EState::Pursue) | StateBit(EState::GoToPlayer) | StateBit(EState::Search),
+		/* Pursue */		StateBit(EState::Wander) | StateBit(EState::GoToPlayer) | StateBit(EState::Search),
+		/* GoToPlayer */	StateBit(EState::Wander) | StateBit(EState::Pursue) | StateBit(EState::Search),
+		/* Search */		StateBit(EState::Wander) | StateBit(EState::Pursue) | StateBit(EState::GoToPlayer),
+		/* ListenToLog */	StateBit(EState::Wander) | StateBit(EState::Pursue) | StateBit(EState::GoToPlayer) | StateBit(EState::Search),
+		/* Inactive */		StateBit(EState::Wander)
+	};
+
+	/**
+	 * @param From The state changed from
+	 * @param To The state changed to
+	 * @return True if TransitionTable allows the change. False for From == To, which isn't a change
+	 */
+	constexpr bool IsAllowed(const EState From, const EState To)
+	{
+		return (TransitionTable[static_cast<int>(From)] & StateBit(To)) != 0;
+	}
+
+	/**
+	 * @param To A state
+	 * @return True if TransitionTable lets any state change to To
+	 */
+	constexpr bool IsEnterable(const EState To)
+	{
+		for (int From = 0; From < NumStates; ++From)
+		{
+			if (IsAllowed(static_cast<EState>(From), To)) { return true; }
+		}
+		return false;
+	}
+
+	/**
+	 * A monster this close to its target location has reached it
+	 */
+	constexpr float ArrivalRadius = 150.0f;
+
+	/**
+	 * Where a wandering monster heads when it picks its next target
+	 */
+	enum class EWanderTarget : uint8_t
+	{
+		/** A random reachable point around the wander center */
+		RandomPoint,
+		/** The runaway location farthest from the player, who is in a safe zone */
+		AwayFromPlayer,
+		/** The runaway location farthest from the monster, which has hung around the player for long enough */
+		FarthestRunaway
+	};
+
+	/**
+	 * Everything a wandering monster's choice of target looks at
+	 */
+	struct FWanderInputs
+	{
+		/** True if the player is in a safe zone */
+		bool bPlayerSafe = false;
+		/** Distance from the monster to the player */
+		float DistanceToPlayer = 0.0f;
+		/** Seconds since the monster stopped pursuing or came near the player, negative if it hasn't since it last left */
+		float TimeSincePursue = -1.0f;
+	};
+
+	/**
+	 * A wandering monster's choice of target
+	 */
+	struct FWanderChoice
+	{
+		/** Where to head */
+		EWanderTarget Target = EWanderTarget::RandomPoint;
+		/** The monster's time since pursue afterwards */
+		float TimeSincePursue = -1.0f;
+	};
+
+	/**
+	 * A wandering monster this close to the player starts counting up to leaving, in case it gets close without ever hearing them
+	 */
+	constexpr float LingerRadius = 1100.0f;
+
+	/**
+	 * Seconds since pursue after which a wandering monster leaves for the farthest runaway location
+	 */
+	constexpr float LingerTime = 4.0f;
+
+	/**
+	 * Works out where a wandering monster that reached its target heads next. Only asked while there is a player
+	 * @param Inputs The monster's situation
+	 * @return The choice
+	 */
+	FWanderChoice ChooseWanderTarget(const FWanderInputs& Inputs);
+
+	/**
+	 * Works out how the monster's state changes in response to an event. Reads nothing but the inputs
+	 * @param Inputs The monster's state and the event
+	 * @return The transition
+	 */
+	FTransition Transition(const FInputs& Inputs);
+
+	/**
+	 * @param State A state
+	 * @return True for the states that chase the player or a sound, which sounds don't pull the monster out of
+	 */
+	constexpr bool IsAggressive(const EState State)
+	{
+		return State == EState::GoToPlayer || State == EState::Pursue;
+	}
+
+	/**
+	 * Carries out transitions through an owner's hooks: the transition sound, then the old state's exit hook if the state changes,
+	 * then the new state's enter hook. The hooks are templates over the state, so each state's entry and exit is written once and
+	 * picked at compile time, and a transition that changes nothing runs none of them. OwnerType needs, with any extra arguments
+	 * passed to Apply after the transition:
+	 *   void PlayTransitionSound(ESound Sound, Args...)
+	 *   template <EState State> void OnExitState(Args...)
+	 *   template <EState State> void OnEnterState(const FTransition& Transition, Args...)
+	 * Owners that keep the hooks private make TStateMachine<OwnerType> a friend
+	 */
+	template <typename OwnerType>
+	struct TStateMachine
+	{
+		/**
+		 * @param Owner The owner
+		 * @param From The state before the transition
+		 * @param Transition The transition, from Transition()
+		 * @param Args Passed on to every hook
+		 */
+		template <typename... ArgTypes>
+		static void Apply(OwnerType& Owner, const EState From, const FTransition& Transition, const ArgTypes&... Args)
+		{
+			if (Transition.Sound != ESound::None)
+			{
+				Owner.PlayTransitionSound(Transition.Sound, Args...);
+			}
+
+			const bool bStateChanged = Transition.State != From;
+			if (!bStateChanged && Transition.Entry == EEntry::None) { return; }
+
+			if (bStateChanged)
+			{
+				switch (From)
+				{
+				case EState::Wander:		Owner.template OnExitState<EState::Wander>(Args...); break;
+				case EState::Pursue:		Owner.template OnExitState<EState::Pursue>(Args...); break;
+				case EState::GoToPlayer:	Owner.template OnExitState<EState::GoToPlayer>(Args...); break;
+				case EState::Search:		Owner.template OnExitState<EState::Search>(Args...); break;
+				case EState::ListenToLog:	Owner.template OnExitState<EState::ListenToLog>(Args...); break;
+				case EState::Inactive:		Owner.template OnExitState<EState::Inactive>(Args...); break;
+				}
+			}
+
+			//the rules never enter ListenToLog or Inactive, so those hooks aren't even instantiated
+			switch (Transition.State)
+			{
+			case EState::Wander:		Enter<EState::Wander>(Owner, Transition, Args...); break;
+			case EState::Pursue:		Enter<EState::Pursue>(Owner, Transition, Args...); break;
+			case EState::GoToPlayer:	Enter<EState::GoToPlayer>(Owner, Transition, Args...); break;
+			case EState::Search:		Enter<EState::Search>(Owner, Transition, Args...); break;
+			default: break;
+			}
+		}
+
+	private:
+		template <EState State, typename... ArgTypes>
+		static void Enter(OwnerType& Owner, const FTransition& Transition, const ArgTypes&... Args)
+		{
+			static_assert(IsEnterable(State), "No state may change to this one, add it to TransitionTable first");
+			Owner.template OnEnterState<State>(Transition, Args...);
+		}
+	};
+}
@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterTelemetry.h"
+
+#include "MonsterAIController.h"
+#include "MonsterAIStats.h"
+#include "MonsterStates.h"
+#include "DrawDebugHelpers.h"
+#include "EngineUtils.h"
+#include "Debug/DebugDrawService.h"
+#include "Engine/Canvas.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+
+#if MONSTER_TELEMETRY
+namespace
+{
+	TAutoConsoleVariable<int32> CVarMonsterTelemetry(
+		TEXT("MonsterAI.Telemetry"),
+		0,
+		TEXT("Record monster AI telemetry and draw it over the game view.\n0: off (monsters with drawDebugInfo still record), 1: on"));
+
+	FString GetStateName(const uint8 State)
+	{
+		return StaticEnum<EGurneyMonsterStates>()->GetDisplayNameTextByValue(State).ToString();
+	}
+
+	FString GetEventName(const EMonsterTelemetryEvent Event)
+	{
+		switch (Event)
+		{
+		case EMonsterTelemetryEvent::StateChanged: return TEXT("State");
+		case EMonsterTelemetryEvent::TargetChanged: return TEXT("Target");
+		case EMonsterTelemetryEvent::SearchCenterChanged: return TEXT("SearchCenter");
+		case EMonsterTelemetryEvent::SoundHeard: return TEXT("SoundHeard");
+		case EMonsterTelemetryEvent::SoundIgnored: return TEXT("SoundIgnored");
+		case EMonsterTelemetryEvent::FollowPlayer: return TEXT("FollowPlayer");
+		case EMonsterTelemetryEvent::PlayerSeen: return TEXT("PlayerSeen");
+		default: return TEXT("Unknown");
+		}
+	}
+
+	/**
+	 * Draws the latest sample of every recording monster. Replaces the debug drawing that used to run in the controller's Tick
+	 */
+	void DrawTelemetry(UCanvas* Canvas, APlayerController* PlayerController)
+	{
+		if (!Canvas || !PlayerController) { return; }
+
+		for (TActorIterator<AMonsterAIController> It(PlayerController->GetWorld()); It; ++It)
+		{
+			const FMonsterTelemetry& Telemetry = It->GetTelemetry();
+			const FMonsterTelemetrySample* Latest = Telemetry.GetLatest();
+			if (!Latest) { continue; }
+
+			//target and search center
+			DrawDebugCanvasWireSphere(Canvas, Latest->TargetLocation, FColor::Blue, 50, 4);
+			if (Latest->State == EGurneyMonsterStates::GMS_Search)
+			{
+				DrawDebugCanvasWireSphere(Canvas, Latest->SearchCenter, FColor::Orange, 50, 4);
+			}
+
+			//hearing radii of the last sound, for a moment after it was heard
+			const float Now = PlayerController->GetWorld()->GetTimeSeconds();
+			Telemetry.ForEach([Canvas, Now](const FMonsterTelemetrySample& Sample)
+			{
+				if (Sample.Event != EMonsterTelemetryEvent::SoundHeard || Now - Sample.Time > 1.5f) { return; }
+				DrawDebugCanvasWireSphere(Canvas, Sample.Location, FColor::Red, Sample.HearableRadius, 15);
+				DrawDebugCanvasWireSphere(Canvas, Sample.Location, FColor::Green, Sample.PursueInsteadOfSearchRadius, 15);
+			});
+
+			//text above the monster
+			const FVector ScreenLocation = Canvas->Project(Latest->Location + FVector(0, 0, 120));
+			if (ScreenLocation.Z <= 0) { continue; }
+
+			const FString Text = FString::Printf(TEXT("%s\nTarget: %s\nTime since pursue: %.1f\nState time left: %.1f"),
+				*GetStateName(Latest->State), *Latest->TargetLocation.ToCompactString(), Latest->TimeSincePursue, Latest->StateTimeRemaining);
+			Canvas->SetDrawColor(FColor::Orange);
+			Canvas->DrawText(GEngine->GetSmallFont(), Text, ScreenLocation.X, ScreenLocation.Y);
+		}
+	}
+
+	/**
+	 * Writes every recorded sample of every monster to the log
+	 */
+	void DumpTelemetry(UWorld* World)
+	{
+		for (TActorIterator<AMonsterAIController> It(World); It; ++It)
+		{
+			UE_LOG(LogMonsterAI, Display, TEXT("%s: %d telemetry samples"), *It->GetName(), It->GetTelemetry().Num());
+			It->GetTelemetry().ForEach([](const FMonsterTelemetrySample& Sample)
+			{
+				UE_LOG(LogMonsterAI, Display, TEXT("  %8.2f %-12s %-11s at %s target %s search %s pursue %.1f left %.1f sound %s r%.0f d%.0f"),
+					Sample.Time, *GetEventName(Sample.Event), *GetStateName(Sample.State), *Sample.Location.ToCompactString(),
+					*Sample.TargetLocation.ToCompactString(), *Sample.SearchCenter.ToCompactString(), Sample.TimeSincePursue, Sample.StateTimeRemaining,
+					*Sample.SoundOrigin.ToCompactString(), Sample.HearableRadius, Sample.HearingDistance);
+			});
+		}
+	}
+
+	FAutoConsoleCommandWithWorld DumpTelemetryCommand(
+		TEXT("MonsterAI.DumpTelemetry"),
+		TEXT("Writes every monster's recorded AI telemetry to the log"),
+		FConsoleCommandWithWorldDelegate::CreateStatic(&DumpTelemetry));
+}
+#endif
+
+bool FMonsterTelemetry::IsEnabled(const bool bDrawDebugInfo)
+{
+#if MONSTER_TELEMETRY
+	return bDrawDebugInfo || CVarMonsterTelemetry.GetValueOnGameThread() != 0;
+#else
+	return false;
+#endif
+}
+
+FSimpleMulticastDelegate& FMonsterTelemetry::OnEnabledChanged()
+{
+	static FSimpleMulticastDelegate EnabledChanged;
+#if MONSTER_TELEMETRY
+	//the console variable passes its changes on from the first time anyone listens
+	static bool bBound = false;
+	if (!bBound)
+	{
+		bBound = true;
+		CVarMonsterTelemetry.AsVariable()->SetOnChangedCallback(FConsoleVariableDelegate::CreateLambda([](IConsoleVariable*) { EnabledChanged.Broadcast(); }));
+	}
+#endif
+	return EnabledChanged;
+}
+
+void FMonsterTelemetry::Add(const FMonsterTelemetrySample& Sample)
+{
+#if MONSTER_TELEMETRY
+	//the viewer starts drawing the first time anything is recorded
+	static FDelegateHandle DrawHandle = UDebugDrawService::Register(TEXT("Game"), FDebugDrawDelegate::CreateStatic(&DrawTelemetry));
+
+	if (Samples.Num() < Capacity)
+	{
+		Samples.Add(Sample);
+		return;
+	}
+	Samples[Next] = Sample;
+	Next = (Next + 1) % Capacity;
+#endif
+}
+
+const FMonsterTelemetrySample* FMonsterTelemetry::GetLatest() const
+{
+	if (Samples.Num() < 1) { return nullptr; }
+	return Samples.Num() < Capacity ? &Samples.Last() : &Samples[(Next + Capacity - 1) % Capacity];
+}
+
+void FMonsterTelemetry::ForEach(TFunctionRef<void(const FMonsterTelemetrySample&)> Visitor) const
+{
+	//once full, the oldest sample is the one about to be overwritten
+	const int32 Start = Samples.Num() < Capacity ? 0 : Next;
+	for (int32 i = 0; i < Samples.Num(); ++i)
+	{
+		Visitor(Samples[(Start + i) % Samples.Num()]);
+	}
+}
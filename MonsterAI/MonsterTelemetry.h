@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Telemetry is compiled out of shipping builds entirely
+ */
+#define MONSTER_TELEMETRY !UE_BUILD_SHIPPING
+
+/**
+ * What caused a telemetry sample to be recorded
+ */
+enum class EMonsterTelemetryEvent : uint8
+{
+	StateChanged,
+	TargetChanged,
+	SearchCenterChanged,
+	SoundHeard,
+	SoundIgnored,
+	FollowPlayer,
+	PlayerSeen
+};
+
+/**
+ * Snapshot of a monster's AI taken when something about it changed. Only raw values are stored, formatting happens in the viewer
+ */
+struct FMonsterTelemetrySample
+{
+	/** World time of the sample */
+	float Time = 0.0f;
+	/** What caused the sample */
+	EMonsterTelemetryEvent Event = EMonsterTelemetryEvent::StateChanged;
+	/** The monster's state */
+	uint8 State = 0;
+	/** Where the monster was */
+	FVector Location = FVector::ZeroVector;
+	/** The monster's target location */
+	FVector TargetLocation = FVector::ZeroVector;
+	/** The point the monster searches around */
+	FVector SearchCenter = FVector::ZeroVector;
+	/** Radius within which the monster pursues sounds instead of searching for them */
+	float PursueInsteadOfSearchRadius = 0.0f;
+	/** Seconds since the monster stopped pursuing, -1 if not counting */
+	float TimeSincePursue = -1.0f;
+	/** Seconds left before searching or going to the player ends, -1 if neither is running */
+	float StateTimeRemaining = -1.0f;
+	/** For sound events: where the sound came from */
+	FVector SoundOrigin = FVector::ZeroVector;
+	/** For sound events: radius the sound can be heard in */
+	float HearableRadius = 0.0f;
+	/** For sound events: how far the sound travelled to reach the monster */
+	float HearingDistance = 0.0f;
+};
+
+/**
+ * Fixed size ring buffer of a monster's most recent telemetry samples.
+ * Samples are only recorded while the MonsterAI.Telemetry console variable is set, or the monster has drawDebugInfo on
+ */
+class SPOOKYGAME_API FMonsterTelemetry
+{
+public:
+	/**
+	 * Number of samples kept per monster
+	 */
+	static constexpr int32 Capacity = 256;
+
+	/**
+	 * @param bDrawDebugInfo The monster's own debug flag
+	 * @return True if samples should be recorded for a monster
+	 */
+	static bool IsEnabled(bool bDrawDebugInfo);
+
+	/**
+	 * @return Broadcast when the MonsterAI.Telemetry console variable changes, so monsters can start or stop watching for samples
+	 */
+	static FSimpleMulticastDelegate& OnEnabledChanged();
+
+	/**
+	 * Adds a sample, overwriting the oldest once the buffer is full
+	 * @param Sample The sample
+	 */
+	void Add(const FMonsterTelemetrySample& Sample);
+
+	/**
+	 * @return The most recent sample, or nullptr if there are none
+	 */
+	const FMonsterTelemetrySample* GetLatest() const;
+
+	/**
+	 * Calls Visitor on every sample, oldest first
+	 * @param Visitor Called with each sample
+	 */
+	void ForEach(TFunctionRef<void(const FMonsterTelemetrySample&)> Visitor) const;
+
+	/**
+	 * @return Number of samples in the buffer
+	 */
+	int32 Num() const { return Samples.Num(); }
+
+private:
+	TArray<FMonsterTelemetrySample> Samples;
+
+	/** Where the next sample goes once the buffer is full */
+	int32 Next = 0;
+};
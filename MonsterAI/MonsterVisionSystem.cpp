@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonsterVisionSystem.h"
+
+#include "MonsterAIController.h"
+#include "MonsterAIStats.h"
+#include "MonsterPresenceHeatMap.h"
+#include "MonsterStates.h"
+#include "WorldActorRegistry.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarMonsterVisionTracesPerFrame(
+		TEXT("MonsterAI.VisionTracesPerFrame"),
+		6,
+		TEXT("Most sight traces the monsters start in one frame, the rest wait for the next"));
+}
+
+bool UMonsterVisionSystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//only game worlds have a player to see
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UMonsterVisionSystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	TraceDelegate.BindUObject(this, &UMonsterVisionSystem::OnTraceDone);
+}
+
+void UMonsterVisionSystem::AddWatcher(AMonsterAIController* Watcher)
+{
+	if (Watchers.ContainsByPredicate([Watcher](const FWatcher& Existing) { return Existing.Controller == Watcher; })) { return; }
+
+	FWatcher& NewWatcher = Watchers.AddDefaulted_GetRef();
+	NewWatcher.Controller = Watcher;
+}
+
+void UMonsterVisionSystem::RemoveWatcher(const AMonsterAIController* Watcher)
+{
+	//its pending check finds no controller when it finishes
+	Watchers.RemoveAllSwap([Watcher](const FWatcher& Existing) { return Existing.Controller == Watcher; }, false);
+}
+
+void UMonsterVisionSystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonsterVisionTick);
+
+	if (Watchers.Num() < 1 && TraceQueue.Num() < 1) { return; }
+
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	const AActor* Player = Registry ? Registry->GetPlayer() : nullptr;
+	if (!Player) { return; }
+
+	//if player is safe they can't be seen either
+	const bool bPlayerSafe = Registry->IsPlayerSafe();
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (int32 i = Watchers.Num() - 1; i >= 0; --i)
+	{
+		FWatcher& Watcher = Watchers[i];
+		if (!Watcher.Controller.IsValid())
+		{
+			Watchers.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+		if (bPlayerSafe || Watcher.PendingCheckID != 0 || Now < Watcher.NextCheckTime) { continue; }
+
+		Watcher.NextCheckTime = Now + CheckInterval;
+		StartCheck(Watcher, *Player);
+	}
+
+	//start the oldest traces the budget allows
+	const int32 Budget = FMath::Max(CVarMonsterVisionTracesPerFrame.GetValueOnGameThread(), 1);
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(MonsterVision), false);
+	int32 NumTaken = 0;
+	int32 NumStarted = 0;
+	for (; NumTaken < TraceQueue.Num() && NumStarted < Budget; ++NumTaken)
+	{
+		const FQueuedTrace& Trace = TraceQueue[NumTaken];
+
+		//the check already saw the player through another point
+		const FCheck* Check = Checks.Find(Trace.CheckID);
+		if (!Check) { continue; }
+
+		//or its monster is gone
+		const APawn* Monster = Check->Controller.IsValid() ? Check->Controller->GetPawn() : nullptr;
+		if (!Monster)
+		{
+			Checks.Remove(Trace.CheckID);
+			ClearPendingCheck(Trace.CheckID);
+			continue;
+		}
+
+		//the player is ignored, so any hit is something in the way
+		Params.ClearIgnoredActors();
+		Params.AddIgnoredActor(Monster);
+		Params.AddIgnoredActor(Player);
+		GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Test, Trace.Start, Trace.End, ECC_Visibility, Params, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, Trace.CheckID);
+		++NumStarted;
+	}
+	TraceQueue.RemoveAt(0, NumTaken, false);
+
+	INC_DWORD_STAT_BY(STAT_MonsterVisionTraces, NumStarted);
+	SET_DWORD_STAT(STAT_MonsterVisionQueuedTraces, TraceQueue.Num());
+}
+
+void UMonsterVisionSystem::StartCheck(FWatcher& Watcher, const AActor& Player)
+{
+	AMonsterAIController* Controller = Watcher.Controller.Get();
+	const APawn* Monster = Controller->GetPawn();
+	if (!Monster || !Controller->CanSeePlayer() || Controller->GetMonsterCurrentState() == EGurneyMonsterStates::GMS_Inactive) { return; }
+	INC_DWORD_STAT(STAT_MonsterVisionChecks);
+
+	//outside the sight range or the view cone nothing is traced
+	const FVector Eye = Monster->GetPawnViewLocation();
+	const FVector PlayerLocation = Player.GetActorLocation();
+	const FVector ToPlayer = PlayerLocation - Eye;
+	if (ToPlayer.SizeSquared() > FMath::Square(Controller->GetSightRange())) { return; }
+	if ((ToPlayer.GetSafeNormal() | Monster->GetActorForwardVector()) < FMath::Cos(FMath::DegreesToRadians(Controller->GetSightHalfAngle()))) { return; }
+
+	const uint32 CheckID = NextCheckID++;
+	if (NextCheckID == 0) { NextCheckID = 1; }
+
+	FCheck& Check = Checks.Add(CheckID);
+	Check.Controller = Controller;
+	Check.PlayerLocation = PlayerLocation;
+	Check.TracesLeft = NumSamplePoints;
+	Watcher.PendingCheckID = CheckID;
+
+	//head, middle and feet, so the player can't hide behind something that only covers part of them
+	const float HalfHeight = Player.GetSimpleCollisionHalfHeight() * 0.75f;
+	TraceQueue.Add({ CheckID, Eye, PlayerLocation + FVector(0.0f, 0.0f, HalfHeight) });
+	TraceQueue.Add({ CheckID, Eye, PlayerLocation });
+	TraceQueue.Add({ CheckID, Eye, PlayerLocation - FVector(0.0f, 0.0f, HalfHeight) });
+}
+
+void UMonsterVisionSystem::OnTraceDone(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	FCheck* Check = Checks.Find(Datum.UserData);
+	if (!Check) { return; }
+
+	//one clear line is enough, the check's other traces are skipped or ignored
+	const bool bClear = Datum.OutHits.Num() < 1 || !Datum.OutHits[0].bBlockingHit;
+	if (bClear || --Check->TracesLeft <= 0)
+	{
+		FinishCheck(Datum.UserData, bClear);
+	}
+}
+
+void UMonsterVisionSystem::FinishCheck(const uint32 CheckID, const bool bSeen)
+{
+	const FCheck Check = Checks.FindAndRemoveChecked(CheckID);
+	ClearPendingCheck(CheckID);
+
+	AMonsterAIController* Controller = Check.Controller.Get();
+	if (!Controller) { return; }
+
+	if (bSeen && Controller->GetPawn())
+	{
+		INC_DWORD_STAT(STAT_MonsterVisionSightings);
+		Controller->ReportSight(Check.PlayerLocation);
+
+		//wandering monsters drift towards where the player was seen
+		if (UMonsterPresenceHeatMap* HeatMap = GetWorld()->GetSubsystem<UMonsterPresenceHeatMap>())
+		{
+			HeatMap->AddHeat(Check.PlayerLocation, UMonsterPresenceHeatMap::SightHeat);
+		}
+	}
+}
+
+void UMonsterVisionSystem::ClearPendingCheck(const uint32 CheckID)
+{
+	if (FWatcher* Watcher = Watchers.FindByPredicate([CheckID](const FWatcher& Existing) { return Existing.PendingCheckID == CheckID; }))
+	{
+		Watcher->PendingCheckID = 0;
+	}
+}
+
+ETickableTickType UMonsterVisionSystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UMonsterVisionSystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonsterVisionSystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MonsterVisionSystem.generated.h"
+
+/**
+ * Lets the monsters see the player. Every CheckInterval each watching monster tests the player against its sight range and
+ * view cone, which costs no traces when the player is outside either. Otherwise lines from the monster's eyes to a few points
+ * on the player's capsule are queued, and the queue is worked through with async traces, MonsterAI.VisionTracesPerFrame a frame.
+ * Any clear line counts as seeing the player, which the controller treats like hearing them up close
+ */
+UCLASS()
+class SPOOKYGAME_API UMonsterVisionSystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Seconds between a monster's sight checks
+	 */
+	static constexpr float CheckInterval = 0.2f;
+
+	/**
+	 * Points on the player's capsule traced to: head, middle and feet
+	 */
+	static constexpr int32 NumSamplePoints = 3;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/**
+	 * Start checking whether a monster can see the player
+	 * @param Watcher The monster's controller
+	 */
+	void AddWatcher(class AMonsterAIController* Watcher);
+
+	/**
+	 * Stop checking whether a monster can see the player
+	 * @param Watcher The monster's controller
+	 */
+	void RemoveWatcher(const class AMonsterAIController* Watcher);
+
+#pragma region FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+#pragma endregion
+
+private:
+	struct FWatcher
+	{
+		/** The monster's controller */
+		TWeakObjectPtr<class AMonsterAIController> Controller;
+		/** World time of the monster's next sight check */
+		float NextCheckTime = 0.0f;
+		/** ID of the monster's check waiting on traces, 0 if none */
+		uint32 PendingCheckID = 0;
+	};
+
+	/**
+	 * A sight check whose traces haven't all come back
+	 */
+	struct FCheck
+	{
+		/** The monster's controller */
+		TWeakObjectPtr<class AMonsterAIController> Controller;
+		/** Where the player was when the check started */
+		FVector PlayerLocation;
+		/** Traces still to come back */
+		int32 TracesLeft;
+	};
+
+	/**
+	 * A trace waiting for budget
+	 */
+	struct FQueuedTrace
+	{
+		uint32 CheckID;
+		FVector Start;
+		FVector End;
+	};
+
+	/**
+	 * Starts a sight check for a monster, if the player is within its range and view cone
+	 * @param Watcher The monster
+	 * @param Player The player
+	 */
+	void StartCheck(FWatcher& Watcher, const AActor& Player);
+
+	/**
+	 * Ends a check and tells the monster if it saw the player
+	 * @param CheckID The check
+	 * @param bSeen True if the monster saw the player
+	 */
+	void FinishCheck(uint32 CheckID, bool bSeen);
+
+	/**
+	 * Lets the watcher waiting on a check start new ones. Called wherever a check is removed
+	 * @param CheckID The check
+	 */
+	void ClearPendingCheck(uint32 CheckID);
+
+	/**
+	 * Called when an async sight trace comes back
+	 * @param Handle The trace
+	 * @param Datum The trace's result, UserData is the check's ID
+	 */
+	void OnTraceDone(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	TArray<FWatcher> Watchers;
+
+	/**
+	 * Checks waiting on traces, by ID
+	 */
+	TMap<uint32, FCheck> Checks;
+
+	/**
+	 * Traces waiting for budget, oldest first
+	 */
+	TArray<FQueuedTrace> TraceQueue;
+
+	/**
+	 * ID of the next check. 0 is never used
+	 */
+	uint32 NextCheckID = 1;
+
+	FTraceDelegate TraceDelegate;
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//built with CMake only, Unreal Build Tool compiles every source file in the module and has no Google Benchmark
+#ifndef WITH_ENGINE
+
+#include "MonsterStateRules.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace MonsterStateRules;
+
+namespace
+{
+	/**
+	 * Every state with every event at distances inside and outside each radius
+	 */
+	std::vector<FInputs> MakeInputs()
+	{
+		std::vector<FInputs> AllInputs;
+		for (int State = 0; State < NumStates; ++State)
+		{
+			for (int Event = 0; Event <= static_cast<int>(EEvent::GoToPlayerTimeUp); ++Event)
+			{
+				for (const float Distance : { 100.0f, 500.0f, 2000.0f })
+				{
+					for (const float HowLongToGoToPlayer : { -1.0f, 5.0f })
+					{
+						FInputs Inputs;
+						Inputs.State = static_cast<EState>(State);
+						Inputs.Event = static_cast<EEvent>(Event);
+						Inputs.Distance = Distance;
+						Inputs.HearableRadius = 1000.0f;
+						Inputs.PursueInsteadOfSearchRadius = 400.0f;
+						Inputs.HowLongToGoToPlayer = HowLongToGoToPlayer;
+						AllInputs.push_back(Inputs);
+					}
+				}
+			}
+		}
+		return AllInputs;
+	}
+
+	/**
+	 * Owner whose hooks only count, so the benchmark measures the state machine's dispatch
+	 */
+	struct FCountingOwner
+	{
+		int Calls = 0;
+
+		void PlayTransitionSound(ESound) { ++Calls; }
+
+		template <EState State>
+		void OnExitState() { ++Calls; }
+
+		template <EState State>
+		void OnEnterState(const FTransition&) { ++Calls; }
+	};
+
+	void BM_Transition(benchmark::State& BenchmarkState)
+	{
+		const std::vector<FInputs> AllInputs = MakeInputs();
+		for (auto _ : BenchmarkState)
+		{
+			for (const FInputs& Inputs : AllInputs)
+			{
+				benchmark::DoNotOptimize(Transition(Inputs));
+			}
+		}
+		BenchmarkState.SetItemsProcessed(BenchmarkState.iterations() * static_cast<int64_t>(AllInputs.size()));
+	}
+	BENCHMARK(BM_Transition);
+
+	void BM_TransitionAndApply(benchmark::State& BenchmarkState)
+	{
+		const std::vector<FInputs> AllInputs = MakeInputs();
+		FCountingOwner Owner;
+		for (auto _ : BenchmarkState)
+		{
+			for (const FInputs& Inputs : AllInputs)
+			{
+				TStateMachine<FCountingOwner>::Apply(Owner, Inputs.State, Transition(Inputs));
+			}
+			benchmark::DoNotOptimize(Owner.Calls);
+		}
+		BenchmarkState.SetItemsProcessed(BenchmarkState.iterations() * static_cast<int64_t>(AllInputs.size()));
+	}
+	BENCHMARK(BM_TransitionAndApply);
+}
+
+#endif
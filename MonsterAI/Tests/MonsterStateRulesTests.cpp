@@ -0,0 +1,353 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//built with CMake only, Unreal Build Tool compiles every source file in the module and has no gtest
+#ifndef WITH_ENGINE
+
+#include "MonsterStateRules.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace MonsterStateRules;
+
+namespace
+{
+	constexpr float HearableRadius = 1500.0f;
+	constexpr float PursueInsteadOfSearchRadius = 600.0f;
+
+	FInputs MakeInputs(const EState State, const EEvent Event, const float Distance = 0.0f, const float HowLongToGoToPlayer = -1.0f)
+	{
+		FInputs Inputs;
+		Inputs.State = State;
+		Inputs.Event = Event;
+		Inputs.Distance = Distance;
+		Inputs.HearableRadius = HearableRadius;
+		Inputs.PursueInsteadOfSearchRadius = PursueInsteadOfSearchRadius;
+		Inputs.HowLongToGoToPlayer = HowLongToGoToPlayer;
+		return Inputs;
+	}
+
+	void ExpectTransition(const FInputs& Inputs, const EState State, const ESound Sound, const EEntry Entry)
+	{
+		const FTransition Transition = MonsterStateRules::Transition(Inputs);
+		EXPECT_EQ(Transition.State, State);
+		EXPECT_EQ(Transition.Sound, Sound);
+		EXPECT_EQ(Transition.Entry, Entry);
+	}
+
+	void ExpectUnchanged(const FInputs& Inputs)
+	{
+		ExpectTransition(Inputs, Inputs.State, ESound::None, EEntry::None);
+	}
+
+	/**
+	 * Every state with every event, at distances either side of each radius, with and without a go to player time
+	 */
+	std::vector<FInputs> MakeAllInputs()
+	{
+		std::vector<FInputs> AllInputs;
+		for (int State = 0; State < NumStates; ++State)
+		{
+			for (int Event = 0; Event <= static_cast<int>(EEvent::GoToPlayerTimeUp); ++Event)
+			{
+				for (const float Distance : { 0.0f, 100.0f, 149.0f, 151.0f, 500.0f, 1000.0f, 2000.0f })
+				{
+					for (const float HowLongToGoToPlayer : { -1.0f, 0.0f, 3.0f })
+					{
+						AllInputs.push_back(MakeInputs(static_cast<EState>(State), static_cast<EEvent>(Event), Distance, HowLongToGoToPlayer));
+					}
+				}
+			}
+		}
+		return AllInputs;
+	}
+
+	/**
+	 * Owner that writes down which hooks the state machine called
+	 */
+	class FRecordingOwner
+	{
+	public:
+		enum class EHook { Sound, Exit, Enter };
+
+		struct FCall
+		{
+			EHook Hook;
+			int Value;
+			int Arg;
+
+			bool operator==(const FCall& Other) const { return Hook == Other.Hook && Value == Other.Value && Arg == Other.Arg; }
+		};
+
+		std::vector<FCall> Calls;
+
+	private:
+		friend struct MonsterStateRules::TStateMachine<FRecordingOwner>;
+
+		void PlayTransitionSound(const ESound Sound, const int Arg) { Calls.push_back({ EHook::Sound, static_cast<int>(Sound), Arg }); }
+
+		template <EState State>
+		void OnExitState(const int Arg) { Calls.push_back({ EHook::Exit, static_cast<int>(State), Arg }); }
+
+		template <EState State>
+		void OnEnterState(const FTransition& Transition, const int Arg) { Calls.push_back({ EHook::Enter, static_cast<int>(State), Arg }); }
+	};
+
+	using FHook = FRecordingOwner::EHook;
+
+	//the table is checked at compile time as well, the same way the transitions using it are
+	static_assert(IsEnterable(EState::Wander) && IsEnterable(EState::Pursue) && IsEnterable(EState::GoToPlayer) && IsEnterable(EState::Search), "");
+	static_assert(!IsEnterable(EState::ListenToLog) && !IsEnterable(EState::Inactive), "");
+}
+
+TEST(MonsterStateRulesTest, TransitionTableAllowsOnlyTheDesignedTransitions)
+{
+	const uint8_t Active = StateBit(EState::Wander) | StateBit(EState::Pursue) | StateBit(EState::GoToPlayer) | StateBit(EState::Search);
+	const uint8_t Expected[NumStates] =
+	{
+		/* Wander */		static_cast<uint8_t>(Active & ~StateBit(EState::Wander)),
+		/* Pursue */		static_cast<uint8_t>(Active & ~StateBit(EState::Pursue)),
+		/* GoToPlayer */	static_cast<uint8_t>(Active & ~StateBit(EState::GoToPlayer)),
+		/* Search */		static_cast<uint8_t>(Active & ~StateBit(EState::Search)),
+		/* ListenToLog */	Active,
+		/* Inactive */		StateBit(EState::Wander)
+	};
+
+	for (int From = 0; From < NumStates; ++From)
+	{
+		for (int To = 0; To < NumStates; ++To)
+		{
+			const bool bExpected = (Expected[From] & StateBit(static_cast<EState>(To))) != 0;
+			EXPECT_EQ(IsAllowed(static_cast<EState>(From), static_cast<EState>(To)), bExpected) << "From " << From << " to " << To;
+		}
+	}
+}
+
+TEST(MonsterStateRulesTest, EveryTransitionIsInTheTable)
+{
+	for (const FInputs& Inputs : MakeAllInputs())
+	{
+		const FTransition Transition = MonsterStateRules::Transition(Inputs);
+		if (Transition.State == Inputs.State) { continue; }
+
+		EXPECT_TRUE(IsAllowed(Inputs.State, Transition.State))
+			<< "State " << static_cast<int>(Inputs.State) << " event " << static_cast<int>(Inputs.Event) << " changed to " << static_cast<int>(Transition.State);
+	}
+}
+
+TEST(MonsterStateRulesTest, TransitionReadsNothingButTheInputs)
+{
+	const std::vector<FInputs> AllInputs = MakeAllInputs();
+	std::vector<FTransition> First;
+	for (const FInputs& Inputs : AllInputs)
+	{
+		First.push_back(Transition(Inputs));
+	}
+
+	//running the same inputs in reverse gives the same results
+	for (size_t i = AllInputs.size(); i-- > 0;)
+	{
+		const FTransition Again = Transition(AllInputs[i]);
+		EXPECT_EQ(Again.State, First[i].State);
+		EXPECT_EQ(Again.Sound, First[i].Sound);
+		EXPECT_EQ(Again.Entry, First[i].Entry);
+		EXPECT_EQ(Again.GoToPlayerDuration, First[i].GoToPlayerDuration);
+	}
+}
+
+TEST(MonsterStateRulesTest, SoundOutOfRangeOrWhileInactiveIsIgnored)
+{
+	ExpectUnchanged(MakeInputs(EState::Wander, EEvent::Sound, HearableRadius));
+	ExpectUnchanged(MakeInputs(EState::Search, EEvent::Sound, 2000.0f));
+	ExpectUnchanged(MakeInputs(EState::Inactive, EEvent::Sound, 100.0f));
+	ExpectUnchanged(MakeInputs(EState::Inactive, EEvent::Sound, 100.0f, 3.0f));
+}
+
+TEST(MonsterStateRulesTest, CloseSoundIsPursued)
+{
+	ExpectTransition(MakeInputs(EState::Wander, EEvent::Sound, 100.0f), EState::Pursue, ESound::Detected, EEntry::Pursue);
+	ExpectTransition(MakeInputs(EState::Search, EEvent::Sound, 100.0f), EState::Pursue, ESound::Detected, EEntry::Pursue);
+	ExpectTransition(MakeInputs(EState::ListenToLog, EEvent::Sound, 100.0f), EState::Pursue, ESound::Detected, EEntry::Pursue);
+
+	//a closer sound moves the pursuit without playing the detected sound again
+	ExpectTransition(MakeInputs(EState::Pursue, EEvent::Sound, 100.0f), EState::Pursue, ESound::None, EEntry::Pursue);
+
+	//a monster going to the player ignores it
+	ExpectUnchanged(MakeInputs(EState::GoToPlayer, EEvent::Sound, 100.0f));
+}
+
+TEST(MonsterStateRulesTest, CloseSoundWithGoToPlayerTimeGoesToPlayer)
+{
+	const FTransition Transition = MonsterStateRules::Transition(MakeInputs(EState::Wander, EEvent::Sound, 100.0f, 3.0f));
+	EXPECT_EQ(Transition.State, EState::GoToPlayer);
+	EXPECT_EQ(Transition.Sound, ESound::Detected);
+	EXPECT_EQ(Transition.Entry, EEntry::GoToPlayer);
+	EXPECT_FLOAT_EQ(Transition.GoToPlayerDuration, 3.0f);
+
+	//already aggressive, so no detected sound, but the timer restarts
+	ExpectTransition(MakeInputs(EState::GoToPlayer, EEvent::Sound, 100.0f, 3.0f), EState::GoToPlayer, ESound::None, EEntry::GoToPlayer);
+	ExpectTransition(MakeInputs(EState::Pursue, EEvent::Sound, 100.0f, 3.0f), EState::GoToPlayer, ESound::None, EEntry::GoToPlayer);
+}
+
+TEST(MonsterStateRulesTest, DistantSoundIsSearchedFor)
+{
+	ExpectTransition(MakeInputs(EState::Wander, EEvent::Sound, 1000.0f), EState::Search, ESound::SearchLoop, EEntry::Search);
+	ExpectTransition(MakeInputs(EState::Search, EEvent::Sound, 1000.0f), EState::Search, ESound::None, EEntry::Search);
+
+	//dont go into search mode while in a more agressive mode
+	ExpectUnchanged(MakeInputs(EState::Pursue, EEvent::Sound, 1000.0f));
+	ExpectUnchanged(MakeInputs(EState::GoToPlayer, EEvent::Sound, 1000.0f));
+}
+
+TEST(MonsterStateRulesTest, SightingCountsAsCloseSound)
+{
+	ExpectTransition(MakeInputs(EState::Wander, EEvent::PlayerSeen, 5000.0f), EState::Pursue, ESound::Detected, EEntry::Pursue);
+	ExpectTransition(MakeInputs(EState::Search, EEvent::PlayerSeen, 5000.0f, 3.0f), EState::GoToPlayer, ESound::Detected, EEntry::GoToPlayer);
+	ExpectUnchanged(MakeInputs(EState::Inactive, EEvent::PlayerSeen));
+	ExpectUnchanged(MakeInputs(EState::GoToPlayer, EEvent::PlayerSeen));
+}
+
+TEST(MonsterStateRulesTest, FollowPlayerGoesToPlayer)
+{
+	const FTransition Transition = MonsterStateRules::Transition(MakeInputs(EState::Wander, EEvent::FollowPlayer, 0.0f, 4.0f));
+	EXPECT_EQ(Transition.State, EState::GoToPlayer);
+	EXPECT_EQ(Transition.Sound, ESound::Detected);
+	EXPECT_EQ(Transition.Entry, EEntry::GoToPlayer);
+	EXPECT_FLOAT_EQ(Transition.GoToPlayerDuration, 4.0f);
+
+	ExpectTransition(MakeInputs(EState::Pursue, EEvent::FollowPlayer, 0.0f, 4.0f), EState::GoToPlayer, ESound::None, EEntry::GoToPlayer);
+
+	//only activating wakes an inactive monster
+	ExpectUnchanged(MakeInputs(EState::Inactive, EEvent::FollowPlayer, 0.0f, 4.0f));
+}
+
+TEST(MonsterStateRulesTest, ActivateWakesAnInactiveMonster)
+{
+	ExpectTransition(MakeInputs(EState::Inactive, EEvent::Activate), EState::Wander, ESound::Detected, EEntry::None);
+
+	//once active, activating again sends the monster to the player
+	ExpectTransition(MakeInputs(EState::Wander, EEvent::Activate, 0.0f, 3.0f), EState::GoToPlayer, ESound::Detected, EEntry::GoToPlayer);
+}
+
+TEST(MonsterStateRulesTest, PlayerDeathResetsToWander)
+{
+	for (int State = 0; State < static_cast<int>(EState::Inactive); ++State)
+	{
+		ExpectTransition(MakeInputs(static_cast<EState>(State), EEvent::PlayerDeath), EState::Wander, ESound::None, EEntry::Reset);
+	}
+
+	//an inactive monster sleeps through it
+	ExpectUnchanged(MakeInputs(EState::Inactive, EEvent::PlayerDeath));
+}
+
+TEST(MonsterStateRulesTest, StartSearchSearches)
+{
+	ExpectTransition(MakeInputs(EState::Pursue, EEvent::StartSearch), EState::Search, ESound::SearchLoop, EEntry::Search);
+	ExpectTransition(MakeInputs(EState::GoToPlayer, EEvent::StartSearch), EState::Search, ESound::SearchLoop, EEntry::Search);
+	ExpectTransition(MakeInputs(EState::Search, EEvent::StartSearch), EState::Search, ESound::None, EEntry::Search);
+	ExpectUnchanged(MakeInputs(EState::Inactive, EEvent::StartSearch));
+}
+
+TEST(MonsterStateRulesTest, ReachingThePursuedSoundSearchesAroundIt)
+{
+	ExpectTransition(MakeInputs(EState::Pursue, EEvent::ReachedTarget, ArrivalRadius - 1.0f), EState::Search, ESound::SearchLoop, EEntry::Search);
+	ExpectUnchanged(MakeInputs(EState::Pursue, EEvent::ReachedTarget, ArrivalRadius + 1.0f));
+
+	//wander and search pick a new target instead, which isn't a state change
+	ExpectUnchanged(MakeInputs(EState::Wander, EEvent::ReachedTarget, 0.0f));
+	ExpectUnchanged(MakeInputs(EState::Search, EEvent::ReachedTarget, 0.0f));
+}
+
+TEST(MonsterStateRulesTest, SearchTimeUpWanders)
+{
+	ExpectTransition(MakeInputs(EState::Search, EEvent::SearchTimeUp), EState::Wander, ESound::IdleLoop, EEntry::Wander);
+
+	//something more interesting happened in the meantime
+	ExpectUnchanged(MakeInputs(EState::Pursue, EEvent::SearchTimeUp));
+	ExpectUnchanged(MakeInputs(EState::Wander, EEvent::SearchTimeUp));
+}
+
+TEST(MonsterStateRulesTest, GoToPlayerTimeUpSearchesOrPursues)
+{
+	ExpectTransition(MakeInputs(EState::GoToPlayer, EEvent::GoToPlayerTimeUp, ArrivalRadius - 1.0f), EState::Search, ESound::SearchLoop, EEntry::Search);
+	ExpectTransition(MakeInputs(EState::GoToPlayer, EEvent::GoToPlayerTimeUp, ArrivalRadius + 1.0f), EState::Pursue, ESound::None, EEntry::None);
+	ExpectUnchanged(MakeInputs(EState::Search, EEvent::GoToPlayerTimeUp));
+}
+
+TEST(MonsterStateRulesTest, WanderKeepsAwayFromASafePlayer)
+{
+	FWanderInputs Inputs;
+	Inputs.bPlayerSafe = true;
+	Inputs.DistanceToPlayer = LingerRadius - 1.0f;
+	Inputs.TimeSincePursue = LingerTime + 1.0f;
+
+	const FWanderChoice Choice = ChooseWanderTarget(Inputs);
+	EXPECT_EQ(Choice.Target, EWanderTarget::AwayFromPlayer);
+	EXPECT_EQ(Choice.TimeSincePursue, Inputs.TimeSincePursue);
+}
+
+TEST(MonsterStateRulesTest, WanderLeavesAfterLingeringNearThePlayer)
+{
+	FWanderInputs Inputs;
+	Inputs.DistanceToPlayer = LingerRadius - 1.0f;
+
+	//coming near starts the count, the monster keeps wandering for now
+	FWanderChoice Choice = ChooseWanderTarget(Inputs);
+	EXPECT_EQ(Choice.Target, EWanderTarget::RandomPoint);
+	EXPECT_EQ(Choice.TimeSincePursue, 1.0f);
+
+	Inputs.TimeSincePursue = LingerTime - 1.0f;
+	Choice = ChooseWanderTarget(Inputs);
+	EXPECT_EQ(Choice.Target, EWanderTarget::RandomPoint);
+	EXPECT_EQ(Choice.TimeSincePursue, Inputs.TimeSincePursue);
+
+	//leaving stops the count
+	Inputs.TimeSincePursue = LingerTime;
+	Choice = ChooseWanderTarget(Inputs);
+	EXPECT_EQ(Choice.Target, EWanderTarget::FarthestRunaway);
+	EXPECT_LT(Choice.TimeSincePursue, 0.0f);
+
+	//far from the player nothing starts counting
+	Inputs.DistanceToPlayer = LingerRadius + 1.0f;
+	Inputs.TimeSincePursue = -1.0f;
+	Choice = ChooseWanderTarget(Inputs);
+	EXPECT_EQ(Choice.Target, EWanderTarget::RandomPoint);
+	EXPECT_LT(Choice.TimeSincePursue, 0.0f);
+}
+
+TEST(MonsterStateRulesTest, StateMachineRunsSoundThenExitThenEnter)
+{
+	FRecordingOwner Owner;
+	const FInputs Inputs = MakeInputs(EState::Search, EEvent::SearchTimeUp);
+	TStateMachine<FRecordingOwner>::Apply(Owner, Inputs.State, Transition(Inputs), 7);
+
+	const std::vector<FRecordingOwner::FCall> Expected =
+	{
+		{ FHook::Sound, static_cast<int>(ESound::IdleLoop), 7 },
+		{ FHook::Exit, static_cast<int>(EState::Search), 7 },
+		{ FHook::Enter, static_cast<int>(EState::Wander), 7 }
+	};
+	EXPECT_EQ(Owner.Calls, Expected);
+}
+
+TEST(MonsterStateRulesTest, StateMachineReentersWithoutExiting)
+{
+	FRecordingOwner Owner;
+	const FInputs Inputs = MakeInputs(EState::Pursue, EEvent::Sound, 100.0f);
+	TStateMachine<FRecordingOwner>::Apply(Owner, Inputs.State, Transition(Inputs), 1);
+
+	const std::vector<FRecordingOwner::FCall> Expected = { { FHook::Enter, static_cast<int>(EState::Pursue), 1 } };
+	EXPECT_EQ(Owner.Calls, Expected);
+}
+
+TEST(MonsterStateRulesTest, StateMachineRunsNoHooksWhenNothingChanges)
+{
+	FRecordingOwner Owner;
+	const FInputs Inputs = MakeInputs(EState::Pursue, EEvent::SearchTimeUp);
+	TStateMachine<FRecordingOwner>::Apply(Owner, Inputs.State, Transition(Inputs), 1);
+
+	EXPECT_TRUE(Owner.Calls.empty());
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include "Kismet/KismetMathLibrary.h"
 #include "Materials/MaterialParameterCollectionInstance.h"
 #include "MonsterAI/MonsterAIController.h"
+#include "MonsterAI/MonsterNoiseBus.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "UI/FolderWidget.h"
 #include "LevelManager.h"
@@ -34,6 +35,7 @@
 #include "GameFramework/PawnMovementComponent.h"
 #include "UI/MysteryWeb/MysteryWebWidget.h"
 #include "PlayerCharacterComponent.h"
+#include "WorldActorRegistry.h"
 
 void APlayerCharacter::Tick(const float DeltaTime)
 {
@@ -85,7 +87,9 @@ void APlayerCharacter::Tick(const float DeltaTime)
 	GEngine->AddOnScreenDebugMessage(-1, -1.0f, FColor::Cyan, Message);
 
 	// Show safety volume state
-	GEngine->AddOnScreenDebugMessage(-1, -1.0f, FColor::Cyan, FString::Printf(TEXT("Player is safe : %s"), PlayerCharacterComponent->IsPlayerProtectedBySafetyVolume() ? TEXT("true") : TEXT("false")));
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	const bool bSafe = Registry && Registry->IsPlayerSafe();
+	GEngine->AddOnScreenDebugMessage(-1, -1.0f, FColor::Cyan, FString::Printf(TEXT("Player is safe : %s"), bSafe ? TEXT("true") : TEXT("false")));
 
 	// Death animation handling
 	if (PlayerCharacterComponent->GetIsCurrentlyDead())
@@ -405,9 +409,6 @@ void APlayerCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
-	//Get reference to the LevelManager for this map
-	LevelManager = ALevelManager::GetLevelManager(GetWorld());
-	
 	//setup folder to use a dynamic material instance
 	FolderMaterialInstance = FolderUISkeletalMesh->CreateAndSetMaterialInstanceDynamic(0);
 
@@ -422,7 +423,17 @@ void APlayerCharacter::BeginPlay()
 		PlayerHUD->PlayerHUDInstance = PlayerHUD;
 	}
 
-	PlayerCharacterComponent->SetupFolder(LevelManager->LevelMysteryWebClass, FolderWidgetComponent);
+	//Get reference to the LevelManager for this map, or wait for the registry to find it if its level hasn't loaded yet
+	UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this);
+	if (ALevelManager* FoundLevelManager = Registry ? Registry->GetLevelManager() : nullptr)
+	{
+		SetLevelManager(FoundLevelManager);
+	}
+	else if (Registry)
+	{
+		LevelManagerRegisteredHandle = Registry->OnLevelManagerRegistered.AddUObject(this, &APlayerCharacter::SetLevelManager);
+	}
+
 	PlayerCharacterComponent->SetupRadio(RadioAkAudio, GetCapsuleComponent(), RadioHistogramReadoutMesh);
 	PlayerCharacterComponent->OnPlayerDeath.AddDynamic(this, &APlayerCharacter::OnDeath);
 	PlayerCharacterComponent->OnPlayerEndDeath.AddDynamic(this, &APlayerCharacter::OnEndDeath);
@@ -446,6 +457,22 @@ void APlayerCharacter::BeginPlay()
 	PlayerHandsMaterialInstance->SetScalarParameterValue(FName("HP_Amount"), PlayerCharacterComponent->GetHealth());
 }
 
+void APlayerCharacter::SetLevelManager(ALevelManager* NewLevelManager)
+{
+	//stop waiting on the registry if this came from it
+	if (LevelManagerRegisteredHandle.IsValid())
+	{
+		if (UWorldActorRegistry* Registry = UWorldActorRegistry::Get(this))
+		{
+			Registry->OnLevelManagerRegistered.Remove(LevelManagerRegisteredHandle);
+		}
+		LevelManagerRegisteredHandle.Reset();
+	}
+
+	LevelManager = NewLevelManager;
+	PlayerCharacterComponent->SetupFolder(LevelManager->LevelMysteryWebClass, FolderWidgetComponent);
+}
+
 #pragma endregion
 
 #pragma region Movement
@@ -631,7 +658,17 @@ void APlayerCharacter::PlayWalkingSound()
 	{
 		AudioDevice->PostEvent(AudioEventString, FootstepAudioComponent, 0, NULL, 0, TArray<AkExternalSourceInfo>());
 	}
-	PlayerCharacterComponent->MonsterController->ReportSound(GetActorLocation(), Radius, false, false, 1.5f);
+
+	//let the monster hear it. Queued so steps reported by MoveForward and MoveRight in the same frame are merged
+	if (UMonsterNoiseBus* NoiseBus = GetWorld()->GetSubsystem<UMonsterNoiseBus>())
+	{
+		FMonsterNoiseEvent Footstep;
+		Footstep.Origin = GetActorLocation();
+		Footstep.HearableRadius = Radius;
+		Footstep.HowLongToGoToPlayer = 1.5f;
+		Footstep.Source = this;
+		NoiseBus->ReportNoise(Footstep);
+	}
 }
 
 #pragma endregion
@@ -125,6 +125,17 @@ protected:
 	 */
 	virtual void BeginPlay() override;
 
+	/**
+	 * Sets up what needs the level's LevelManager, the folder. Called from BeginPlay, or by the registry once it finds the LevelManager
+	 * @param NewLevelManager The LevelManager for the current level
+	 */
+	void SetLevelManager(class ALevelManager* NewLevelManager);
+
+	/**
+	 * Handle for the registry's OnLevelManagerRegistered, while waiting for the LevelManager
+	 */
+	FDelegateHandle LevelManagerRegisteredHandle;
+
 #pragma endregion	
 
 #pragma region Movement
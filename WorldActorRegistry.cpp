@@ -0,0 +1,204 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WorldActorRegistry.h"
+
+#include "EngineUtils.h"
+#include "LevelManager.h"
+#include "PlayerCharacterComponent.h"
+#include "TimerManager.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "Interactables/Interactable.h"
+#include "MonsterAI/MonsterRunAwayLocation.h"
+
+bool UWorldActorRegistry::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+void UWorldActorRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UWorldActorRegistry::RegisterActor));
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UWorldActorRegistry::OnLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UWorldActorRegistry::OnLevelRemoved);
+}
+
+void UWorldActorRegistry::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	Super::Deinitialize();
+}
+
+UWorldActorRegistry* UWorldActorRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UWorldActorRegistry>() : nullptr;
+}
+
+void UWorldActorRegistry::RegisterActor(AActor* Actor)
+{
+	if (!Actor) { return; }
+
+	if (AMonsterRunAwayLocation* RunAwayLocation = Cast<AMonsterRunAwayLocation>(Actor))
+	{
+		if (!RunAwayActors.Contains(RunAwayLocation))
+		{
+			RunAwayActors.Add(RunAwayLocation);
+			RunAwayLocations.Add(RunAwayLocation->GetActorLocation());
+		}
+	}
+	else if (AInteractableObject* Interactable = Cast<AInteractableObject>(Actor))
+	{
+		Interactables.AddUnique(Interactable);
+	}
+	else if (ALevelManager* FoundLevelManager = Cast<ALevelManager>(Actor))
+	{
+		if (FoundLevelManager != LevelManager)
+		{
+			LevelManager = FoundLevelManager;
+			OnLevelManagerRegistered.Broadcast(LevelManager);
+		}
+	}
+	else if (APawn* Pawn = Cast<APawn>(Actor))
+	{
+		//the player is the only pawn with a PlayerCharacterComponent
+		if (UPlayerCharacterComponent* FoundPlayerComponent = Pawn->FindComponentByClass<UPlayerCharacterComponent>())
+		{
+			PlayerComponent = FoundPlayerComponent;
+
+			//safety volumes are entered and left through overlaps, so the player's safety only needs looking at when those change
+			Pawn->OnActorBeginOverlap.AddUniqueDynamic(this, &UWorldActorRegistry::OnPlayerOverlapChanged);
+			Pawn->OnActorEndOverlap.AddUniqueDynamic(this, &UWorldActorRegistry::OnPlayerOverlapChanged);
+			QueuePlayerSafetyRefresh();
+		}
+	}
+}
+
+UPlayerCharacterComponent* UWorldActorRegistry::GetPlayerComponent()
+{
+	EnsureScanned();
+	return PlayerComponent;
+}
+
+AActor* UWorldActorRegistry::GetPlayer()
+{
+	EnsureScanned();
+	return PlayerComponent ? PlayerComponent->GetOwner() : nullptr;
+}
+
+bool UWorldActorRegistry::IsPlayerSafe()
+{
+	EnsureScanned();
+	return bPlayerSafe;
+}
+
+ALevelManager* UWorldActorRegistry::GetLevelManager()
+{
+	EnsureScanned();
+	return LevelManager;
+}
+
+const TArray<FVector>& UWorldActorRegistry::GetRunAwayLocations()
+{
+	EnsureScanned();
+	return RunAwayLocations;
+}
+
+const TArray<TWeakObjectPtr<AInteractableObject>>& UWorldActorRegistry::GetInteractables()
+{
+	EnsureScanned();
+	return Interactables;
+}
+
+void UWorldActorRegistry::EnsureScanned()
+{
+	if (bScanned) { return; }
+	bScanned = true;
+
+	for (ULevel* Level : GetWorld()->GetLevels())
+	{
+		RegisterLevel(Level);
+	}
+}
+
+void UWorldActorRegistry::RegisterLevel(ULevel* Level)
+{
+	if (!Level) { return; }
+
+	for (AActor* Actor : Level->Actors)
+	{
+		RegisterActor(Actor);
+	}
+}
+
+void UWorldActorRegistry::OnLevelAdded(ULevel* Level, UWorld* World)
+{
+	//levels streamed in before the first scan are picked up by it
+	if (World != GetWorld() || !bScanned) { return; }
+
+	RegisterLevel(Level);
+}
+
+void UWorldActorRegistry::OnLevelRemoved(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld()) { return; }
+
+	//the level's actors are on their way out, forget them now instead of when their weak pointers go stale
+	if (LevelManager && LevelManager->GetLevel() == Level)
+	{
+		LevelManager = nullptr;
+	}
+	if (PlayerComponent && PlayerComponent->GetOwner()->GetLevel() == Level)
+	{
+		PlayerComponent = nullptr;
+		RefreshPlayerSafety();
+	}
+	RunAwayActors.RemoveAll([Level](const TWeakObjectPtr<AActor>& Actor) { return !Actor.IsValid() || Actor->GetLevel() == Level; });
+	Interactables.RemoveAll([Level](const TWeakObjectPtr<AInteractableObject>& Actor) { return !Actor.IsValid() || Actor->GetLevel() == Level; });
+	Prune();
+}
+
+void UWorldActorRegistry::Prune()
+{
+	RunAwayActors.RemoveAll([](const TWeakObjectPtr<AActor>& Actor) { return !Actor.IsValid(); });
+	Interactables.RemoveAll([](const TWeakObjectPtr<AInteractableObject>& Actor) { return !Actor.IsValid(); });
+
+	RunAwayLocations.Reset();
+	for (const TWeakObjectPtr<AActor>& Actor : RunAwayActors)
+	{
+		RunAwayLocations.Add(Actor->GetActorLocation());
+	}
+}
+
+void UWorldActorRegistry::OnPlayerOverlapChanged(AActor* OverlappedActor, AActor* OtherActor)
+{
+	QueuePlayerSafetyRefresh();
+}
+
+void UWorldActorRegistry::QueuePlayerSafetyRefresh()
+{
+	//the PlayerCharacterComponent may not have handled the same overlap yet, and several overlaps in a frame need only one look
+	if (bPlayerSafetyRefreshQueued) { return; }
+	bPlayerSafetyRefreshQueued = true;
+
+	GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UWorldActorRegistry::RefreshPlayerSafety);
+}
+
+void UWorldActorRegistry::RefreshPlayerSafety()
+{
+	bPlayerSafetyRefreshQueued = false;
+
+	const bool bSafe = PlayerComponent && PlayerComponent->IsPlayerProtectedBySafetyVolume();
+	if (bSafe == bPlayerSafe) { return; }
+
+	bPlayerSafe = bSafe;
+	++PlayerSafetyChangeCount;
+	OnPlayerSafetyChanged.Broadcast(bSafe);
+}
@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldActorRegistry.generated.h"
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPlayerSafetyChanged, bool /*bPlayerSafe*/);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnLevelManagerRegistered, class ALevelManager* /*LevelManager*/);
+
+/**
+ * Keeps track of the actors gameplay code keeps looking up, so finding them is a pointer read instead of a search of the world.
+ * The level's actors are picked up the first time the registry is used, and after that as they spawn or their level streams in
+ */
+UCLASS()
+class SPOOKYGAME_API UWorldActorRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	/**
+	 * Shorthand for getting the registry of the world an object is in
+	 * @param WorldContextObject Any object in the world
+	 * @return The registry, or nullptr if the world doesn't have one
+	 */
+	static UWorldActorRegistry* Get(const UObject* WorldContextObject);
+
+	/**
+	 * Adds an actor to the registry. Actors the registry doesn't track are ignored, and adding an actor twice does nothing
+	 * @param Actor The actor
+	 */
+	void RegisterActor(AActor* Actor);
+
+	/**
+	 * @return The player's PlayerCharacterComponent, or nullptr if there is no player yet
+	 */
+	class UPlayerCharacterComponent* GetPlayerComponent();
+
+	/**
+	 * @return The player's pawn, or nullptr if there is no player yet
+	 */
+	AActor* GetPlayer();
+
+	/**
+	 * Cached copy of the PlayerCharacterComponent's IsPlayerProtectedBySafetyVolume. It is only looked at again after the player
+	 * starts or stops overlapping something, so reading it costs nothing
+	 * @return True if the player is protected by a safety volume
+	 */
+	bool IsPlayerSafe();
+
+	/**
+	 * @return How many times the player has become safe or unsafe. Lets callers that cache their own results tell whether it changed since they last looked
+	 */
+	uint32 GetPlayerSafetyChangeCount() const { return PlayerSafetyChangeCount; }
+
+	/**
+	 * Broadcast when the player becomes safe or unsafe
+	 */
+	FOnPlayerSafetyChanged OnPlayerSafetyChanged;
+
+	/**
+	 * @return The LevelManager for the current level, or nullptr if the level doesn't have one
+	 */
+	class ALevelManager* GetLevelManager();
+
+	/**
+	 * Broadcast when a LevelManager is registered, for actors that begin play before their level's LevelManager is known
+	 */
+	FOnLevelManagerRegistered OnLevelManagerRegistered;
+
+	/**
+	 * @return Locations of every AMonsterRunAwayLocation in the loaded levels
+	 */
+	const TArray<FVector>& GetRunAwayLocations();
+
+	/**
+	 * @return Every interactable object in the loaded levels. Entries can go stale when an interactable is destroyed
+	 */
+	const TArray<TWeakObjectPtr<class AInteractableObject>>& GetInteractables();
+
+private:
+	/**
+	 * Registers every actor already in the world, the first time the registry is used
+	 */
+	void EnsureScanned();
+
+	/**
+	 * Registers every actor in a level
+	 * @param Level The level
+	 */
+	void RegisterLevel(ULevel* Level);
+
+	/**
+	 * Called when a streaming level is added to the world
+	 * @param Level The level
+	 * @param World The world it was added to
+	 */
+	void OnLevelAdded(ULevel* Level, UWorld* World);
+
+	/**
+	 * Called when a streaming level is removed from the world
+	 * @param Level The level
+	 * @param World The world it was removed from
+	 */
+	void OnLevelRemoved(ULevel* Level, UWorld* World);
+
+	/**
+	 * Rebuilds RunAwayLocations and drops interactables that are gone
+	 */
+	void Prune();
+
+	/**
+	 * Called when the player starts or stops overlapping an actor, which is the only time they can enter or leave a safety volume
+	 * @param OverlappedActor The player
+	 * @param OtherActor The actor overlapped
+	 */
+	UFUNCTION()
+	void OnPlayerOverlapChanged(AActor* OverlappedActor, AActor* OtherActor);
+
+	/**
+	 * Looks at the player's safety again on the next tick, once every overlap of this frame has been handled
+	 */
+	void QueuePlayerSafetyRefresh();
+
+	/**
+	 * Updates the cached player safety and broadcasts OnPlayerSafetyChanged if it changed
+	 */
+	void RefreshPlayerSafety();
+
+	UPROPERTY(Transient)
+	class UPlayerCharacterComponent* PlayerComponent;
+
+	UPROPERTY(Transient)
+	class ALevelManager* LevelManager;
+
+	/**
+	 * The runaway location actors and where they are
+	 */
+	TArray<TWeakObjectPtr<AActor>> RunAwayActors;
+	TArray<FVector> RunAwayLocations;
+
+	TArray<TWeakObjectPtr<class AInteractableObject>> Interactables;
+
+	/**
+	 * True once the actors already in the world have been registered
+	 */
+	bool bScanned = false;
+
+	/**
+	 * True if the player was protected by a safety volume when last looked at
+	 */
+	bool bPlayerSafe = false;
+
+	/**
+	 * True while a RefreshPlayerSafety is waiting for the next tick
+	 */
+	bool bPlayerSafetyRefreshQueued = false;
+
+	uint32 PlayerSafetyChangeCount = 0;
+
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+};